@@ -0,0 +1,113 @@
+#ifndef Q_INC_AOT
+#define Q_INC_AOT
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+#if !defined(_WIN32) && (defined(__unix__) || defined(__APPLE__))
+#define Q_AOT // dlopen
+#endif
+
+namespace vm {
+
+	// ahead of time compiler: a code segment translated to C (one label per instruction, a switch
+	// only for the register targets, the syscalls and the rare cases handed back to the engine of
+	// the vm), built as a shared object by the host compiler and run in place of the interpreters
+	class aot_c {
+	public:
+
+		using reg32_t  = uint32_t;
+		using idx_t    = uint32_t;
+		using loc_t    = uint8_t;
+		using fuel_t   = int64_t;
+		using path_t   = std::string;
+		using source_t = std::string;
+
+		// runs the instruction at ipx with the engine of the vm (ipx is moved past it),
+		// returns as vm_c::engine
+		using step_t = int32_t (*)(void*);
+
+		// shared with the generated code (qvm_context_t)
+		struct context_t {
+			reg32_t* r;     // core_c
+			loc_t* mem;
+			idx_t len;      // of the memory
+			idx_t base;     // address of the code segment
+			uint32_t dirty; // the code segment has been written
+			void* vm;
+			step_t step;
+		};
+
+		// entry of a compiled program: as vm_c::dispatch (0 ended, 1 continue from ipx with an
+		// interpreter, 2 slice expired, 3 parked)
+		using run_t = int32_t (*)(context_t*, fuel_t*);
+
+	public:
+
+		// version of the interface with the generated code
+		static constexpr uint32_t abi = 0x00000001;
+
+	protected:
+
+		void* m_lib;
+		run_t m_run;
+		idx_t m_len; // of the code segment
+		context_t m_ctx;
+
+	public:
+
+		aot_c();
+		aot_c(const aot_c&) = delete;
+		aot_c(aot_c&&) noexcept = delete;
+
+		aot_c& operator=(const aot_c&) = delete;
+		aot_c& operator=(aot_c&&) noexcept = delete;
+
+	public:
+
+		~aot_c();
+
+	public:
+
+		// @why: to know if this host can load compiled programs.
+		// @in: null.
+		// @out: true on hosts with dlopen.
+		static bool supported();
+
+		// @why: to translate a code segment to C.
+		// @in: code, length (multiple of 4).
+		// @out: source of the shared object.
+		static source_t translate(const loc_t*, const idx_t);
+
+		// @why: to build a shared object with the host compiler ($CC split on blanks, cc by default,
+		// run without a shell), the source is kept next to it (<library>.c).
+		// @in: source, path of the shared object.
+		// @out: false when it can not be built.
+		static bool build(const source_t&, const path_t&);
+
+	public:
+
+		// @why: to load a shared object built for a code segment.
+		// @in: path, code and length it has to match.
+		// @out: false when it can not be loaded or was built for another code.
+		bool open(const path_t&, const loc_t*, const idx_t);
+
+		// @why: to run the compiled program from ipx.
+		// @in: vm and its step, registers, memory and its length, address of the code segment,
+		// instructions left to the slice (decreased by the executed ones).
+		// @out: as run_t.
+		int32_t run(void*, const step_t, reg32_t*, loc_t*, const idx_t, const idx_t, fuel_t&);
+
+		// @why: to drop the compiled code once the program writes its code segment.
+		// @in: address, length of the written block.
+		// @out: null.
+		void invalidate(const idx_t, const idx_t);
+
+		bool dirty() const;
+
+	};
+
+}
+
+#endif
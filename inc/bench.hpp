@@ -0,0 +1,139 @@
+#ifndef Q_INC_BENCH
+#define Q_INC_BENCH
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+
+#include "vm.hpp"
+
+namespace vm {
+
+	// micro and macro benchmarks of the vm, one json object per measure on the output:
+	//   micro: cost of every opcode in the engines, memory_c::get, core_c::get, loading of
+	//          1/10/100 MB hex programs, construction of a vm
+	//   macro: guest programs (loop, fib, sieve, byte copy, string output) in every engine
+	// the guest programs are assembled here and loaded from temporary hex files, every measure
+	// keeps the best of a few runs
+	class bench_c {
+	public:
+
+		using name_t   = std::string;
+		using idx_t    = memory_c::idx_t;
+		using engine_e = vm_c::engine_e;
+		using duration = std::chrono::duration<double>;
+
+		// guest program being assembled
+		struct code_t {
+			std::vector<uint8_t> bytes;
+
+			// @why: to append an instruction.
+			// @in: opcode and its operands.
+			// @out: offset of the instruction.
+			idx_t op(const uint8_t, const uint8_t = 0, const uint8_t = 0, const uint8_t = 0);
+
+			// @why: to append a static jump (jit v,v or jif v,v) to an offset of the program.
+			// @in: opcode, target offset, flags compared with fx.
+			// @out: offset of the instruction.
+			idx_t jump(const uint8_t, const idx_t, const uint8_t);
+
+			// @why: to set the target of a forward jump once known.
+			// @in: offset of the jump, target offset.
+			// @out: null.
+			void bind(const idx_t, const idx_t);
+
+			// @why: to end the program with exc 1.
+			// @in: null.
+			// @out: null.
+			void exit();
+
+			idx_t here() const;
+		};
+
+	public:
+
+		// runs of every measure, the best one is kept
+		static constexpr uint32_t druns = 3;
+
+		// address of the guest data (strings, arrays), the code segment is at the top of the memory
+		static constexpr idx_t daddr = 0x1000;
+
+	protected:
+
+		name_t m_filter; // measures whose name contains it, all when empty
+		idx_t m_mem;
+		std::vector<engine_e> m_engines;
+		uint32_t m_runs;
+		std::string m_dir; // temporary programs
+
+	public:
+
+		// @in: filter on the names, length of the memory, engine (all of them when not given).
+		bench_c(const name_t&, const idx_t, const engine_e*);
+		bench_c(const bench_c&) = delete;
+		bench_c(bench_c&&) noexcept = delete;
+
+		bench_c& operator=(const bench_c&) = delete;
+		bench_c& operator=(bench_c&&) noexcept = delete;
+
+	public:
+
+		~bench_c() = default;
+
+	public:
+
+		// @why: to run every selected measure.
+		// @in: null.
+		// @out: 0 on success, 1 when a guest program did not end normally.
+		int32_t run();
+
+	public:
+
+		static const char* name(const engine_e);
+
+	protected:
+
+		bool selected(const name_t&) const;
+
+		// @why: to print a measure.
+		// @in: name, engine (null for the host ones), operations done, unit of them, best time.
+		// @out: null.
+		void report(const name_t&, const char*, const uint64_t, const char*, const duration) const;
+
+		// @why: to keep the best time of the runs of a measure.
+		// @in: measure, returns the operations done and its time.
+		// @out: operations of the best run and its time.
+		std::pair<uint64_t, duration> best(const std::function<std::pair<uint64_t, duration>()>&) const;
+
+		// @why: to run a guest program in an engine.
+		// @in: name, program, engine.
+		// @out: false when the program did not end normally.
+		bool guest(const name_t&, const code_t&, const engine_e);
+
+		// @why: to write a hex program in the temporary directory.
+		// @in: name, text.
+		// @out: path of the file, empty on failure.
+		std::string write(const name_t&, const std::string&) const;
+
+		bool opcodes();
+		bool programs();
+		void memory();
+		void registers();
+		void loader();
+		void construct();
+
+	public:
+
+		// @why: to build the hex text of a program (4 bytes per line).
+		// @in: program.
+		// @out: text.
+		static std::string hex(const code_t&);
+
+	};
+
+}
+
+#endif
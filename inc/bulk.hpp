@@ -0,0 +1,53 @@
+#ifndef Q_INC_BULK
+#define Q_INC_BULK
+
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define Q_SIMD // SSE2 on every x86-64 host, AVX2 when the cpu has it
+#endif
+
+namespace vm {
+
+	// host kernels of the bulk memory instructions (chosen once, from the cpu features)
+	class bulk_c {
+	public:
+
+		using loc_t = uint8_t;
+
+		enum class isa_e : uint8_t {
+			SCALAR = 0x00,
+			SSE2   = 0x01,
+			AVX2   = 0x02,
+		};
+
+	public:
+
+		bulk_c() = delete;
+
+	public:
+
+		static isa_e isa();
+		static const char* name(const isa_e);
+
+		// @why: to copy a block (the blocks may overlap).
+		// @in: destination, source, length.
+		// @out: null.
+		static void copy(loc_t*, const loc_t*, const size_t);
+
+		// @why: to set every location of a block.
+		// @in: destination, value, length.
+		// @out: null.
+		static void fill(loc_t*, const loc_t, const size_t);
+
+		// @why: to compare two blocks as unsigned bytes.
+		// @in: left, right, length.
+		// @out: negative, zero or positive (as the first different byte).
+		static int32_t compare(const loc_t*, const loc_t*, const size_t);
+
+	};
+
+}
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef Q_INC_CACHE
+#define Q_INC_CACHE
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <array>
+
+namespace vm {
+
+	class process_c;
+
+	// persistent cache of loaded programs (--cache=<dir>): an entry, named by the SHA-256 of the
+	// source file, holds the program as a binary image (nothing to parse), the result of the
+	// verifier and the shared object built by qvm aot; the length and the whole digest of the
+	// source are compared on every fetch; entries of another vm version are dropped, the least
+	// recently used ones once the directory grows past its cap
+	class cache_c {
+	public:
+
+		using name_t    = uint64_t;
+		using len_t     = uint64_t;
+		using version_t = uint32_t;
+		using path_t    = std::string;
+		using loc_t     = uint8_t;
+		using digest_t  = std::array<loc_t, 32>;
+
+		// identity of a source
+		struct key_t {
+			name_t name;  // of the entry (first bytes of the digest), 0 when the source can not be read
+			len_t len;
+			digest_t sum; // SHA-256
+		};
+
+	public:
+
+		// default cap of the directory (256 Mb)
+		static constexpr len_t dlen = 0x10000000;
+
+		// layout of the entries
+		static constexpr uint32_t format = 0x00000002;
+
+	protected:
+
+		path_t m_dir;
+		len_t m_cap;
+		version_t m_ver; // of the vm writing and reading the entries
+
+		uint64_t m_hits, m_misses;
+
+	public:
+
+		cache_c(const path_t&, const len_t, const version_t);
+		cache_c(const cache_c&) = delete;
+		cache_c(cache_c&&) noexcept = delete;
+
+		cache_c& operator=(const cache_c&) = delete;
+		cache_c& operator=(cache_c&&) noexcept = delete;
+
+	public:
+
+		~cache_c() = default;
+
+	public:
+
+		// @why: to create the directory when it does not exist.
+		// @in: null.
+		// @out: false when it can not be used.
+		bool open() const;
+
+		// @why: to name the entry of a program.
+		// @in: path of the source (binary image or hex text).
+		// @out: digest of its content, a null name when it can not be read.
+		key_t key(const path_t&) const;
+
+		// @why: to load a program from its entry (the verifier is not run again, the shared object
+		// is linked when there is one).
+		// @in: key, process not loaded yet.
+		// @out: false on a miss (a stale entry is dropped, the entry of another source is kept).
+		bool fetch(const key_t&, process_c&);
+
+		// @why: to keep a program just loaded and verified.
+		// @in: key, loaded process (its image is not closed yet).
+		// @out: false when the entry can not be written.
+		bool store(const key_t&, const process_c&);
+
+		// @why: to keep the shared object built for a program (qvm aot).
+		// @in: key of an entry, path of the shared object.
+		// @out: false when there is no such entry or it can not be written.
+		bool native(const key_t&, const path_t&);
+
+		uint64_t hits() const;
+		uint64_t misses() const;
+
+	protected:
+
+		path_t entry(const name_t, const char*) const;
+
+		void drop(const name_t);
+
+		// @why: to read the description of an entry.
+		// @in: key, result of the verifier (out).
+		// @out: 0 when the entry is the one of the source, 1 when there is none or it is of another
+		// source, 2 when it is stale (another layout or vm version).
+		uint8_t meta(const key_t&, uint32_t&) const;
+
+		// @why: to keep the directory under its cap.
+		// @in: null.
+		// @out: null.
+		void trim();
+
+	public:
+
+		// @why: to identify a source.
+		// @in: content, length.
+		// @out: its key (SHA-256).
+		static key_t hash(const loc_t*, const size_t);
+
+	};
+
+}
+
+#endif
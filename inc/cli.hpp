@@ -0,0 +1,152 @@
+#ifndef Q_INC_CLI
+#define Q_INC_CLI
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "vm.hpp"
+#include "cache.hpp"
+
+namespace vm {
+
+	// command line entry points that do not use the menu:
+	//   qvm run <program>[@<priority>]... [options] (several programs run at once, 0 is the highest
+	//   priority and the default)
+	//   qvm batch <manifest> [options]
+	//   qvm scale <program> [processes] [workers]
+	//   qvm bench [filter] (json measures whose name contains the filter, every engine by default)
+	//   qvm verify <program> (json analysis of the code: validity, control flow graph)
+	//   qvm aot <program> <library> (compiles the code to a shared object, --check runs it against
+	//   the reference engine)
+	//   qvm convert <hex> <image>
+	// options: --mem=<n>[K|M|G] --engine=jit|threaded|reference --debug=regs|stack|both|step
+	//          --console=<dir> (process N writes <dir>/N.out, reads <dir>/N.in when it exists)
+	//          --sandbox=<dir> (directory of the file syscalls, the working one by default)
+	//          --profile=<file> (appends the profile of every ended process, one json object per line)
+	//          --sample=<file> (appends the collapsed stacks of every ended process, for flamegraph.pl)
+	//          --interval=<us> (between two samples, 1000 by default)
+	//          --deterministic (same placement of the segments on every run)
+	//          --quantum=<n> (instructions of a slice, 65536 by default)
+	//          --native=<library> (compiled program run in place of the interpreters, see qvm aot)
+	//          --cache=<dir> (parsed, verified and compiled programs kept between runs)
+	//          --cache-size=<n>[K|M|G] (cap of the cache directory, 256M by default)
+	class cli_c {
+	public:
+
+		using arg_t  = std::string;
+		using args_t = std::vector<cli_c::arg_t>;
+		using idx_t  = memory_c::idx_t;
+
+	protected:
+
+		arg_t m_cmd;
+		args_t m_args; // positional arguments, after the command
+		idx_t m_mem;
+		uint8_t m_dbg;
+		vm_c::engine_e m_mode;
+		bool m_engine; // engine given by --engine
+		arg_t m_console; // directory of the console files
+		arg_t m_sandbox; // directory of the file syscalls
+		arg_t m_profile; // file of the profiles
+		arg_t m_sample;  // file of the collapsed stacks
+		uint32_t m_interval; // microseconds between two samples, 0 for the default
+		bool m_fixed; // deterministic placement of the segments
+		arg_t m_native; // compiled program of the run command
+		bool m_check;   // differential check of qvm aot
+		arg_t m_cache;  // directory of the cache, empty when off
+		uint64_t m_cap; // of the cache directory, 0 for the default
+		int64_t m_quantum; // instructions of a slice, 0 for the default
+
+	public:
+
+		cli_c(const int, char**);
+		cli_c(const cli_c&) = delete;
+		cli_c(cli_c&&) noexcept = delete;
+
+		cli_c& operator=(const cli_c&) = delete;
+		cli_c& operator=(cli_c&&) noexcept = delete;
+
+	public:
+
+		~cli_c() = default;
+
+	public:
+
+		// @why: to know if the interactive menu has to be started instead.
+		// @in: null.
+		// @out: true when a command is given.
+		bool headless() const;
+
+		// @why: to execute the command.
+		// @in: null.
+		// @out: exit code of qvm (of the program for the run command).
+		int32_t run();
+
+	protected:
+
+		// @why: to run programs as the menu would, with the console report.
+		// @in: null.
+		// @out: exit code of the last program to end.
+		int32_t single();
+
+		// @why: to run every program of a manifest (one path per line, '#' starts a comment)
+		// back to back in the same memory, one json object per program on the output.
+		// @in: null.
+		// @out: 0 when every program has been started.
+		int32_t batch();
+
+		// @why: to measure how the runtime scales (same batch with 1 to N workers).
+		// @in: null.
+		// @out: 0 on success.
+		int32_t scale();
+
+		// @why: to run the benchmark suite (see bench_c).
+		// @in: null.
+		// @out: 0 when every guest program ended normally.
+		int32_t bench();
+
+		// @why: to show the load time analysis of a program (see verifier_c).
+		// @in: null.
+		// @out: 0 when the program passes it.
+		int32_t verify();
+
+		// @why: to compile a program ahead of time (see aot_c), then with --check to run it once
+		// with the reference engine and once compiled and compare the results.
+		// @in: null.
+		// @out: 0 when it is built (and the results are identical).
+		int32_t aot();
+
+		void option(const arg_t&);
+		void configure(vm_c&) const;
+
+		// @why: to open the cache given by --cache for the version of a vm.
+		// @in: vm.
+		// @out: the cache, null when there is none (throws when the directory can not be used).
+		std::unique_ptr<cache_c> cache(const vm_c&) const;
+
+		// @why: to give a process its console files (--console).
+		// @in: process, with its id.
+		// @out: false when the output file can not be created.
+		bool attach(process_c&) const;
+
+	public:
+
+		// @why: to read a length such as 64M.
+		// @in: text.
+		// @out: length in bytes, 0 when the text is not a length.
+		static uint64_t length(const arg_t&);
+
+		static arg_t quote(const arg_t&);
+
+		// @why: to split a program of the run command from its priority.
+		// @in: argument, path (out).
+		// @out: priority, 0 when none is given (throws when it is not a level of scheduler_c).
+		static process_c::prio_t priority(const arg_t&, arg_t&);
+
+	};
+
+}
+
+#endif
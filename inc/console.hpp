@@ -0,0 +1,88 @@
+#ifndef Q_INC_CONSOLE
+#define Q_INC_CONSOLE
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <istream>
+#include <fstream>
+#include <functional>
+
+namespace vm {
+
+	// console of a process: the output is kept in a buffer written with one call at exit (or when
+	// it is full), so the outputs of several processes do not interleave
+	class console_c {
+	public:
+
+		using buf_t  = std::string;
+		using path_t = std::string;
+
+		// receives the output in place of a file (embedding host)
+		using sink_t = std::function<void(const char*, const size_t)>;
+
+	public:
+
+		// default length of the output buffer
+		static constexpr size_t dlen = 0x00010000;
+
+	protected:
+
+		buf_t m_out;
+		size_t m_max;
+		int m_fd; // output file, -1 for the standard output
+		sink_t m_sink; // set by attach, takes over the file
+
+		std::istream* m_in;
+		std::ifstream m_file;
+
+	public:
+
+		console_c();
+		console_c(const console_c&) = delete;
+		console_c(console_c&&) noexcept = delete;
+
+		console_c& operator=(const console_c&) = delete;
+		console_c& operator=(console_c&&) noexcept = delete;
+
+	public:
+
+		~console_c();
+
+	public:
+
+		// @why: to send the console of a process to files.
+		// @in: output file (created), input file (kept on the standard input when it does not exist).
+		// @out: false when the output file can not be created.
+		bool redirect(const path_t&, const path_t&);
+
+		// @why: to give the console of a process to a host, the standard streams are not used.
+		// @in: output sink (empty: the output is dropped), input stream (null: no input, reads fail).
+		// @out: null.
+		void attach(const sink_t&, std::istream*);
+
+		// @why: to change when the output is written.
+		// @in: length of the buffer, 0 to write on every call.
+		// @out: null.
+		void threshold(const size_t);
+
+	public:
+
+		void write(const char*, const size_t);
+		void put(const char);
+		void put(const uint32_t);
+		void put(const int32_t);
+		void put(const float);
+
+		// @why: to read the input, the output is written first (as a prompt).
+		// @in: null.
+		// @out: input stream.
+		std::istream& in();
+
+		void flush();
+
+	};
+
+}
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef Q_INC_DECODE
+#define Q_INC_DECODE
+
+#include <cstdint>
+#include <vector>
+
+#include "jit.hpp"
+
+namespace vm {
+
+	class core_c;
+	class memory_c;
+
+	class program_c {
+	public:
+
+		using reg32_t = uint32_t;
+		using idx_t   = uint32_t;
+
+		// internal operations (not the bytecode opcodes)
+		enum class op_e : uint8_t {
+			NOP,
+			LDX_V, LDX_X,
+			SET_V, SET_X, GET_X,
+			LDW_X, STW_X, LDD_X, STD_X, // imm: step of ax
+			JIT_VV, JIT_VX, JIF_VV, JIF_VX,
+			ADD_V, ADD_X, SUB_V, SUB_X, MUL_V, MUL_X, DIV_V, DIV_X,
+			AND_V, AND_X, OR_V, OR_X, XOR_V, XOR_X,
+			SHL_V, SHL_X, SHR_V, SHR_X,
+			NOT_X, CMP_V, CMP_X,
+			// superinstructions (the second instruction keeps its own slot)
+			CMPV_JITV, CMPV_JIFV, CMPV_JITX, CMPV_JIFX, CMPX_JITV, CMPX_JIFV,
+			SUBV_JITV, SUBV_JIFV, SUBX_JITV, SUBX_JIFV,
+			LDXV_ADDX,
+			NATIVE,  // block compiled by jit_c
+			GENERIC, // executed by vm_c::engine (syscalls, indirect jumps...)
+			END,     // sentinel past the last instruction
+			COUNT
+		};
+
+		// fused pairs, as reported
+		enum class fuse_e : uint8_t {
+			CMP_JIT,
+			CMP_JIF,
+			SUB_JIT,
+			SUB_JIF,
+			LDX_ADD,
+			COUNT
+		};
+
+		// pre-resolved instruction
+		struct instr_t {
+			const void* h;  // handler (label address when threaded)
+			reg32_t* r0;    // destination (or first) register
+			reg32_t* r1;    // source (or second) register
+			reg32_t imm;    // pre-combined immediate (raw bytes for GENERIC)
+			idx_t tgt;      // index of the next instruction when a jump is taken
+			uint32_t hits;  // taken jumps landing here
+			op_e op;
+			uint8_t cc;     // flags tested by a fused jump
+		};
+
+	protected:
+
+		std::vector<instr_t> m_code; // one entry per instruction, plus END
+		std::vector<jit_c::block_t> m_native;
+		size_t m_natives;
+		const void* const* m_tbl;    // handlers used by link
+		core_c* m_state;
+		memory_c* m_memory;
+		reg32_t m_csx, m_clx;
+		bool m_fuse;
+		uint32_t m_fused[static_cast<uint8_t>(fuse_e::COUNT)];
+
+	public:
+
+		program_c();
+		program_c(const program_c&) = delete;
+		program_c(program_c&&) noexcept = delete;
+
+		program_c& operator=(const program_c&) = delete;
+		program_c& operator=(program_c&&) noexcept = delete;
+
+	public:
+
+		~program_c() = default;
+
+	public:
+
+		// @why: to translate the code segment once before running it.
+		// @in: registers and memory the handlers will refer to, code segment.
+		// @out: null.
+		void decode(core_c&, memory_c&, const reg32_t, const reg32_t);
+
+		// @why: to re-translate an instruction after a store into the code segment.
+		// @in: address of the modified memory location.
+		// @out: null.
+		void patch(const reg32_t);
+
+		// @why: to bind each instruction to its handler (threaded dispatch).
+		// @in: handlers indexed by op_e.
+		// @out: null.
+		void link(const void* const*);
+
+		// @why: to run an instruction through its native block.
+		// @in: index of the instruction, block compiled by jit_c.
+		// @out: null.
+		void native(const idx_t, const jit_c::block_t);
+
+		// @why: to drop every native block (the code segment has been modified).
+		// @in: null.
+		// @out: null.
+		void denative();
+
+		// @why: to replace common instruction pairs with superinstructions.
+		// @in: null.
+		// @out: null.
+		void optimize();
+
+		void clear();
+
+	public:
+
+		// @why: to enable or disable the superinstructions of the next decode.
+		// @in: true to fuse.
+		// @out: null.
+		void fuse(const bool);
+
+		// @why: to check which superinstructions fired on a program.
+		// @in: kind of pair.
+		// @out: number of fused pairs of this kind.
+		uint32_t fused(const fuse_e) const;
+
+		static const char* name(const fuse_e);
+
+	public:
+
+		bool valid() const;
+		bool linked() const;
+		size_t natives() const;
+
+		reg32_t csx() const;
+		reg32_t clx() const;
+		idx_t length() const;
+
+	public:
+
+		instr_t* data();
+
+		jit_c::block_t block(const idx_t) const;
+
+	protected:
+
+		instr_t translate(const idx_t) const;
+
+		// @why: to fuse the instruction at idx with the next one.
+		// @in: index of the first instruction of the pair.
+		// @out: kind of the fused pair, COUNT when it has not been fused.
+		fuse_e combine(const idx_t);
+
+	};
+
+	// @why: the flags set by cmp/sub, shared by every execution mode.
+	inline uint32_t compare_flags(const uint32_t left, const uint32_t right) {
+		return left < right ? 0x0001 /* less */ : left == right ? 0x0002 /* equal */ : 0x0004 /* greater */;
+	}
+
+}
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef Q_INC_FILES
+#define Q_INC_FILES
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vm {
+
+	class memory_c;
+
+	// directory the file syscalls are confined to
+	class sandbox_c {
+	public:
+
+		using path_t = std::string;
+
+	protected:
+
+		int m_fd; // open directory, -1 when file syscalls are denied
+		path_t m_path;
+
+	public:
+
+		sandbox_c();
+		sandbox_c(const sandbox_c&) = delete;
+		sandbox_c(sandbox_c&&) noexcept = delete;
+
+		sandbox_c& operator=(const sandbox_c&) = delete;
+		sandbox_c& operator=(sandbox_c&&) noexcept = delete;
+
+	public:
+
+		~sandbox_c();
+
+	public:
+
+		// @why: to change the directory of the file syscalls.
+		// @in: path of an existing directory.
+		// @out: false when it can not be opened (the previous one is kept).
+		bool open(const path_t&);
+
+		bool valid() const;
+		int fd() const;
+		const path_t& path() const;
+
+		// @why: to reach the directory of a path without following a symbolic link on the way
+		// (a link to a directory would lead out of the sandbox).
+		// @in: path given by a program (safe), last component of the path (out).
+		// @out: open descriptor of the directory holding the last component (to be closed),
+		// -1 when a directory is missing or is a link.
+		int walk(const path_t&, path_t&) const;
+
+	public:
+
+		// @why: to refuse the paths leaving the sandbox (absolute, "..").
+		// @in: path given by a program.
+		// @out: true when the path stays under the sandbox.
+		static bool safe(const path_t&);
+
+	};
+
+	// file descriptors of a process (syscalls exc 0x3)
+	class files_c {
+	public:
+
+		using fd_t   = uint32_t;
+		using idx_t  = uint32_t;
+		using path_t = sandbox_c::path_t;
+
+		// open flags, as given in x2
+		enum class mode_e : uint32_t {
+			READ     = 0x0001,
+			WRITE    = 0x0002,
+			CREATE   = 0x0004,
+			TRUNCATE = 0x0008,
+			APPEND   = 0x0010,
+		};
+
+	public:
+
+		// maximum number of open files of a process
+		static constexpr fd_t mfds = 0x40;
+
+		// result of a failed syscall
+		static constexpr uint32_t bad = 0xFFFFFFFF;
+
+	protected:
+
+		struct map_t {
+			idx_t addr;
+			idx_t len;
+		};
+
+		std::vector<int> m_fds; // host descriptors, -1 for free slots
+		std::vector<map_t> m_maps;
+
+	public:
+
+		files_c();
+		files_c(const files_c&) = delete;
+		files_c(files_c&&) noexcept = delete;
+
+		files_c& operator=(const files_c&) = delete;
+		files_c& operator=(files_c&&) noexcept = delete;
+
+	public:
+
+		~files_c();
+
+	public:
+
+		// @why: to open a file of the sandbox.
+		// @in: sandbox, path, flags (mode_e).
+		// @out: descriptor, bad on error.
+		fd_t open(const sandbox_c&, const path_t&, const uint32_t);
+
+		uint32_t close(const fd_t);
+
+		// @why: to move the position of a file.
+		// @in: descriptor, offset, origin (0: start, 1: current, 2: end).
+		// @out: new position, bad on error.
+		uint32_t seek(const fd_t, const int32_t, const uint32_t);
+
+		uint32_t size(const fd_t);
+
+		// @why: to show a file in the memory without copying it: only the whole pages inside the
+		// block are mapped, the tail of the block (less than a page) is copied, the memory past the
+		// block or past the end of the file is left as it is.
+		// @in: descriptor, memory, address (page aligned), length, offset in the file (page aligned).
+		// @out: number of bytes shown, bad on error.
+		uint32_t map(const fd_t, memory_c&, const idx_t, const idx_t, const idx_t);
+
+		// @why: to close every file and unmap every block (end of the process): the mapped pages
+		// are given back zeroed, the copied tails are left as they are.
+		// @in: memory.
+		// @out: null.
+		void release(memory_c&);
+
+	public:
+
+		static uint32_t remove(const sandbox_c&, const path_t&);
+
+	public:
+
+		// @why: to hand a transfer to the completion thread.
+		// @in: descriptor.
+		// @out: host descriptor, -1 when it is not open.
+		int host(const fd_t) const;
+
+		// @why: to refuse a snapshot, the host descriptors and the mapped blocks can not be kept.
+		// @in: null.
+		// @out: true when no file is open and no block is mapped.
+		bool empty() const;
+
+	};
+
+}
+
+#endif
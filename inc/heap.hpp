@@ -0,0 +1,120 @@
+#ifndef Q_INC_HEAP
+#define Q_INC_HEAP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <unordered_map>
+
+#include "segments.hpp"
+
+namespace vm {
+
+	class memory_c;
+
+	// heap of a process (syscalls exc 0x4): blocks up to 2 KB come from slabs of one size class
+	// (16 to 2048 bytes), longer ones get a segment of their own; the slabs and segments are
+	// taken from the segments of the vm and all given back when the process ends
+	class heap_c {
+	public:
+
+		using idx_t   = uint32_t;
+		using count_t = uint64_t;
+		using class_t = uint8_t;
+
+		struct stats_t {
+			count_t allocs, frees;
+			count_t used, reserved;           // bytes asked by the program, bytes taken from the vm
+			count_t peak_used, peak_reserved;
+		};
+
+	public:
+
+		// result of a failed syscall
+		static constexpr uint32_t bad = 0xFFFFFFFF;
+
+		// size classes: 16 << n bytes
+		static constexpr class_t classes = 8;
+		static constexpr idx_t mblock = 0x10;
+
+		// length of a slab
+		static constexpr idx_t slab = 0x10000;
+
+	protected:
+
+		struct block_t {
+			idx_t len;   // length asked
+			class_t cls; // size class it was taken from, classes for a segment of its own
+		};
+
+		struct slabs_t {
+			std::vector<heap_c::idx_t> free; // freed blocks
+			idx_t next, end;                 // blocks never given of the last slab
+		};
+
+	protected:
+
+		slabs_t m_slabs[heap_c::classes];
+		std::vector<heap_c::idx_t> m_segments;           // slabs
+		std::unordered_map<heap_c::idx_t, heap_c::block_t> m_live; // live blocks
+		stats_t m_stats;
+
+	public:
+
+		heap_c();
+		heap_c(const heap_c&) = delete;
+		heap_c(heap_c&&) noexcept = delete;
+
+		heap_c& operator=(const heap_c&) = delete;
+		heap_c& operator=(heap_c&&) noexcept = delete;
+
+	public:
+
+		~heap_c() = default;
+
+	public:
+
+		// @why: to allocate a block.
+		// @in: segments of the vm, length.
+		// @out: address of the block, bad when there is no room.
+		uint32_t alloc(segments_c&, const idx_t);
+
+		// @why: to give a block back.
+		// @in: segments of the vm, address of the block.
+		// @out: 0, bad when it is not a block.
+		uint32_t free(segments_c&, const idx_t);
+
+		// @why: to change the length of a block, moved (with its content) when it does not fit.
+		// @in: segments of the vm, memory, address of the block, new length.
+		// @out: address of the block, bad when there is no room (the block is left as it is).
+		uint32_t resize(segments_c&, memory_c&, const idx_t, const idx_t);
+
+		// @in: address of a block.
+		// @out: length asked for it, bad when it is not a block.
+		uint32_t size(const idx_t) const;
+
+		// @why: to drop every block at once (end of the process).
+		// @in: segments of the vm.
+		// @out: null.
+		void release(segments_c&);
+
+		const stats_t& stats() const;
+
+		// @why: to know how much of the memory taken from the vm was not asked by the program.
+		// @in: null.
+		// @out: 1 - peak used / peak reserved, 0 when the heap was never used.
+		double fragmentation() const;
+
+	protected:
+
+		// @in: length.
+		// @out: size class of the length, classes when a segment is needed.
+		static class_t size_class(const idx_t);
+
+		void reserve(const count_t);
+
+	};
+
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef Q_INC_HEX
+#define Q_INC_HEX
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "bulk.hpp" // Q_SIMD
+
+namespace vm {
+
+	// decoder of the hex programs: every hex digit is kept and every other character ignored, the
+	// digits pair up in order (a byte may span a line break, a last odd digit is dropped); blocks
+	// of the text are classified and compacted by SSSE3 kernels (shuffles from a table of the
+	// digit masks), large texts are split in parts counted then decoded by several threads
+	class hex_c {
+	public:
+
+		using loc_t = uint8_t;
+
+		enum class isa_e : uint8_t {
+			SCALAR = 0x00,
+			SSSE3  = 0x01,
+		};
+
+		// slice of the text decoded by one thread
+		struct part_t {
+			const char* src;
+			size_t len;
+			size_t digits; // in the part
+			size_t first;  // digits before the part
+			uint8_t head;  // first digit, when it ends a byte started by a previous part
+			uint8_t tail;  // last digit, when it starts a byte ended by a next part
+		};
+
+	public:
+
+		// shortest part given to a thread (4 Mb of text)
+		static constexpr size_t dpart = 0x00400000;
+
+	public:
+
+		hex_c() = delete;
+
+	public:
+
+		static isa_e isa();
+		static const char* name(const isa_e);
+
+		// @why: to know the length of the decoded text.
+		// @in: text, length.
+		// @out: number of hex digits.
+		static size_t count(const char*, const size_t);
+
+		// @why: to decode a whole text, the destination is sized once from the digits counted.
+		// @in: text, length, destination, threads (0: one per core, only texts of several parts
+		// use more than one).
+		// @out: null.
+		static void parse(const char*, const size_t, std::vector<loc_t>&, const uint32_t = 0);
+
+	protected:
+
+		// @why: to decode one part (digits and first are set): the bytes it holds entirely are
+		// written, its head and tail are kept for the byte shared with its neighbours.
+		// @in: part, destination of the whole text.
+		// @out: null.
+		static void part(part_t&, loc_t*);
+
+	};
+
+}
+
+#endif
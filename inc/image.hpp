@@ -0,0 +1,122 @@
+#ifndef Q_INC_IMAGE
+#define Q_INC_IMAGE
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace vm {
+
+	// program image: a binary file (header, code and data sections) or a legacy hex text
+	class image_c {
+	public:
+
+		using loc_t     = uint8_t;
+		using len_t     = uint32_t;
+		using sum_t     = uint32_t;
+		using version_t = uint16_t;
+		using path_t    = std::string;
+
+		// flags of the header
+		enum class flag_e : uint16_t {
+			CHECKSUM = 0x0001, // sum covers the code and data sections
+		};
+
+		// file header, stored in little-endian
+		struct header_t {
+			uint32_t magic;
+			version_t version;
+			uint16_t flags;
+			len_t code;  // length of the code section
+			len_t data;  // length of the data section
+			sum_t sum;   // FNV-1a of code + data
+			uint32_t reserved[3];
+		};
+
+	public:
+
+		static constexpr uint32_t magic = 0x494D5651; // "QVMI"
+		static constexpr version_t version = 0x0001;
+		static constexpr size_t hlen = 0x20; // length of the header
+
+	protected:
+
+		loc_t* m_map;             // mapped file
+		size_t m_size;
+		std::vector<loc_t> m_buf; // bytes of a hex text (or of a file that can not be mapped)
+
+		const loc_t* m_code;
+		len_t m_clen;
+		const loc_t* m_data;
+		len_t m_dlen;
+
+	public:
+
+		image_c();
+		image_c(const image_c&) = delete;
+		image_c(image_c&&) noexcept = delete;
+
+		image_c& operator=(const image_c&) = delete;
+		image_c& operator=(image_c&&) noexcept = delete;
+
+	public:
+
+		~image_c();
+
+	public:
+
+		// @why: to load a program, the format is detected from the first bytes.
+		// @in: path of a binary image or of a hex text.
+		// @out: true when the program can be started.
+		bool load(const path_t);
+
+		// @why: to load a program held by the host (embedding), the format is detected as above.
+		// @in: binary image or hex text, its length (a binary image is not copied: the buffer has
+		// to outlive the image).
+		// @out: true when the program can be started.
+		bool load(const loc_t*, const size_t);
+
+		// @why: to read a hex text (every non-hex character is ignored).
+		// @in: text and its length.
+		// @out: null.
+		void parse(const char*, const size_t);
+
+		// @why: to write the program as a binary image.
+		// @in: path of the image, true to store a checksum.
+		// @out: true on success.
+		bool save(const path_t, const bool = true) const;
+
+		void close();
+
+	public:
+
+		const loc_t* code() const;
+		len_t code_length() const;
+
+		const loc_t* data() const;
+		len_t data_length() const;
+
+	public:
+
+		static sum_t checksum(const loc_t*, const size_t, sum_t = 0x811C9DC5);
+
+		// @why: to convert a legacy hex program to a binary image.
+		// @in: source (hex text), destination (binary image).
+		// @out: true on success.
+		static bool convert(const path_t, const path_t);
+
+	protected:
+
+		// @why: to validate the header of a binary image.
+		// @in: first byte of the image (m_size long), path used by the messages.
+		// @out: true when the sections are usable.
+		bool open(const loc_t*, const path_t);
+
+		bool map(const path_t);
+
+	};
+
+}
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef Q_INC_IO
+#define Q_INC_IO
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <istream>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace vm {
+
+	class process_c;
+
+	// completion thread of the blocking syscalls: a process issuing one is parked, the request is
+	// served here while the vm keeps running the others, the process is queued again with the result
+	class io_c {
+	public:
+
+		enum class kind_e : uint8_t {
+			CHAR  = 0x00, // console line, first char
+			UINT  = 0x01, // console unsigned integer number
+			INT   = 0x02, // console signed integer number
+			FLOAT = 0x03, // console floating point number
+			LINE  = 0x04, // console line
+			READ  = 0x05, // file to buffer
+			WRITE = 0x06, // buffer to file
+		};
+
+		struct request_t {
+			process_c* prc;
+			kind_e kind;
+			std::istream* in; // console input
+			int fd;           // host descriptor of the file transfers
+			uint32_t addr;    // guest address of a read
+			std::string buf;  // bytes read or written, line read
+			uint32_t val;     // result, given back in x0
+		};
+
+		using requests_t = std::vector<io_c::request_t>;
+
+	protected:
+
+		std::thread m_thread; // started by the first request
+		std::mutex m_lock;
+		std::condition_variable m_wake; // a request is queued
+		std::condition_variable m_done; // a request is completed
+		std::deque<io_c::request_t> m_queue;
+		io_c::requests_t m_results;
+		size_t m_pending; // submitted, not collected yet (owner thread only)
+		bool m_stop;
+
+	public:
+
+		io_c();
+		io_c(const io_c&) = delete;
+		io_c(io_c&&) noexcept = delete;
+
+		io_c& operator=(const io_c&) = delete;
+		io_c& operator=(io_c&&) noexcept = delete;
+
+	public:
+
+		~io_c();
+
+	public:
+
+		// @why: to serve a request without blocking the caller.
+		// @in: request, its process is parked until it is collected.
+		// @out: null.
+		void submit(io_c::request_t&&);
+
+		// @why: to take the completed requests.
+		// @in: list receiving them, true to wait for one when none is completed.
+		// @out: number of requests taken.
+		size_t collect(io_c::requests_t&, const bool);
+
+		size_t pending() const;
+
+	protected:
+
+		void work();
+
+		static void complete(io_c::request_t&);
+
+	};
+
+}
+
+#endif
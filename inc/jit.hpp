@@ -0,0 +1,93 @@
+#ifndef Q_INC_JIT
+#define Q_INC_JIT
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#if defined(__x86_64__) && !defined(_WIN32) && (defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__))
+#define Q_JIT // System V x86-64 with mmap
+#endif
+
+namespace vm {
+
+	class core_c;
+	class memory_c;
+
+	class jit_c {
+	public:
+
+		using reg32_t = uint32_t;
+		using idx_t   = uint32_t;
+		using fuel_t  = int64_t;
+
+		// native block: takes the registers and the instructions left to the slice
+		// (decreased by the instructions it retires), returns the index of the next instruction
+		using block_t = idx_t (*)(reg32_t*, fuel_t*);
+
+	public:
+
+		// default number of taken jumps before a block is compiled
+		static constexpr uint32_t dhot = 0x00000040;
+
+		// default size of the executable buffer (4 Mb)
+		static constexpr size_t dlen = 0x00400000;
+
+		// maximum number of instructions in a block
+		static constexpr idx_t mlen = 0x00000100;
+
+	protected:
+
+		uint8_t* m_buf;
+		size_t m_len, m_pos;
+		uint32_t m_hot;
+		bool m_on;
+		size_t m_count;
+
+	public:
+
+		explicit jit_c(uint32_t = 0);
+		jit_c(const jit_c&) = delete;
+		jit_c(jit_c&&) noexcept = delete;
+
+		jit_c& operator=(const jit_c&) = delete;
+		jit_c& operator=(jit_c&&) noexcept = delete;
+
+	public:
+
+		~jit_c();
+
+	public:
+
+		// @why: to know if this host can run native blocks.
+		// @in: null.
+		// @out: true on x86-64 System V hosts.
+		static bool supported();
+
+		void enable(const bool);
+		bool enabled() const;
+
+		// @why: to know when a jump target becomes hot.
+		// @in: null.
+		// @out: number of taken jumps, 0 when the jit is disabled.
+		uint32_t threshold() const;
+
+		size_t blocks() const;
+
+	public:
+
+		// @why: to reuse the buffer once no process runs a block anymore.
+		// @in: null.
+		// @out: null.
+		void reset();
+
+		// @why: to translate the block starting at an instruction to native code.
+		// @in: memory, code segment (csx, clx), index of the first instruction.
+		// @out: the block, null when it can not run natively.
+		block_t compile(memory_c&, const reg32_t, const reg32_t, const idx_t);
+
+	};
+
+}
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef Q_INC_PROFILE
+#define Q_INC_PROFILE
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace vm {
+
+	class process_c;
+	class memory_c;
+
+	// execution profile of a process, counted on the transfers of control only: a straight run
+	// from an entry to a leave executes every instruction in between once, so the counts of every
+	// code address are rebuilt at the end (the opcodes are read back from the code segment)
+	class profile_c {
+	public:
+
+		using idx_t   = uint32_t;
+		using count_t = uint64_t;
+		using path_t  = std::string;
+
+	public:
+
+		// number of basic blocks in the report
+		static constexpr size_t mblocks = 0x10;
+
+	protected:
+
+		// one slot per instruction, plus the end of the code
+		std::vector<profile_c::count_t> m_enter; // reached other than from the previous instruction
+		std::vector<profile_c::count_t> m_leave; // run stopped after the instruction (end of a slice...)
+		std::vector<profile_c::count_t> m_taken; // control left the instruction for another one
+		std::map<uint64_t, profile_c::count_t> m_sys; // (exc << 32) | sx
+
+	public:
+
+		// @in: length of the code segment.
+		explicit profile_c(const idx_t);
+		profile_c(const profile_c&) = delete;
+		profile_c(profile_c&&) noexcept = delete;
+
+		profile_c& operator=(const profile_c&) = delete;
+		profile_c& operator=(profile_c&&) noexcept = delete;
+
+	public:
+
+		~profile_c() = default;
+
+	public:
+
+		// @why: to count a transfer of control.
+		// @in: index of the instruction (in the code segment) reached, left, or left by a jump.
+		// @out: null.
+		void enter(const idx_t);
+		void leave(const idx_t);
+		void take(const idx_t);
+
+		void syscall(const uint32_t, const uint32_t);
+
+		// @why: to write the profile once the process ended, one json object per line.
+		// @in: file (appended), process, memory holding its code segment.
+		// @out: false when the file can not be written.
+		bool write(const path_t&, const process_c&, memory_c&) const;
+
+	public:
+
+		static const char* name(const uint8_t);
+
+	protected:
+
+		std::string json(const process_c&, memory_c&) const;
+
+		// @why: to rebuild the number of executions of every instruction.
+		// @in: null.
+		// @out: one count per instruction.
+		std::vector<profile_c::count_t> counts() const;
+
+	};
+
+}
+
+namespace vm { /* profile_c fast path */
+
+	inline void profile_c::enter(const idx_t val) {
+		++m_enter[val];
+	}
+
+	inline void profile_c::leave(const idx_t val) {
+		++m_leave[val];
+	}
+
+	inline void profile_c::take(const idx_t val) {
+		++m_taken[val];
+	}
+
+}
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef Q_INC_RUNTIME
+#define Q_INC_RUNTIME
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "vm.hpp"
+
+namespace vm {
+
+	// worker threads running independent processes: every worker owns a vm_c (memory, registers,
+	// jit) and a deque of processes not started yet, an idle worker steals from the others
+	class runtime_c {
+	public:
+
+		using count_t  = uint32_t;
+		using idx_t    = memory_c::idx_t;
+		using duration = std::chrono::steady_clock::duration;
+
+		struct stats_t {
+			uint64_t processes; // ended processes
+			uint64_t retired;   // instructions retired by them
+			uint64_t steals;    // processes taken from another worker
+			duration elapsed;
+		};
+
+	public:
+
+		// maximum number of workers (each one reserves the memory of its vm)
+		static constexpr count_t mworkers = 0x100;
+
+	protected:
+
+		struct worker_t {
+			std::mutex lock; // guards jobs, never taken while a process runs
+			std::deque<process_c*> jobs;
+			std::unique_ptr<vm_c> vm;
+			uint64_t processes, retired, steals;
+		};
+
+	protected:
+
+		std::vector<std::unique_ptr<worker_t>> m_workers;
+		size_t m_next; // worker receiving the next pushed process
+		process_c::id_t m_ids;
+
+	public:
+
+		// @in: number of workers (0: one per core, at most mworkers), length of the memory of every worker.
+		explicit runtime_c(count_t = 0, idx_t = 0);
+		runtime_c(const runtime_c&) = delete;
+		runtime_c(runtime_c&&) noexcept = delete;
+
+		runtime_c& operator=(const runtime_c&) = delete;
+		runtime_c& operator=(runtime_c&&) noexcept = delete;
+
+	public:
+
+		~runtime_c();
+
+	public:
+
+		count_t workers() const;
+
+		// @why: to queue a loaded process (workers get them in turn).
+		// @in: process, owned by the runtime from now on.
+		// @out: null.
+		void push(process_c*);
+
+		// @why: to run every queued process, one thread per worker.
+		// @in: null.
+		// @out: totals of the workers.
+		stats_t run();
+
+	public:
+
+		static count_t cores();
+
+	protected:
+
+		void work(const size_t);
+
+		// @why: to find the next process of a worker.
+		// @in: index of the worker.
+		// @out: newest own process, else the oldest one of another worker, null when none is left.
+		process_c* take(const size_t);
+
+	};
+
+}
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef Q_INC_SAMPLER
+#define Q_INC_SAMPLER
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+
+namespace vm {
+
+	class process_c;
+	class memory_c;
+
+	// sampling profiler: a watchdog thread raises a flag at a fixed interval, the engine running
+	// a process takes the flag and counts its current code address (at the next taken jump or
+	// native block exit, every step with the reference engine)
+	class sampler_c {
+	public:
+
+		using idx_t     = uint32_t;
+		using count_t   = uint64_t;
+		using path_t    = std::string;
+		using interval  = std::chrono::microseconds;
+		using samples_t = std::unordered_map<idx_t, count_t>; // offset in the code segment
+
+	public:
+
+		// default interval between two samples
+		static constexpr interval::rep dinterval = 1000;
+
+	protected:
+
+		std::thread m_thread;
+		std::mutex m_lock;
+		std::condition_variable m_wake;
+		std::atomic<bool> m_due;
+		interval m_interval;
+		path_t m_path; // collapsed stacks, empty when off
+		bool m_stop;
+
+	public:
+
+		sampler_c();
+		sampler_c(const sampler_c&) = delete;
+		sampler_c(sampler_c&&) noexcept = delete;
+
+		sampler_c& operator=(const sampler_c&) = delete;
+		sampler_c& operator=(sampler_c&&) noexcept = delete;
+
+	public:
+
+		~sampler_c();
+
+	public:
+
+		// @why: to start sampling the processes of a vm.
+		// @in: file receiving the collapsed stacks (appended), interval (0 for the default one).
+		// @out: null.
+		void start(const path_t&, const interval);
+
+		void stop();
+		bool enabled() const;
+
+		// @why: to know if the running process has to be sampled, the flag is taken.
+		// @in: null.
+		// @out: true once per interval.
+		bool due();
+
+		// @why: to fold the samples of an ended process into flamegraph collapsed stacks, the
+		// frames are the loops around the address (backward jumps of the code segment).
+		// @in: process, memory holding its code segment.
+		// @out: false when the file can not be written.
+		bool write(const process_c&, memory_c&) const;
+
+	protected:
+
+		void work();
+
+	};
+
+}
+
+namespace vm { /* sampler_c fast path */
+
+	inline bool sampler_c::due() {
+		return m_due.load(std::memory_order_relaxed) && m_due.exchange(false, std::memory_order_relaxed);
+	}
+
+}
+
+#endif
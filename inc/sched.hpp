@@ -0,0 +1,75 @@
+#ifndef Q_INC_SCHED
+#define Q_INC_SCHED
+
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+
+namespace vm {
+
+	class process_c;
+
+	// run queues: strict priority between levels, round robin inside a level
+	class scheduler_c {
+	public:
+
+		using prio_t = uint8_t;
+		using fuel_t = int64_t;
+
+	public:
+
+		// number of priority levels (0 is the highest)
+		static constexpr prio_t levels = 0x04;
+
+		// default number of instructions of a slice
+		static constexpr fuel_t dquantum = 0x00010000;
+
+	protected:
+
+		std::deque<process_c*> m_queue[scheduler_c::levels];
+		fuel_t m_quantum;
+		size_t m_size;
+
+	public:
+
+		explicit scheduler_c(fuel_t = 0);
+		scheduler_c(const scheduler_c&) = delete;
+		scheduler_c(scheduler_c&&) noexcept = delete;
+
+		scheduler_c& operator=(const scheduler_c&) = delete;
+		scheduler_c& operator=(scheduler_c&&) noexcept = delete;
+
+	public:
+
+		~scheduler_c() = default;
+
+	public:
+
+		// @why: to make a process ready (at the end of the queue of its priority).
+		// @in: process.
+		// @out: null.
+		void push(process_c*);
+
+		// @why: to elect the next process.
+		// @in: null.
+		// @out: first process of the highest non-empty level, null when none is ready.
+		process_c* pop();
+
+		// @why: to take a ready process out of its queue (its priority changed).
+		// @in: process.
+		// @out: false when it is not queued.
+		bool erase(process_c*);
+
+		bool empty() const;
+		size_t size() const;
+
+	public:
+
+		fuel_t quantum() const;
+		void quantum(const fuel_t);
+
+	};
+
+}
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef Q_INC_SEGMENTS
+#define Q_INC_SEGMENTS
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <random>
+#include <unordered_map>
+
+namespace vm {
+
+	// buddy allocator of the segments (code and data, stacks) of the processes in the memory of a
+	// vm: blocks of 2^n bytes, one free list per order, a freed block merges with its buddy, so
+	// allocating and freeing take at most one step per order
+	class segments_c {
+	public:
+
+		using idx_t   = uint32_t;
+		using order_t = uint8_t;
+
+	public:
+
+		// no segment
+		static constexpr idx_t none = 0xFFFFFFFF;
+
+		// smallest segment (16 bytes), largest one (2 GB)
+		static constexpr order_t morder = 4;
+		static constexpr order_t xorder = 31;
+
+	protected:
+
+		struct slot_t {
+			uint32_t pos;  // in the free list
+			order_t order;
+		};
+
+	protected:
+
+		std::vector<segments_c::idx_t> m_free[segments_c::xorder + 1]; // free blocks of every order
+		std::unordered_map<segments_c::idx_t, segments_c::slot_t> m_slots; // free block to its slot
+		std::unordered_map<segments_c::idx_t, segments_c::order_t> m_used;  // allocated segments
+		idx_t m_len;
+		bool m_fixed; // deterministic placement
+		std::minstd_rand m_rng;
+
+	public:
+
+		// @in: length of the memory.
+		explicit segments_c(const idx_t = 0);
+		segments_c(const segments_c&) = delete;
+		segments_c(segments_c&&) noexcept = delete;
+
+		segments_c& operator=(const segments_c&) = delete;
+		segments_c& operator=(segments_c&&) noexcept = delete;
+
+	public:
+
+		~segments_c() = default;
+
+	public:
+
+		// @why: to free every segment.
+		// @in: length of the memory.
+		// @out: null.
+		void reset(const idx_t);
+
+		// @why: to allocate a segment.
+		// @in: length in bytes.
+		// @out: address of the segment (aligned on its length rounded up to a power of 2), none
+		// when there is no room.
+		idx_t alloc(const idx_t);
+
+		// @why: to give a segment back.
+		// @in: address of the segment.
+		// @out: false when it is not a segment.
+		bool free(const idx_t);
+
+		// @why: to allocate the segment at a given address (segments of a snapshot).
+		// @in: address, length in bytes.
+		// @out: false when the address is not free or not aligned.
+		bool claim(const idx_t, const idx_t);
+
+		// @why: to choose the placement: the last freed block of the order, from the top of the
+		// memory (deterministic, for reproducible runs), or any free block of the order.
+		// @in: true for the deterministic placement.
+		// @out: null.
+		void fixed(const bool);
+
+		// @in: address of a segment.
+		// @out: its length (power of 2), 0 when it is not a segment.
+		idx_t length(const idx_t) const;
+
+		size_t used() const;
+
+	protected:
+
+		// @in: length in bytes.
+		// @out: order of the smallest block holding it, xorder + 1 when too long.
+		static order_t order(const idx_t);
+
+		void push(const idx_t, const order_t);
+		void remove(const idx_t);
+
+	};
+
+}
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef Q_INC_SNAPSHOT
+#define Q_INC_SNAPSHOT
+
+#include <cstdint>
+
+#include "vm.hpp"
+
+namespace vm {
+
+	// frozen vm: guest memory in a sealed memory file and the state of its process,
+	// every vm forked from it shares the unmodified pages
+	class snapshot_c {
+	public:
+
+		using idx_t  = memory_c::idx_t;
+		using prio_t = process_c::prio_t;
+
+	protected:
+
+		int m_fd;
+		idx_t m_len; // length of the memory
+		idx_t m_clen;  // length of the code segment
+		idx_t m_stack; // stack segment, segments_c::none when none
+		idx_t m_slen;
+
+		// process
+		core_c m_state;
+		int32_t m_ec;
+		prio_t m_priority;
+		uint64_t m_retired;
+		idx_t m_base;
+		idx_t m_limit;
+
+	public:
+
+		snapshot_c();
+		snapshot_c(const snapshot_c&) = delete;
+		snapshot_c(snapshot_c&&) noexcept = delete;
+
+		snapshot_c& operator=(const snapshot_c&) = delete;
+		snapshot_c& operator=(snapshot_c&&) noexcept = delete;
+
+	public:
+
+		~snapshot_c();
+
+	public:
+
+		bool valid() const;
+
+		// @why: to freeze a memory and a process (the previous snapshot is dropped).
+		// @in: memory, process, segments of the vm.
+		// @out: false when the memory can not be saved.
+		bool take(const memory_c&, const process_c&, const segments_c&);
+
+		// @why: to give a memory the pages of the snapshot.
+		// @in: memory.
+		// @out: false when the pages can not be mapped.
+		bool map(memory_c&) const;
+
+		// @why: to give a process the state of the frozen one.
+		// @in: process.
+		// @out: null.
+		void restore(process_c&) const;
+
+		// @why: to allocate the segments of the frozen process in a forked vm.
+		// @in: segments of the vm (reset), process restored from the snapshot.
+		// @out: false when a segment can not be allocated.
+		bool claim(segments_c&, process_c&) const;
+
+		void close();
+
+	};
+
+}
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef Q_INC_VERIFY
+#define Q_INC_VERIFY
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace vm {
+
+	// load time analysis of a code segment: the instructions reachable from the entry (through
+	// the fall through and the immediate targets of jit/jif) must have a known opcode, valid
+	// register operands and targets on an instruction of the segment; a program passing it with
+	// no dynamic transfer (register target, write to csx, ipx or clx) or with every instruction
+	// valid is verified and runs without checking every fetch
+	class verifier_c {
+	public:
+
+		using idx_t = uint32_t;
+		using loc_t = uint8_t;
+
+		// basic block of the control flow graph (offsets in the code segment)
+		struct block_t {
+			idx_t beg, len;
+			idx_t next;   // fall through, none at the end of the code
+			idx_t target; // immediate jump target, none without one
+		};
+
+	public:
+
+		// no block
+		static constexpr idx_t none = 0xFFFFFFFF;
+
+	protected:
+
+		std::vector<verifier_c::block_t> m_blocks;
+		std::string m_error;  // first invalid instruction reachable from the entry
+		idx_t m_length;       // of the code segment
+		idx_t m_reachable;    // instructions
+		bool m_verified;
+		bool m_dynamic;
+
+	public:
+
+		verifier_c();
+		verifier_c(const verifier_c&) = delete;
+		verifier_c(verifier_c&&) noexcept = delete;
+
+		verifier_c& operator=(const verifier_c&) = delete;
+		verifier_c& operator=(verifier_c&&) noexcept = delete;
+
+	public:
+
+		~verifier_c() = default;
+
+	public:
+
+		// @why: to analyse a code segment.
+		// @in: code, length (multiple of 4).
+		// @out: false when an instruction reachable from the entry is invalid.
+		bool run(const loc_t*, const idx_t);
+
+		bool verified() const;
+		bool dynamic() const;
+		idx_t reachable() const;
+		const std::string& error() const;
+		const std::vector<verifier_c::block_t>& blocks() const;
+
+		// @why: to show the analysis (qvm verify).
+		// @in: null.
+		// @out: one json object.
+		std::string json() const;
+
+	public:
+
+		// @why: to check one instruction.
+		// @in: instruction, length of the code segment.
+		// @out: null when valid, the reason otherwise.
+		static const char* check(const loc_t*, const idx_t);
+
+		// @in: instruction.
+		// @out: offset of its immediate jump target, none without one.
+		static idx_t target(const loc_t*);
+
+		// @in: instruction.
+		// @out: true when it can move ipx elsewhere than to an immediate target.
+		static bool transfer(const loc_t*);
+
+	};
+
+}
+
+#endif
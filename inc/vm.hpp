@@ -1,253 +1,778 @@
-#ifndef Q_INC_VM
-#define Q_INC_VM
-
-#include <cstdint>
-#include <xstring>
-#include <chrono>
-
-namespace vm {
-
-	class exception_c {
-	public:
-
-		using msg_t = std::string;
-
-	protected:
-
-		msg_t m_msg;
-
-	public:
-
-		explicit exception_c(msg_t);
-		exception_c() = delete;
-		exception_c(const exception_c&);
-		exception_c(exception_c&&) noexcept;
-
-		exception_c& operator=(const exception_c&);
-		exception_c& operator=(exception_c&&) noexcept;
-
-	public:
-
-		~exception_c() = default;
-
-	public:
-
-		msg_t get() const;
-
-	public:
-
-		msg_t& get();
-
-	};
-
-	class core_c {
-	public:
-
-		using reg8_t  = uint8_t;
-		using reg16_t = uint16_t;
-		using reg32_t = uint32_t;
-		using reg64_t = uint64_t;
-
-		// register address
-		using rega_t  = uint8_t;
-
-	public:
-
-		// numbers of x registers
-		static constexpr rega_t xregs = 0x10;
-
-	public:
-
-		reg32_t
-			/* general purpose */ x[core_c::xregs]{ 0 },
-			/* code segment    */ csx{ 0 }, ipx{ 0 }, /* length */ clx{ 0 },
-			/* stack segment   */ ssx{ 0 }, spx{ 0 }, /* length */ slx{ 0 },
-			/* memory address  */ ax{ 0 },
-			/* system flags    */ sx{ 0 },
-			/* internal flags  */ fx{ 0 }
-			;
-
-	public:
-
-		core_c() = default;
-		core_c(const core_c&);
-		core_c(core_c&&) noexcept;
-
-		core_c& operator=(const core_c&);
-		core_c& operator=(core_c&&) noexcept;
-
-	public:
-
-		~core_c() = default;
-
-	public:
-
-		// @why: to use a number as register address.
-		// @in: address of the register.
-		// @out: reference to the register at this address.
-		reg32_t& get(const rega_t);
-
-	public:
-
-		// @why: to clear current data.
-		// @in: null.
-		// @out: the last version of core.
-		core_c flush();
-
-	};
-
-	class memory_c {
-	public:
-
-		// index type
-		using idx_t = uint32_t;
-
-		// block type
-		using loc_t = uint8_t;
-
-	public:
-
-		// default number of blocks (128 Mb)
-		static constexpr idx_t dlen = 0x08000000;
-
-	protected:
-
-		loc_t* m_data;
-		idx_t m_len;
-
-	public:
-
-		explicit memory_c(idx_t = 0);
-		memory_c(const memory_c&) = delete;
-		memory_c(memory_c&&) noexcept = delete;
-
-		memory_c& operator=(const memory_c&) = delete;
-		memory_c& operator=(memory_c&&) noexcept = delete;
-
-	public:
-
-		~memory_c();
-
-	public:
-
-		idx_t length() const;
-
-	public:
-
-		// @why: to access at the protected data.
-		// @in: address of a memory location.
-		// @out: reference to the location.
-		loc_t& get(const idx_t);
-
-	};
-
-	class process_c {
-	public:
-
-		using instr_t = uint32_t;
-
-		using id_t = uint32_t;
-
-		// informations about the current state of process
-		using info_t = uint16_t;
-
-		enum class info_e : uint16_t {
-			STARTED = 0x0001, // setted when start method is called
-			ABORTED = 0x0002, // setted when an exception threw
-		};
-
-		using path_t = std::string;
-		using code_t = std::string;
-
-	public:
-
-		id_t id;
-		info_t info;
-		core_c state;
-
-	public:
-
-		explicit process_c(info_t = 0);
-		process_c(const process_c&) = delete;
-		process_c(process_c&&) noexcept = delete;
-
-		process_c& operator=(const process_c&) = delete;
-		process_c& operator=(process_c&&) noexcept = delete;
-
-	public:
-
-		~process_c() = default;
-
-	public:
-
-		code_t load(const path_t);
-
-		void start(const id_t, const memory_c::idx_t);
-
-	};
-
-	class vm_c {
-	public:
-
-		using time_point = std::chrono::system_clock::time_point;
-		using msg_t      = exception_c::msg_t;
-		using loc_t      = memory_c::loc_t;
-		using idx_t      = memory_c::idx_t;
-		using code_t     = process_c::code_t;
-		using id_t       = process_c::id_t;
-		using instr_t    = process_c::instr_t;
-
-		using version_t  = uint32_t;
-		using ecode_t    = int32_t;
-
-	protected:
-
-		version_t m_ver;
-
-		core_c m_state;
-		memory_c m_memory;
-		time_point m_start;
-
-		process_c* m_prc;
-		code_t m_code;
-
-		ecode_t m_ec; // exit code
-
-	public:
-
-		explicit vm_c(idx_t = 0);
-		vm_c(const vm_c&) = delete;
-		vm_c(vm_c&&) noexcept = delete;
-
-		vm_c& operator=(const vm_c&) = delete;
-		vm_c& operator=(vm_c&&) noexcept = delete;
-
-	public:
-
-		~vm_c() = default;
-
-	public:
-
-		int32_t start();
-
-	protected: // engine
-
-		int32_t engine(const loc_t, const loc_t, const loc_t, const loc_t);
-		int32_t execute(const uint32_t);
-		bool throw_if(const bool, const msg_t);
-
-		void compare(const uint32_t, const uint32_t);
-
-	protected: // user interface
-
-		void show_regs();
-		void show_stack();
-		int32_t view(const uint8_t);
-		int32_t menu();
-
-	};
-
-}
-
-#endif
-
+#ifndef Q_INC_VM
+#define Q_INC_VM
+
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include <string>
+#include <chrono>
+#include <vector>
+#include <functional>
+#include <memory>
+
+#include "decode.hpp"
+#include "image.hpp"
+#include "jit.hpp"
+#include "sched.hpp"
+#include "console.hpp"
+#include "files.hpp"
+#include "io.hpp"
+#include "profile.hpp"
+#include "sampler.hpp"
+#include "segments.hpp"
+#include "heap.hpp"
+#include "verify.hpp"
+#include "aot.hpp"
+
+namespace vm {
+
+	class snapshot_c;
+	class cache_c;
+
+	class exception_c {
+	public:
+
+		using msg_t = std::string;
+
+	protected:
+
+		msg_t m_msg;
+
+	public:
+
+		explicit exception_c(msg_t);
+		exception_c() = delete;
+		exception_c(const exception_c&);
+		exception_c(exception_c&&) noexcept;
+
+		exception_c& operator=(const exception_c&);
+		exception_c& operator=(exception_c&&) noexcept;
+
+	public:
+
+		~exception_c() = default;
+
+	public:
+
+		msg_t get() const;
+
+	public:
+
+		msg_t& get();
+
+	};
+
+	// register file: one contiguous, cache line aligned array indexed by the register address,
+	// the named registers are accessors of the same array
+	class alignas(64) core_c {
+	public:
+
+		using reg8_t  = uint8_t;
+		using reg16_t = uint16_t;
+		using reg32_t = uint32_t;
+		using reg64_t = uint64_t;
+
+		// register address
+		using rega_t  = uint8_t;
+
+	public:
+
+		// numbers of x registers
+		static constexpr rega_t xregs = 0x10;
+
+		// numbers of registers (x, then the special ones up to fx)
+		static constexpr rega_t nregs = core_c::xregs + 9;
+
+		// slot given for an invalid register address (two cache lines, the tail is unused)
+		static constexpr rega_t scratch = 0x1F;
+
+	public:
+
+		// x1..x16, then csx, ipx, clx (code segment), ssx, spx, slx (stack segment), ax (memory
+		// address), sx (system flags), fx (internal flags)
+		reg32_t r[core_c::scratch + 1]{ 0 };
+
+	public:
+
+		// trivially copyable: copying a state (context switch, flush) is one memcpy
+		core_c() = default;
+		core_c(const core_c&) = default;
+		core_c(core_c&&) noexcept = default;
+
+		core_c& operator=(const core_c&) = default;
+		core_c& operator=(core_c&&) noexcept = default;
+
+	public:
+
+		~core_c() = default;
+
+	public:
+
+		// @why: to use a number as register address (the decoders reject the invalid ones).
+		// @in: address of the register.
+		// @out: reference to the register at this address, the scratch slot when invalid.
+		reg32_t& get(const rega_t);
+
+	public:
+
+		// named registers (x by index, unchecked)
+		reg32_t& x(const rega_t);
+		reg32_t& csx();
+		reg32_t& ipx();
+		reg32_t& clx();
+		reg32_t& ssx();
+		reg32_t& spx();
+		reg32_t& slx();
+		reg32_t& ax();
+		reg32_t& sx();
+		reg32_t& fx();
+
+		reg32_t x(const rega_t) const;
+		reg32_t csx() const;
+		reg32_t ipx() const;
+		reg32_t clx() const;
+		reg32_t ssx() const;
+		reg32_t spx() const;
+		reg32_t slx() const;
+		reg32_t ax() const;
+		reg32_t sx() const;
+		reg32_t fx() const;
+
+	public:
+
+		// @why: to clear current data.
+		// @in: null.
+		// @out: the last version of core.
+		core_c flush();
+
+	};
+
+	class memory_c {
+	public:
+
+		// index type
+		using idx_t = uint32_t;
+
+		// block type
+		using loc_t = uint8_t;
+
+	public:
+
+		// default number of blocks (128 Mb)
+		static constexpr idx_t dlen = 0x08000000;
+
+	protected:
+
+		loc_t* m_data;
+		idx_t m_len;
+
+		uint64_t m_faults; // out of range accesses
+		idx_t m_fault;     // last faulting address
+
+	public:
+
+		explicit memory_c(idx_t = 0);
+		memory_c(const memory_c&) = delete;
+		memory_c(memory_c&&) noexcept = delete;
+
+		memory_c& operator=(const memory_c&) = delete;
+		memory_c& operator=(memory_c&&) noexcept = delete;
+
+	public:
+
+		~memory_c();
+
+	public:
+
+		idx_t length() const;
+
+		// @why: to validate a block once, before unchecked accesses.
+		// @in: address, length.
+		// @out: true when the whole block is inside the memory.
+		bool valid(const idx_t, const idx_t = 1) const;
+
+		uint64_t faults() const;
+		idx_t fault() const;
+
+	public:
+
+		// @why: to access at the protected data.
+		// @in: address of a memory location.
+		// @out: reference to the location, to a scratch location reading zero when the address
+		// is out of range (counted as a fault).
+		loc_t& get(const idx_t);
+
+		// @why: to access an address already validated (unchecked).
+		// @in: address of a memory location.
+		// @out: reference to the location.
+		loc_t& at(const idx_t);
+
+		// @why: to read a block with one bounds check.
+		// @in: address, length.
+		// @out: first location of the block, null when the block does not fit.
+		const loc_t* span(const idx_t, const idx_t) const;
+
+		// @why: to move 16/32-bit little-endian values with one bounds check.
+		// @in: address, value.
+		// @out: false (and a fault) when the value does not fit.
+		bool load16(const idx_t, uint16_t&);
+		bool load32(const idx_t, uint32_t&);
+		bool store16(const idx_t, const uint16_t);
+		bool store32(const idx_t, const uint32_t);
+
+		// @why: to run the bulk instructions with the host kernels (see bulk_c).
+		// @in: addresses, length (and the value of a fill).
+		// @out: false (and a fault, nothing is changed) when a block crosses the end of the memory.
+		bool move(const idx_t, const idx_t, const idx_t);
+		bool fill(const idx_t, const loc_t, const idx_t);
+		bool compare(const idx_t, const idx_t, const idx_t, int32_t&);
+
+		// @why: to write a whole block with one bounds check.
+		// @in: destination address, source, length.
+		// @out: false when the block does not fit.
+		bool copy(const idx_t, const loc_t*, const idx_t);
+
+	public:
+
+		// @why: to save the memory in a file, pages never written are left as holes.
+		// @in: file descriptor (of the length of the memory).
+		// @out: false when the file can not be written.
+		bool dump(const int) const;
+
+		// @why: to start from the pages of a file, they are shared until written (copy-on-write).
+		// @in: file descriptor, length of the memory.
+		// @out: false when the file can not be mapped (the memory is left unchanged).
+		bool fork(const int, const idx_t);
+
+		// @why: to show a host file in the memory without copying it (private pages: the file is
+		// never written).
+		// @in: file descriptor, address and length (page aligned), offset in the file (page aligned).
+		// @out: false when the block is not inside the memory or can not be mapped.
+		bool map(const int, const idx_t, const idx_t, const uint64_t);
+
+		// @why: to give back zero-filled pages in place of a mapped file.
+		// @in: address and length of a mapped block.
+		// @out: null.
+		void unmap(const idx_t, const idx_t);
+
+		// @why: to start again from a zeroed memory without allocating another one (only the
+		// pages touched since cost anything).
+		// @in: null.
+		// @out: null.
+		void clear();
+
+		static idx_t page();
+
+	protected:
+
+		loc_t& miss(const idx_t);
+
+	};
+
+	class process_c {
+	public:
+
+		using instr_t = uint32_t;
+
+		using id_t = uint32_t;
+
+		// informations about the current state of process
+		using info_t = uint16_t;
+
+		enum class info_e : uint16_t {
+			STARTED = 0x0001, // setted when start method is called
+			ABORTED = 0x0002, // setted when an exception threw
+			READY   = 0x0004, // setted while the process waits in the scheduler
+			RUNNING = 0x0008, // setted while the process owns the engine
+			BLOCKED = 0x0010, // setted while the process waits for a syscall
+		};
+
+		// scheduling level, 0 is the highest
+		using prio_t = uint8_t;
+
+		using path_t = std::string;
+		using loc_t  = image_c::loc_t;
+		using code_t = image_c;
+		using time_point = std::chrono::system_clock::time_point;
+		using duration   = std::chrono::steady_clock::duration;
+
+	public:
+
+		id_t id;
+		info_t info;
+		prio_t priority;
+		core_c state;
+		code_t image;
+		program_c prog; // pre-decoded code segment and its native blocks
+		console_c console;
+		files_c files;  // files opened by the syscalls exc 0x3
+		heap_c heap;    // blocks allocated by the syscalls exc 0x4
+		std::unique_ptr<profile_c> profile; // null unless the vm profiles
+		std::unique_ptr<aot_c> aot;         // compiled program, null unless one is linked
+		sampler_c::samples_t samples;       // filled while the vm samples
+		path_t name; // program, as loaded
+
+		int32_t ec;        // exit code
+		uint64_t retired;  // instructions executed
+		uint64_t faults;   // out of range memory accesses
+		duration cpu;      // time spent in the engine
+		time_point beg;
+		memory_c::idx_t base;  // address where the code segment was placed
+		memory_c::idx_t limit; // end of the code segment when the process started (last fetch)
+		memory_c::idx_t stack; // stack segment, segments_c::none until slx is written
+		bool verified; // the reference engine fetches its code without checks (see verifier_c)
+
+	public:
+
+		explicit process_c(info_t = 0);
+		process_c(const process_c&) = delete;
+		process_c(process_c&&) noexcept = delete;
+
+		process_c& operator=(const process_c&) = delete;
+		process_c& operator=(process_c&&) noexcept = delete;
+
+	public:
+
+		~process_c() = default;
+
+	public:
+
+		// @why: to read the program (binary image or hex text) and verify its code.
+		// @in: path of the program, cache of the loaded programs (null: none).
+		// @out: false when the program can not be started (or an invalid instruction is reachable).
+		bool load(const path_t, cache_c* = nullptr);
+
+		// @why: to read a program held by the host (see vm_c::load).
+		// @in: binary image or hex text, its length.
+		// @out: false when the program can not be started.
+		bool load(const loc_t*, const size_t);
+
+		// @why: to run a compiled program (qvm aot) in place of the interpreters.
+		// @in: path of the shared object, built for the loaded code.
+		// @out: false when it can not be loaded or does not match the code.
+		bool link(const path_t);
+
+		// @why: to give an id and a code segment to a loaded process.
+		// @in: id, address of the code segment.
+		// @out: null.
+		void start(const id_t, const memory_c::idx_t);
+
+	protected:
+
+		// @why: to accept the code of a loaded image (multiple of an instruction, verified).
+		// @in: path of the program, used by the messages.
+		// @out: null, throws when the program can not be started.
+		void check(const path_t);
+
+	};
+
+	class vm_c {
+	public:
+
+		using time_point = std::chrono::system_clock::time_point;
+		using msg_t      = exception_c::msg_t;
+		using loc_t      = memory_c::loc_t;
+		using idx_t      = memory_c::idx_t;
+		using code_t     = process_c::code_t;
+		using id_t       = process_c::id_t;
+		using instr_t    = process_c::instr_t;
+
+		using version_t  = uint32_t;
+		using ecode_t    = int32_t;
+
+		// called with every ended process, in place of the console report
+		using report_t   = std::function<void(const process_c&)>;
+
+		// output of the embedded program (see attach)
+		using sink_t     = console_c::sink_t;
+
+		enum class engine_e : uint8_t {
+			REFERENCE = 0x00, // vm_c::engine, one switch per step
+			THREADED  = 0x01, // pre-decoded program, threaded dispatch (interpret only)
+			JIT       = 0x02, // threaded dispatch, hot blocks compiled to native code
+		};
+
+	protected:
+
+		version_t m_ver;
+
+		core_c m_state;
+		memory_c m_memory;
+		time_point m_start;
+
+		process_c* m_prc;
+
+		engine_e m_mode;
+		jit_c m_jit;
+
+		scheduler_c m_sched;
+		std::vector<process_c*> m_staged; // loaded, not started yet
+		id_t m_ids;
+		segments_c m_segments; // code and stack segments of the processes
+
+		report_t m_report;
+		sandbox_c m_sandbox; // directory of the file syscalls
+		io_c m_io; // blocking syscalls of the parked processes
+		profile_c::path_t m_profile; // file of the profiles, empty when off
+		sampler_c m_sampler;
+
+		ecode_t m_ec; // exit code
+
+		process_c* m_guest;  // loaded by the host, null once ended
+		uint64_t m_retired;  // instructions of the last ended guest
+		sink_t m_sink;       // console of the guests
+		std::istream* m_input;
+
+	public:
+
+		explicit vm_c(idx_t = 0);
+		vm_c(const vm_c&) = delete;
+		vm_c(vm_c&&) noexcept = delete;
+
+		vm_c& operator=(const vm_c&) = delete;
+		vm_c& operator=(vm_c&&) noexcept = delete;
+
+	public:
+
+		// every process still queued, parked or staged is dropped (see drop)
+		~vm_c();
+
+	public:
+
+		int32_t start();
+
+	public:
+
+		engine_e mode() const;
+
+		// @why: to select the execution engine (the reference one is kept to compare results).
+		// @in: engine used by the next started process.
+		// @out: null.
+		void mode(const engine_e);
+
+		void report(const report_t);
+
+		// @why: to confine the file syscalls to a directory (the working one by default).
+		// @in: path of the directory.
+		// @out: false when it can not be opened.
+		bool sandbox(const sandbox_c::path_t&);
+
+		// @why: to profile the next started processes (they run without native blocks).
+		// @in: file receiving one json object per ended process, empty to stop.
+		// @out: null.
+		void profile(const profile_c::path_t&);
+
+		// @why: to sample the running processes at a fixed interval (cheap enough for production,
+		// the engines are unchanged).
+		// @in: file receiving the collapsed stacks of every ended process, interval (0: 1ms).
+		// @out: null.
+		void sample(const sampler_c::path_t&, const sampler_c::interval = sampler_c::interval(0));
+
+		// @why: to place the segments the same way on every run (reproducible benchmarks).
+		// @in: true for the deterministic placement, false to pick any free block.
+		// @out: null.
+		void deterministic(const bool);
+
+		// @why: to change the number of instructions of a slice (shorter slices interleave the
+		// processes more finely, longer ones switch less often).
+		// @in: instructions, 0 for the default (scheduler_c::dquantum).
+		// @out: null.
+		void quantum(const int64_t);
+
+		// @why: to invalidate what was cached by another version (see cache_c).
+		// @in: null.
+		// @out: version of the vm.
+		version_t version() const;
+
+		// @why: to compare the memory left by two runs (qvm aot --check).
+		// @in: null.
+		// @out: memory of the vm.
+		const memory_c& memory() const;
+
+	public: // driven by a runtime
+
+		// @why: to start a loaded process without the menu.
+		// @in: process (owned by the vm from now on).
+		// @out: false when there is no room for it.
+		bool submit(process_c*);
+
+		// @why: to run a single process until it ends.
+		// @in: process (owned by the vm from now on), debug mode.
+		// @out: exit code of the process, -1 when it can not be started.
+		ecode_t run(process_c*, const uint8_t = 0);
+
+		// @why: to run the next ready process for one quantum (waits for a syscall when every
+		// process is parked).
+		// @in: debug mode.
+		// @out: number of processes still ready or parked.
+		size_t tick(const uint8_t = 0);
+
+		// @why: to freeze the vm once its process is set up.
+		// @in: snapshot (the previous one is dropped).
+		// @out: false when the vm does not hold exactly one ready process (without heap blocks).
+		bool snapshot(snapshot_c&);
+
+		// @why: to start again from a snapshot, the pages are shared with it until written.
+		// @in: snapshot.
+		// @out: false when the vm is running or the pages can not be mapped.
+		bool fork(const snapshot_c&);
+
+	public: // embedded in a host
+
+		// @why: to give the console of the next guests to the host (without one, their output is
+		// dropped and they read no input).
+		// @in: output sink, input stream (null: none).
+		// @out: null.
+		void attach(const sink_t, std::istream* = nullptr);
+
+		// @why: to run a program held by the host: the vm is reset, then the program is placed
+		// and queued as its guest.
+		// @in: binary image or hex text, its length (only read during the call).
+		// @out: false when the program can not be started.
+		bool load(const loc_t*, const size_t);
+
+		// @why: to change the level of the guest in the run queues (0 is the highest, see
+		// scheduler_c), the processes given by submit take the priority they carry.
+		// @in: priority.
+		// @out: false when there is no guest or it is running.
+		bool priority(const process_c::prio_t);
+
+		// @why: to run the guest for a number of instructions (exactly with the reference engine,
+		// the threaded blocks and native code can go a little past).
+		// @in: number of instructions, 0 until the guest ends.
+		// @out: true while the guest has not ended.
+		bool advance(const uint64_t = 0);
+
+		// @why: to read a register of the guest (the last state once it ended).
+		// @in: address of the register.
+		// @out: its value, 0 for an invalid address.
+		core_c::reg32_t reg(const core_c::rega_t) const;
+
+		// @why: to write a register of the guest between two runs (a code segment moved by csx or
+		// clx is run by the reference engine, checking every fetch).
+		// @in: address of the register, value.
+		// @out: false when there is no guest or the address is invalid.
+		bool reg(const core_c::rega_t, const core_c::reg32_t);
+
+		// @why: to copy a block of the memory to the host.
+		// @in: address, destination, length.
+		// @out: false when the block is not inside the memory.
+		bool peek(const idx_t, loc_t*, const idx_t) const;
+
+		// @why: to copy a block of the host to the memory (the compiled code of the guest is kept
+		// coherent, as with its own stores).
+		// @in: address, source, length.
+		// @out: false when the block is not inside the memory.
+		bool poke(const idx_t, const loc_t*, const idx_t);
+
+		// @in: null.
+		// @out: exit code of the guest (1 until it exits).
+		ecode_t ec() const;
+
+		// @in: null.
+		// @out: instructions executed by the guest.
+		uint64_t retired() const;
+
+		// @why: to reuse the vm: every process is dropped (after its pending syscalls), the memory
+		// is zeroed in place, the segments and the native code are reset.
+		// @in: null.
+		// @out: null.
+		void reset();
+
+	protected: // scheduling
+
+		// @why: to place a loaded process in memory and queue it.
+		// @in: process, true to pre-decode its code segment.
+		// @out: false when there is no room for it.
+		bool spawn(process_c*, const bool);
+
+		// @why: to drop every process (guest, queued, parked after its pending syscall, staged),
+		// its files are closed and its console flushed.
+		// @in: null.
+		// @out: null.
+		void drop();
+
+		// @why: to run the current process for one quantum.
+		// @in: debug mode, instructions left to the host (0: no limit).
+		// @out: 0 when the process ended, 1 when it has to be queued again, 2 when it is parked.
+		int32_t slice(const uint8_t, const int64_t = 0);
+
+		void close(const uint8_t);
+
+		// @why: to give the current process a stack segment once slx is written (the previous
+		// one is freed).
+		// @in: null.
+		// @out: null.
+		void stack();
+
+		// @why: to park the current process on a blocking syscall.
+		// @in: request (its process is set here).
+		// @out: 2, returned by execute to end the slice.
+		int32_t park(io_c::request_t&&);
+
+		// @why: to queue again the parked processes whose syscall completed.
+		// @in: true to wait for one when none completed.
+		// @out: null.
+		void resume(const bool);
+
+	protected: // engine
+
+		int32_t engine(const loc_t, const loc_t, const loc_t, const loc_t);
+
+		// @why: to run a verified code segment with the reference engine, the fetch is checked
+		// only when ipx moved elsewhere than to the next instruction.
+		// @in: code segment of the process, instructions left to the slice.
+		// @out: as engine, 1 also when ipx left the code segment.
+		int32_t unchecked(const loc_t*, int64_t&);
+
+		// @why: to run the compiled program of the process from ipx.
+		// @in: instructions left to the slice, decreased by the executed ones.
+		// @out: as dispatch, 1 also when the code segment has been written.
+		int32_t compiled(int64_t&);
+
+		// @why: to run one instruction for a compiled program (see aot_c::step_t).
+		// @in: vm.
+		// @out: as engine.
+		static int32_t step(void*);
+
+		// @why: to run the pre-decoded program from ipx.
+		// @in: instructions left to the slice, decreased by the executed ones.
+		// @out: 0 when the process ended, 1 when the engine has to continue from ipx,
+		// 2 when the slice expired, 3 when the process is parked.
+		int32_t dispatch(int64_t&);
+
+		// @why: to instantiate the dispatch loop with the profile counters, the sampling flag or none.
+		// @in: instructions left to the slice.
+		// @out: as dispatch.
+		template <bool, bool>
+		int32_t interpret(int64_t&);
+
+		// @why: to compile a hot jump target.
+		// @in: index of the instruction.
+		// @out: null.
+		void heat(const program_c::idx_t);
+
+		// @why: to keep the native blocks coherent with a modified code segment.
+		// @in: address written by the program.
+		// @out: null.
+		void patch(const idx_t);
+
+		// @why: to patch every instruction of a written block (wide and bulk stores).
+		// @in: address, length.
+		// @out: null.
+		void touch(const idx_t, const idx_t);
+
+		int32_t execute(const uint32_t);
+		bool throw_if(const bool, const msg_t);
+
+		void compare(const uint32_t, const uint32_t);
+
+	protected: // user interface
+
+		void show_regs();
+		void show_stack();
+		int32_t view(const uint8_t);
+		int32_t menu();
+
+	};
+
+}
+
+namespace vm { /* core_c fast path */
+
+	static_assert(std::is_trivially_copyable<core_c>::value, "core_c is copied as a block");
+	static_assert(sizeof(core_c) == 0x80, "core_c fills two cache lines");
+	static_assert(offsetof(core_c, r) == 0, "the registers start the block");
+
+	inline core_c::reg32_t& core_c::get(const rega_t val) {
+		return r[val < core_c::nregs ? val : core_c::scratch];
+	}
+
+	inline core_c::reg32_t& core_c::x(const rega_t val) { return r[val]; }
+	inline core_c::reg32_t& core_c::csx() { return r[core_c::xregs + 0]; }
+	inline core_c::reg32_t& core_c::ipx() { return r[core_c::xregs + 1]; }
+	inline core_c::reg32_t& core_c::clx() { return r[core_c::xregs + 2]; }
+	inline core_c::reg32_t& core_c::ssx() { return r[core_c::xregs + 3]; }
+	inline core_c::reg32_t& core_c::spx() { return r[core_c::xregs + 4]; }
+	inline core_c::reg32_t& core_c::slx() { return r[core_c::xregs + 5]; }
+	inline core_c::reg32_t& core_c::ax() { return r[core_c::xregs + 6]; }
+	inline core_c::reg32_t& core_c::sx() { return r[core_c::xregs + 7]; }
+	inline core_c::reg32_t& core_c::fx() { return r[core_c::xregs + 8]; }
+
+	inline core_c::reg32_t core_c::x(const rega_t val) const { return r[val]; }
+	inline core_c::reg32_t core_c::csx() const { return r[core_c::xregs + 0]; }
+	inline core_c::reg32_t core_c::ipx() const { return r[core_c::xregs + 1]; }
+	inline core_c::reg32_t core_c::clx() const { return r[core_c::xregs + 2]; }
+	inline core_c::reg32_t core_c::ssx() const { return r[core_c::xregs + 3]; }
+	inline core_c::reg32_t core_c::spx() const { return r[core_c::xregs + 4]; }
+	inline core_c::reg32_t core_c::slx() const { return r[core_c::xregs + 5]; }
+	inline core_c::reg32_t core_c::ax() const { return r[core_c::xregs + 6]; }
+	inline core_c::reg32_t core_c::sx() const { return r[core_c::xregs + 7]; }
+	inline core_c::reg32_t core_c::fx() const { return r[core_c::xregs + 8]; }
+
+}
+
+namespace vm { /* memory_c fast path */
+
+	inline bool memory_c::valid(const idx_t val, const idx_t len) const {
+		return val < m_len && len <= m_len - val;
+	}
+
+	inline memory_c::loc_t& memory_c::get(const idx_t val) {
+		return val < m_len ? m_data[val] : miss(val);
+	}
+
+	inline memory_c::loc_t& memory_c::at(const idx_t val) {
+		return m_data[val];
+	}
+
+	inline const memory_c::loc_t* memory_c::span(const idx_t val, const idx_t len) const {
+		return valid(val, len) ? m_data + val : nullptr;
+	}
+
+	inline bool memory_c::load16(const idx_t val, uint16_t& ret) {
+		if (!valid(val, 2)) {
+			miss(val);
+			return false;
+		}
+		ret = static_cast<uint16_t>(m_data[val] | (m_data[val + 1] << 8));
+		return true;
+	}
+
+	inline bool memory_c::load32(const idx_t val, uint32_t& ret) {
+		if (!valid(val, 4)) {
+			miss(val);
+			return false;
+		}
+		ret = static_cast<uint32_t>(m_data[val])
+			| (static_cast<uint32_t>(m_data[val + 1]) << 8)
+			| (static_cast<uint32_t>(m_data[val + 2]) << 16)
+			| (static_cast<uint32_t>(m_data[val + 3]) << 24);
+		return true;
+	}
+
+	inline bool memory_c::store16(const idx_t val, const uint16_t src) {
+		if (!valid(val, 2)) {
+			miss(val);
+			return false;
+		}
+		m_data[val] = static_cast<loc_t>(src);
+		m_data[val + 1] = static_cast<loc_t>(src >> 8);
+		return true;
+	}
+
+	inline bool memory_c::store32(const idx_t val, const uint32_t src) {
+		if (!valid(val, 4)) {
+			miss(val);
+			return false;
+		}
+		for (uint8_t idx(0); idx < 4; ++idx) {
+			m_data[val + idx] = static_cast<loc_t>(src >> (idx * 8));
+		}
+		return true;
+	}
+
+}
+
+#endif
+
@@ -0,0 +1,484 @@
+#include "../inc/aot.hpp"
+#include "../inc/vm.hpp"
+
+#include <iostream> // std::cerr
+#include <fstream>  // std::ofstream
+#include <sstream>  // std::ostringstream, std::istringstream
+#include <cstdio>   // std::snprintf
+#include <cstdlib>  // std::getenv
+#include <vector>   // std::vector
+
+#ifdef Q_AOT
+#include <dlfcn.h>    // dlopen, dlsym, dlclose
+#include <spawn.h>    // posix_spawnp
+#include <sys/wait.h> // waitpid
+#include <cerrno>     // errno
+
+extern char** environ;
+#endif
+
+namespace vm { /* C emitter */
+
+	namespace {
+
+		constexpr uint8_t CSX = core_c::xregs + 0, IPX = core_c::xregs + 1, CLX = core_c::xregs + 2;
+		constexpr uint8_t SLX = core_c::xregs + 5;
+
+		// interface and helpers of every generated program
+		constexpr const char prologue[] =
+			"#include <stdint.h>\n"
+			"\n"
+			"typedef struct {\n"
+			"\tuint32_t* r;\n"
+			"\tuint8_t* mem;\n"
+			"\tuint32_t len;\n"
+			"\tuint32_t base;\n"
+			"\tuint32_t dirty;\n"
+			"\tvoid* vm;\n"
+			"\tint32_t (*step)(void*);\n"
+			"} qvm_context_t;\n"
+			"\n"
+			"static inline uint32_t qvm_flags(const uint32_t l, const uint32_t r) {\n"
+			"\treturn l < r ? 1 : l == r ? 2 : 4;\n"
+			"}\n"
+			"\n"
+			"#define Q_END(v) { *fuel = f; return (v); }\n"
+			"\n"
+			"/* the instruction at o runs in the engine of the vm (syscalls, faults, special registers) */\n"
+			"#define Q_STEP(o) { \\\n"
+			"\tR[0x11] = csx + (o); \\\n"
+			"\tret = C->step(C->vm); \\\n"
+			"\tif (ret != 1) Q_END(ret == 2 ? 3 : 0) \\\n"
+			"\tif (C->dirty) Q_END(1) \\\n"
+			"\tif (R[0x11] != csx + (o) + 4 || R[0x10] != csx) goto q_dispatch; \\\n"
+			"}\n"
+			"\n";
+
+		// register operand: an invalid address uses the scratch slot, as core_c::get
+		std::string reg(const uint8_t val) {
+			char buf[16];
+			std::snprintf(buf, sizeof(buf), "R[0x%02X]", val < core_c::nregs ? val : core_c::scratch);
+			return buf;
+		}
+
+		std::string imm(const uint32_t val) {
+			char buf[16];
+			std::snprintf(buf, sizeof(buf), "0x%Xu", val);
+			return buf;
+		}
+
+		// writes through the engine: stack allocation (slx), transfers of control (csx, ipx, clx)
+		bool special(const uint8_t val) {
+			return val == CSX || val == IPX || val == CLX || val == SLX;
+		}
+
+		class source_c {
+		public:
+
+			std::ostringstream out;
+			uint32_t len;
+
+		public:
+
+			void step(const uint32_t off) {
+				out << "\tQ_STEP(" << off << ")\n";
+			}
+
+			// static target: yields on a taken jump when the slice expired, as the threaded dispatch
+			void jump(const char* cnd, const uint32_t tgt) {
+				out << "\tif (" << cnd << ") {\n";
+				if (tgt == len) {
+					out << "\t\tR[0x11] = csx + " << tgt << "u;\n\t\tQ_END(0)\n";
+				} else if (tgt > len || tgt % 4 != 0) {
+					out << "\t\tR[0x11] = csx + " << tgt << "u;\n\t\tgoto q_dispatch;\n";
+				} else {
+					out << "\t\tif (f <= 0) {\n\t\t\tR[0x11] = csx + " << tgt << "u;\n\t\t\tQ_END(2)\n\t\t}\n"
+						<< "\t\tgoto i_" << tgt << ";\n";
+				}
+				out << "\t}\n";
+			}
+
+			// register target: checked by the dispatch switch
+			void indirect(const char* cnd, const uint8_t val) {
+				out << "\tif (" << cnd << ") {\n\t\tR[0x11] = R[0x10] + " << reg(val) << " + 4;\n\t\tgoto q_dispatch;\n\t}\n";
+			}
+
+			// op x,v and op x,x
+			void alu(const uint32_t off, const char* opr, const uint8_t b, const std::string& src) {
+				if (special(b)) {
+					write(off, b);
+					return;
+				}
+				out << "\t" << reg(b) << " " << opr << " " << src << ";\n";
+			}
+
+			void write(const uint32_t off, const uint8_t b) {
+				step(off);
+				if (b == CLX) { // the end of the code moved: the interpreters continue
+					out << "\tQ_END(1)\n";
+				}
+			}
+
+			void instruction(const aot_c::loc_t*, const uint32_t);
+
+		};
+
+		void source_c::instruction(const aot_c::loc_t* ins, const uint32_t off) {
+			const uint8_t a(ins[0]), b(ins[1]), c(ins[2]), d(ins[3]);
+			const uint32_t vcd((static_cast<uint32_t>(c) << 8) | d);
+			const uint32_t tgt(((static_cast<uint32_t>(b) << 8) | c) + 4);
+			std::string cnd;
+
+			if (b == IPX || c == IPX || d == IPX) { // read as an operand
+				out << "\tR[0x11] = csx + " << off << "u;\n";
+			}
+
+			switch (a) {
+			case 0x00: // nop
+				break;
+
+			case 0x01: // ldx x,v
+				alu(off, "=", b, imm(vcd));
+				break;
+
+			case 0x02: // ldx x,x
+				alu(off, "=", b, reg(c));
+				break;
+
+			case 0x03: // set v
+			case 0x04: // set x
+				out << "\tt = R[0x16];\n"
+					<< "\tif (t < L && t - csx >= N) {\n\t\tM[t] = (uint8_t)" << (a == 0x03 ? imm(b) : reg(b)) << ";\n\t} else {\n\t";
+				step(off);
+				out << "\t\tif (t - csx < N) Q_END(1) /* code written */\n\t}\n";
+				break;
+
+			case 0x05: // get x
+				if (special(b)) {
+					write(off, b);
+					break;
+				}
+				out << "\tt = R[0x16];\n\tif (t < L) {\n\t\t" << reg(b) << " = M[t];\n\t} else\n\t";
+				step(off);
+				break;
+
+			case 0x08: // jit v,v
+				cnd = "R[0x18] == " + imm(d);
+				jump(cnd.c_str(), tgt);
+				break;
+
+			case 0x09: // jit v,x
+				cnd = "R[0x18] == " + reg(d);
+				jump(cnd.c_str(), tgt);
+				break;
+
+			case 0x0A: // jit x,v
+				cnd = "R[0x18] == " + imm(vcd);
+				indirect(cnd.c_str(), b);
+				break;
+
+			case 0x0B: // jit x,x
+				cnd = "R[0x18] == " + reg(c);
+				indirect(cnd.c_str(), b);
+				break;
+
+			case 0x0C: // jif v,v
+				cnd = "R[0x18] != " + imm(d);
+				jump(cnd.c_str(), tgt);
+				break;
+
+			case 0x0D: // jif v,x
+				cnd = "R[0x18] != " + reg(d);
+				jump(cnd.c_str(), tgt);
+				break;
+
+			case 0x0E: // jif x,v (compared with register c, as the engine)
+			case 0x0F: // jif x,x
+				cnd = "R[0x18] != " + reg(c);
+				indirect(cnd.c_str(), b);
+				break;
+
+			case 0x10: alu(off, "+=", b, imm(vcd)); break; // add x,v
+			case 0x11: alu(off, "+=", b, reg(c)); break;   // add x,x
+
+			case 0x12: // sub x,v (the flags compare with register c, as the engine)
+			case 0x13: // sub x,x
+				if (special(b)) {
+					write(off, b);
+					break;
+				}
+				out << "\tR[0x18] = qvm_flags(" << reg(b) << ", " << reg(c) << ");\n";
+				alu(off, "-=", b, a == 0x12 ? imm(vcd) : reg(c));
+				break;
+
+			case 0x14: alu(off, "*=", b, imm(vcd)); break; // mul x,v
+			case 0x15: alu(off, "*=", b, reg(c)); break;   // mul x,x
+
+			case 0x16: // div x,v
+				if (vcd == 0) { // reported by the engine
+					step(off);
+					break;
+				}
+				alu(off, "/=", b, imm(vcd));
+				break;
+
+			case 0x17: // div x,x
+				if (special(b)) {
+					write(off, b);
+					break;
+				}
+				out << "\tif (" << reg(c) << " != 0) {\n\t\t" << reg(b) << " /= " << reg(c) << ";\n\t} else\n\t";
+				step(off);
+				break;
+
+			case 0x18: alu(off, "&=", b, imm(vcd)); break; // and x,v
+			case 0x19: alu(off, "&=", b, reg(c)); break;   // and x,x
+			case 0x1A: alu(off, "|=", b, imm(vcd)); break; // or x,v
+			case 0x1B: alu(off, "|=", b, reg(c)); break;   // or x,x
+			case 0x1C: alu(off, "^=", b, imm(vcd)); break; // xor x,v
+			case 0x1D: alu(off, "^=", b, reg(c)); break;   // xor x,x
+
+			// the count is masked as the host does
+			case 0x1E: alu(off, "<<=", b, imm(vcd & 31)); break;         // shl x,v
+			case 0x1F: alu(off, "<<=", b, "(" + reg(c) + " & 31)"); break; // shl x,x
+			case 0x20: alu(off, ">>=", b, imm(vcd & 31)); break;         // shr x,v
+			case 0x21: alu(off, ">>=", b, "(" + reg(c) + " & 31)"); break; // shr x,x
+
+			case 0x22: // not x
+				alu(off, "=", b, "~" + reg(b));
+				break;
+
+			case 0x23: // cmp x,v
+				out << "\tR[0x18] = qvm_flags(" << reg(b) << ", " << imm(vcd) << ");\n";
+				break;
+
+			case 0x24: // cmp x,x
+				out << "\tR[0x18] = qvm_flags(" << reg(b) << ", " << reg(c) << ");\n";
+				break;
+
+			case 0x25: // ldw x
+			case 0x27: // ldd x
+				if (special(b)) {
+					write(off, b);
+					break;
+				}
+				{
+					const uint32_t wid(a == 0x25 ? 2 : 4);
+					out << "\tt = R[0x16];\n\tif (t < L && L - t >= " << wid << ") {\n\t\t" << reg(b) << " = (uint32_t)M[t] | (uint32_t)M[t + 1] << 8";
+					if (wid == 4) {
+						out << " | (uint32_t)M[t + 2] << 16 | (uint32_t)M[t + 3] << 24";
+					}
+					out << ";\n";
+					if (c & 1) {
+						out << "\t\tR[0x16] += " << wid << ";\n";
+					}
+					out << "\t} else\n\t";
+					step(off);
+				}
+				break;
+
+			case 0x26: // stw x
+			case 0x28: // std x
+				{
+					const uint32_t wid(a == 0x26 ? 2 : 4);
+					out << "\tt = R[0x16];\n\tif (t < L && L - t >= " << wid << " && (t >= csx + N || t + " << wid << " <= csx)) {\n"
+						<< "\t\tconst uint32_t v = " << reg(b) << ";\n";
+					for (uint32_t idx(0); idx < wid; ++idx) {
+						out << "\t\tM[t + " << idx << "] = (uint8_t)(v >> " << idx * 8 << ");\n";
+					}
+					if (c & 1) {
+						out << "\t\tR[0x16] += " << wid << ";\n";
+					}
+					out << "\t} else\n\t";
+					step(off); // a write of the code segment is seen through touch
+				}
+				break;
+
+			default: // exc, bulk memory, invalid instructions
+				step(off);
+				break;
+			}
+		}
+
+	}
+
+}
+
+namespace vm { /* aot_c */
+
+	aot_c::aot_c()
+		: m_lib(nullptr)
+		, m_run(nullptr)
+		, m_len(0)
+		, m_ctx() {
+	}
+
+	aot_c::~aot_c() {
+#ifdef Q_AOT
+		if (m_lib) {
+			dlclose(m_lib);
+		}
+#endif
+	}
+
+	bool aot_c::supported() {
+#ifdef Q_AOT
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	aot_c::source_t aot_c::translate(const loc_t* code, const idx_t len) {
+		source_c src;
+		src.len = len;
+		std::ostringstream& out(src.out);
+
+		out << "/* generated by qvm aot: " << len / 4 << " instructions */\n" << prologue
+			<< "const uint32_t qvm_aot_abi = " << aot_c::abi << "u;\n"
+			<< "const uint32_t qvm_aot_length = " << len << "u;\n"
+			<< "const uint32_t qvm_aot_sum = " << image_c::checksum(code, len) << "u;\n\n"
+			<< "int32_t qvm_aot_run(qvm_context_t* C, int64_t* fuel) {\n"
+			<< "\tuint32_t* const R = C->r;\n"
+			<< "\tuint8_t* const M = C->mem;\n"
+			<< "\tconst uint32_t L = C->len, csx = C->base, N = " << len << "u;\n"
+			<< "\tint64_t f = *fuel;\n"
+			<< "\tint32_t ret;\n"
+			<< "\tuint32_t t;\n"
+			<< "\tgoto q_dispatch;\n\n";
+
+		for (idx_t off(0); off < len; off += 4) {
+			const loc_t* ins(code + off);
+			char buf[64];
+			std::snprintf(buf, sizeof(buf), "i_%u: /* %02X %02X %02X %02X */\n\t--f;\n", off, ins[0], ins[1], ins[2], ins[3]);
+			out << buf;
+			src.instruction(ins, off);
+		}
+
+		// end of the code, then the entry and the register targets
+		out << "\tR[0x11] = csx + N;\n\tQ_END(0)\n\n"
+			<< "q_dispatch:\n"
+			<< "\tt = R[0x11];\n"
+			<< "\tif (t >= csx + N) Q_END(0)\n"
+			<< "\tif (R[0x10] != csx || t < csx || (t - csx) % 4 != 0) Q_END(1)\n"
+			<< "\tif (f <= 0) Q_END(2)\n"
+			<< "\tswitch ((t - csx) / 4) {\n";
+		for (idx_t off(0); off < len; off += 4) {
+			out << "\tcase " << off / 4 << ": goto i_" << off << ";\n";
+		}
+		out << "\t}\n\tQ_END(1)\n}\n";
+		return out.str();
+	}
+
+	bool aot_c::build(const source_t& src, const path_t& val) {
+		try {
+			const path_t dst(val + ".c");
+			std::ofstream out(dst, std::ios_base::binary | std::ios_base::trunc);
+			if (!out || !out.write(src.data(), static_cast<std::streamsize>(src.size())) || !out.flush()) {
+				throw exception_c("can not write [" + dst + "]");
+			}
+			out.close();
+
+#ifdef Q_AOT
+			// no shell: the paths are passed as they are, $CC is split on blanks ("ccache cc")
+			const char* cc(std::getenv("CC"));
+			std::vector<std::string> args;
+			std::istringstream words(cc ? cc : "");
+			for (std::string word; words >> word;) {
+				args.push_back(word);
+			}
+			if (args.empty()) {
+				args.push_back("cc");
+			}
+			args.insert(args.end(), { "-O2", "-shared", "-fPIC", "-o", val, dst });
+			std::vector<char*> argv;
+			std::string cmd;
+			for (auto& i : args) {
+				argv.push_back(&i[0]);
+				cmd += (cmd.empty() ? "" : " ") + i;
+			}
+			argv.push_back(nullptr);
+
+			pid_t pid;
+			int st(0);
+			if (posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ) != 0) {
+				throw exception_c("can not run the compiler [" + args[0] + "]");
+			}
+			while (waitpid(pid, &st, 0) < 0) {
+				if (errno != EINTR) {
+					throw exception_c("can not build [" + val + "]: " + cmd);
+				}
+			}
+			if (!WIFEXITED(st) || WEXITSTATUS(st) != 0) {
+				throw exception_c("can not build [" + val + "]: " + cmd);
+			}
+			return true;
+#else
+			throw exception_c("compiled programs are not supported on this host [" + val + "]");
+#endif
+		} catch (const exception_c& exc) {
+			std::cerr << exc.get() << std::endl;
+			return false;
+		}
+	}
+
+	bool aot_c::open(const path_t& val, const loc_t* code, const idx_t len) {
+		try {
+#ifdef Q_AOT
+			void* lib(dlopen(val.find('/') == path_t::npos ? ("./" + val).c_str() : val.c_str(), RTLD_NOW | RTLD_LOCAL));
+			if (!lib) {
+				const char* err(dlerror());
+				throw exception_c("can not load [" + val + "]: " + (err ? err : "unknown error"));
+			}
+			const uint32_t* ver(static_cast<const uint32_t*>(dlsym(lib, "qvm_aot_abi")));
+			const uint32_t* clen(static_cast<const uint32_t*>(dlsym(lib, "qvm_aot_length")));
+			const uint32_t* sum(static_cast<const uint32_t*>(dlsym(lib, "qvm_aot_sum")));
+			run_t fn(reinterpret_cast<run_t>(dlsym(lib, "qvm_aot_run")));
+			if (!ver || !clen || !sum || !fn || *ver != aot_c::abi) {
+				dlclose(lib);
+				throw exception_c("not a compiled program [" + val + "]");
+			}
+			if (*clen != len || *sum != image_c::checksum(code, len)) {
+				dlclose(lib);
+				throw exception_c("compiled for another program [" + val + "]");
+			}
+			if (m_lib) {
+				dlclose(m_lib);
+			}
+			m_lib = lib;
+			m_run = fn;
+			m_len = len;
+			m_ctx = context_t();
+			return true;
+#else
+			(void)code;
+			(void)len;
+			throw exception_c("compiled programs are not supported on this host [" + val + "]");
+#endif
+		} catch (const exception_c& exc) {
+			std::cerr << exc.get() << std::endl;
+			return false;
+		}
+	}
+
+	int32_t aot_c::run(void* vm, const step_t stp, reg32_t* reg, loc_t* mem, const idx_t len, const idx_t base, fuel_t& fuel) {
+		m_ctx.r = reg;
+		m_ctx.mem = mem;
+		m_ctx.len = len;
+		m_ctx.base = base;
+		m_ctx.vm = vm;
+		m_ctx.step = stp;
+		return m_ctx.dirty ? 1 : m_run(&m_ctx, &fuel);
+	}
+
+	void aot_c::invalidate(const idx_t val, const idx_t len) {
+		if (len && val < m_ctx.base + m_len && val + len > m_ctx.base) {
+			m_ctx.dirty = 1;
+		}
+	}
+
+	bool aot_c::dirty() const {
+		return m_ctx.dirty != 0;
+	}
+
+}
@@ -0,0 +1,495 @@
+#include "../inc/bench.hpp"
+#include "../inc/profile.hpp"
+
+#include <iostream> // std::cout, std::cerr
+#include <sstream>  // std::ostringstream
+#include <fstream>  // std::ofstream
+#include <cstdio>   // std::remove
+#include <cstdlib>  // std::getenv
+
+#if defined(__unix__) || defined(__APPLE__)
+#define Q_POSIX
+#include <unistd.h> // getpid
+#endif
+
+namespace vm { /* bench_c::code_t */
+
+	bench_c::idx_t bench_c::code_t::op(const uint8_t a, const uint8_t b, const uint8_t c, const uint8_t d) {
+		idx_t ret(here());
+		bytes.insert(bytes.end(), { a, b, c, d });
+		return ret;
+	}
+
+	bench_c::idx_t bench_c::code_t::jump(const uint8_t a, const idx_t tgt, const uint8_t d) {
+		idx_t ret(op(a, 0, 0, d));
+		bind(ret, tgt);
+		return ret;
+	}
+
+	void bench_c::code_t::bind(const idx_t at, const idx_t tgt) {
+		idx_t imm(tgt - 4); // static jumps land 4 bytes after their immediate
+		bytes[at + 1] = static_cast<uint8_t>(imm >> 8);
+		bytes[at + 2] = static_cast<uint8_t>(imm);
+	}
+
+	void bench_c::code_t::exit() {
+		op(0x01, 0x00, 0x00, 0x00); // ldx x0, 0
+		op(0x01, 0x17, 0x00, 0x01); // ldx sx, 1
+		op(0x06, 0x00, 0x00, 0x01); // exc 1
+	}
+
+	bench_c::idx_t bench_c::code_t::here() const {
+		return static_cast<idx_t>(bytes.size());
+	}
+
+}
+
+namespace vm { /* bench_c */
+
+	bench_c::bench_c(const name_t& flt, const idx_t len, const engine_e* eng)
+		: m_filter(flt)
+		, m_mem(len)
+		, m_engines()
+		, m_runs(bench_c::druns)
+		, m_dir() {
+		if (eng) {
+			m_engines.push_back(*eng);
+		} else {
+			m_engines = { engine_e::REFERENCE, engine_e::THREADED };
+			if (jit_c::supported()) {
+				m_engines.push_back(engine_e::JIT);
+			}
+		}
+		const char* tmp(std::getenv("TMPDIR"));
+		m_dir = tmp && *tmp ? tmp : "/tmp";
+	}
+
+	int32_t bench_c::run() {
+		bool ok(opcodes());
+		memory();
+		registers();
+		loader();
+		construct();
+		ok = programs() && ok;
+		std::cout.flush();
+		return ok ? 0 : 1;
+	}
+
+	const char* bench_c::name(const engine_e val) {
+		switch (val) {
+		case engine_e::REFERENCE: return "reference";
+		case engine_e::THREADED:  return "threaded";
+		case engine_e::JIT:       return "jit";
+		default:                  return "unknown";
+		}
+	}
+
+	bool bench_c::selected(const name_t& val) const {
+		return m_filter.empty() || val.find(m_filter) != name_t::npos;
+	}
+
+	void bench_c::report(const name_t& val, const char* eng, const uint64_t ops, const char* unit, const duration sec) const {
+		std::ostringstream out;
+		out << "{\"name\":\"" << val << "\",\"engine\":";
+		if (eng) {
+			out << "\"" << eng << "\"";
+		} else {
+			out << "null";
+		}
+		out << ",\"ops\":" << ops
+			<< ",\"unit\":\"" << unit << "\""
+			<< ",\"seconds\":" << sec.count()
+			<< ",\"per_second\":" << (sec.count() > 0 ? ops / sec.count() : 0.0)
+			<< ",\"ns_per_op\":" << (ops ? sec.count() * 1e9 / ops : 0.0)
+			<< "}\n";
+		std::cout << out.str();
+	}
+
+	std::pair<uint64_t, bench_c::duration> bench_c::best(const std::function<std::pair<uint64_t, duration>()>& val) const {
+		std::pair<uint64_t, duration> ret(0, duration(0));
+		for (uint32_t idx(0); idx < m_runs; ++idx) {
+			std::pair<uint64_t, duration> cur(val());
+			if (idx == 0 || cur.second < ret.second) {
+				ret = cur;
+			}
+		}
+		return ret;
+	}
+
+	std::string bench_c::hex(const code_t& val) {
+		static const char dig[] = "0123456789ABCDEF";
+		std::string ret;
+		ret.reserve(val.bytes.size() * 3);
+		for (size_t idx(0); idx < val.bytes.size(); ++idx) {
+			ret += dig[val.bytes[idx] >> 4];
+			ret += dig[val.bytes[idx] & 0x0F];
+			ret += (idx & 3) == 3 ? '\n' : ' ';
+		}
+		return ret;
+	}
+
+	std::string bench_c::write(const name_t& val, const std::string& txt) const {
+		long pid(0);
+#ifdef Q_POSIX
+		pid = static_cast<long>(::getpid());
+#endif
+		std::string ret(m_dir + "/qvm-bench-" + std::to_string(pid) + "-");
+		for (const auto& i : val) {
+			ret += (i == '/' || i == ' ' || i == ',') ? '_' : i;
+		}
+		ret += ".hex";
+
+		std::ofstream out(ret, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+		if (!out || !out.write(txt.data(), static_cast<std::streamsize>(txt.size())) || !out.flush()) {
+			std::cerr << "can not write [" + ret + "]" << std::endl;
+			return std::string();
+		}
+		return ret;
+	}
+
+	bool bench_c::guest(const name_t& val, const code_t& code, const engine_e eng) {
+		std::string path(write(val + "_" + bench_c::name(eng), bench_c::hex(code)));
+		if (path.empty()) {
+			return false;
+		}
+
+		vm_c qvm(m_mem);
+		qvm.mode(eng);
+		qvm.deterministic(true);
+		uint64_t retired(0);
+		duration cpu(0);
+		bool ok(true);
+		qvm.report([&retired, &cpu, &ok](const process_c& prc) {
+			retired = prc.retired;
+			cpu = std::chrono::duration_cast<duration>(prc.cpu);
+			ok = ok && prc.ec == 0 && prc.faults == 0;
+		});
+
+		std::pair<uint64_t, duration> res(best([&]() -> std::pair<uint64_t, duration> {
+			process_c* prc(new process_c());
+			if (!prc->load(path)) {
+				delete prc;
+				ok = false;
+				return { 0, duration(0) };
+			}
+			prc->console.redirect("/dev/null", "/dev/null");
+			retired = 0;
+			cpu = duration(0);
+			if (qvm.run(prc) != 0) {
+				ok = false;
+			}
+			return { retired, cpu };
+		}));
+		std::remove(path.c_str());
+
+		if (!ok) {
+			std::cerr << "benchmark [" << val << "] did not end normally in the " << bench_c::name(eng) << " engine" << std::endl;
+			return false;
+		}
+		report(val, bench_c::name(eng), res.first, "instructions", res.second);
+		return true;
+	}
+
+	bool bench_c::opcodes() {
+		struct case_t {
+			uint8_t a, b, c, d;
+			const char* suffix;
+		};
+
+		// every case writes x1 and reads x2 (3), memory accesses stay at the data address
+		static const case_t cases[] = {
+			{ 0x00, 0x00, 0x00, 0x00, "" },           // nop
+			{ 0x01, 0x01, 0x12, 0x34, "" },           // ldx x,v
+			{ 0x02, 0x01, 0x02, 0x00, "" },           // ldx x,x
+			{ 0x03, 0x41, 0x00, 0x00, "" },           // set v
+			{ 0x04, 0x02, 0x00, 0x00, "" },           // set x
+			{ 0x05, 0x01, 0x00, 0x00, "" },           // get x
+			{ 0x08, 0x00, 0x00, 0xFF, " not taken" }, // jit v,v (fx is never 0xFF)
+			{ 0x0C, 0x00, 0x00, 0xFF, " taken" },     // jif v,v to the next instruction
+			{ 0x10, 0x01, 0x00, 0x01, "" },           // add x,v
+			{ 0x11, 0x01, 0x02, 0x00, "" },           // add x,x
+			{ 0x12, 0x01, 0x00, 0x01, "" },           // sub x,v
+			{ 0x13, 0x01, 0x02, 0x00, "" },           // sub x,x
+			{ 0x14, 0x01, 0x00, 0x03, "" },           // mul x,v
+			{ 0x15, 0x01, 0x02, 0x00, "" },           // mul x,x
+			{ 0x16, 0x01, 0x00, 0x03, "" },           // div x,v
+			{ 0x17, 0x01, 0x02, 0x00, "" },           // div x,x
+			{ 0x18, 0x01, 0x00, 0x0F, "" },           // and x,v
+			{ 0x1A, 0x01, 0x00, 0x0F, "" },           // or x,v
+			{ 0x1C, 0x01, 0x00, 0x0F, "" },           // xor x,v
+			{ 0x1E, 0x01, 0x00, 0x01, "" },           // shl x,v
+			{ 0x20, 0x01, 0x00, 0x01, "" },           // shr x,v
+			{ 0x22, 0x01, 0x00, 0x00, "" },           // not x
+			{ 0x23, 0x01, 0x00, 0x00, "" },           // cmp x,v
+			{ 0x24, 0x01, 0x02, 0x00, "" },           // cmp x,x
+			{ 0x25, 0x01, 0x00, 0x00, "" },           // ldw x
+			{ 0x26, 0x02, 0x00, 0x00, "" },           // stw x
+			{ 0x27, 0x01, 0x00, 0x00, "" },           // ldd x
+			{ 0x28, 0x02, 0x00, 0x00, "" },           // std x
+		};
+
+		bool ret(true);
+		for (const auto& i : cases) {
+			name_t val(std::string("micro/opcode/") + profile_c::name(i.a) + i.suffix);
+			if (!selected(val)) {
+				continue;
+			}
+
+			// 64 copies of the instruction in a loop of 0xFFFF iterations, run twice
+			code_t code;
+			code.op(0x01, 0x16, bench_c::daddr >> 8, bench_c::daddr & 0xFF); // ldx ax, data
+			code.op(0x01, 0x02, 0x00, 0x03);             // ldx x2, 3
+			code.op(0x01, 0x0E, 0x00, 0x02);             // ldx x14, 2
+			idx_t outer(code.op(0x01, 0x0F, 0xFF, 0xFF)); // ldx x15, 0xFFFF
+			idx_t inner(code.here());
+			for (uint32_t idx(0); idx < 0x40; ++idx) {
+				if (i.a == 0x0C) {
+					code.jump(i.a, code.here() + 4, i.d);
+				} else {
+					code.op(i.a, i.b, i.c, i.d);
+				}
+			}
+			code.op(0x12, 0x0F, 0x00, 0x01); // sub x15, 1
+			code.op(0x23, 0x0F, 0x00, 0x00); // cmp x15, 0
+			code.jump(0x0C, inner, 0x02);    // jif (not equal) inner
+			code.op(0x12, 0x0E, 0x00, 0x01); // sub x14, 1
+			code.op(0x23, 0x0E, 0x00, 0x00); // cmp x14, 0
+			code.jump(0x0C, outer, 0x02);    // jif (not equal) outer
+			code.exit();
+
+			for (const auto& j : m_engines) {
+				ret = guest(val, code, j) && ret;
+			}
+		}
+		return ret;
+	}
+
+	bool bench_c::programs() {
+		struct program_t {
+			const char* name;
+			code_t code;
+		};
+		std::vector<program_t> progs;
+
+		{ // counting loop: 0x80 x 0xFFFF iterations of 4 instructions
+			code_t code;
+			code.op(0x01, 0x0E, 0x00, 0x80);              // ldx x14, 0x80
+			idx_t outer(code.op(0x01, 0x0F, 0xFF, 0xFF)); // ldx x15, 0xFFFF
+			idx_t inner(code.op(0x10, 0x01, 0x00, 0x01)); // add x1, 1
+			code.op(0x12, 0x0F, 0x00, 0x01);              // sub x15, 1
+			code.op(0x23, 0x0F, 0x00, 0x00);              // cmp x15, 0
+			code.jump(0x0C, inner, 0x02);
+			code.op(0x12, 0x0E, 0x00, 0x01);              // sub x14, 1
+			code.op(0x23, 0x0E, 0x00, 0x00);              // cmp x14, 0
+			code.jump(0x0C, outer, 0x02);
+			code.exit();
+			progs.push_back(program_t{ "macro/loop", std::move(code) });
+		}
+
+		{ // fibonacci numbers: 0x400 x the first 0x1000 terms (modulo 2^32)
+			code_t code;
+			code.op(0x01, 0x0E, 0x04, 0x00);              // ldx x14, 0x400
+			idx_t outer(code.op(0x01, 0x01, 0x00, 0x00)); // ldx x1, 0
+			code.op(0x01, 0x02, 0x00, 0x01);              // ldx x2, 1
+			code.op(0x01, 0x04, 0x10, 0x00);              // ldx x4, 0x1000
+			idx_t inner(code.op(0x02, 0x03, 0x01, 0x00)); // ldx x3, x1
+			code.op(0x11, 0x03, 0x02, 0x00);              // add x3, x2
+			code.op(0x02, 0x01, 0x02, 0x00);              // ldx x1, x2
+			code.op(0x02, 0x02, 0x03, 0x00);              // ldx x2, x3
+			code.op(0x12, 0x04, 0x00, 0x01);              // sub x4, 1
+			code.op(0x23, 0x04, 0x00, 0x00);              // cmp x4, 0
+			code.jump(0x0C, inner, 0x02);
+			code.op(0x12, 0x0E, 0x00, 0x01);              // sub x14, 1
+			code.op(0x23, 0x0E, 0x00, 0x00);              // cmp x14, 0
+			code.jump(0x0C, outer, 0x02);
+			code.exit();
+			progs.push_back(program_t{ "macro/fib", std::move(code) });
+		}
+
+		{ // sieve of eratosthenes: 0x60 x the primes below 0x4000, one byte per number
+			code_t code;
+			code.op(0x01, 0x0E, 0x00, 0x60);              // ldx x14, 0x60
+			idx_t outer(code.op(0x01, 0x16, bench_c::daddr >> 8, bench_c::daddr & 0xFF)); // ldx ax, data
+			code.op(0x01, 0x01, 0x40, 0x00);              // ldx x1, 0x4000
+			idx_t fill(code.op(0x03, 0x01, 0x00, 0x00));  // set 1
+			code.op(0x10, 0x16, 0x00, 0x01);              // add ax, 1
+			code.op(0x12, 0x01, 0x00, 0x01);              // sub x1, 1
+			code.op(0x23, 0x01, 0x00, 0x00);              // cmp x1, 0
+			code.jump(0x0C, fill, 0x02);
+			code.op(0x01, 0x02, 0x00, 0x02);              // ldx x2, 2 (i)
+			idx_t next(code.op(0x02, 0x03, 0x02, 0x00));  // ldx x3, x2 (j)
+			code.op(0x15, 0x03, 0x02, 0x00);              // mul x3, x2
+			code.op(0x23, 0x03, 0x40, 0x00);              // cmp x3, 0x4000
+			idx_t done(code.jump(0x0C, 0, 0x01));         // jif (not less) done
+			code.op(0x01, 0x16, bench_c::daddr >> 8, bench_c::daddr & 0xFF);  // ldx ax, data
+			code.op(0x11, 0x16, 0x02, 0x00);              // add ax, x2
+			code.op(0x05, 0x05, 0x00, 0x00);              // get x5
+			code.op(0x23, 0x05, 0x00, 0x00);              // cmp x5, 0
+			idx_t skip(code.jump(0x08, 0, 0x02));         // jit (equal) skip, not a prime
+			idx_t mark(code.op(0x01, 0x16, bench_c::daddr >> 8, bench_c::daddr & 0xFF)); // ldx ax, data
+			code.op(0x11, 0x16, 0x03, 0x00);              // add ax, x3
+			code.op(0x03, 0x00, 0x00, 0x00);              // set 0
+			code.op(0x11, 0x03, 0x02, 0x00);              // add x3, x2
+			code.op(0x23, 0x03, 0x40, 0x00);              // cmp x3, 0x4000
+			code.jump(0x08, mark, 0x01);                  // jit (less) mark
+			code.bind(skip, code.op(0x10, 0x02, 0x00, 0x01)); // add x2, 1
+			code.jump(0x0C, next, 0xFF);                  // jump next
+			code.bind(done, code.op(0x12, 0x0E, 0x00, 0x01)); // sub x14, 1
+			code.op(0x23, 0x0E, 0x00, 0x00);              // cmp x14, 0
+			code.jump(0x0C, outer, 0x02);
+			code.exit();
+			progs.push_back(program_t{ "macro/sieve", std::move(code) });
+		}
+
+		{ // byte copy: 0xC0 x 0x4000 bytes, one get and one set per byte
+			code_t code;
+			code.op(0x01, 0x0E, 0x00, 0xC0);              // ldx x14, 0xC0
+			idx_t outer(code.op(0x01, 0x01, 0x00, 0x00)); // ldx x1, 0
+			idx_t inner(code.op(0x01, 0x16, bench_c::daddr >> 8, bench_c::daddr & 0xFF)); // ldx ax, data
+			code.op(0x11, 0x16, 0x01, 0x00);              // add ax, x1
+			code.op(0x05, 0x05, 0x00, 0x00);              // get x5
+			code.op(0x01, 0x16, (bench_c::daddr + 0x4000) >> 8, bench_c::daddr & 0xFF); // ldx ax, data + 0x4000
+			code.op(0x11, 0x16, 0x01, 0x00);              // add ax, x1
+			code.op(0x04, 0x05, 0x00, 0x00);              // set x5
+			code.op(0x10, 0x01, 0x00, 0x01);              // add x1, 1
+			code.op(0x23, 0x01, 0x40, 0x00);              // cmp x1, 0x4000
+			code.jump(0x08, inner, 0x01);                 // jit (less) inner
+			code.op(0x12, 0x0E, 0x00, 0x01);              // sub x14, 1
+			code.op(0x23, 0x0E, 0x00, 0x00);              // cmp x14, 0
+			code.jump(0x0C, outer, 0x02);
+			code.exit();
+			progs.push_back(program_t{ "macro/copy", std::move(code) });
+		}
+
+		{ // string output: 0xFFFF x a line of 13 bytes on the console
+			static const char msg[] = "hello, world\n";
+			code_t code;
+			code.op(0x01, 0x16, bench_c::daddr >> 8, bench_c::daddr & 0xFF);  // ldx ax, data
+			for (size_t idx(0); idx + 1 < sizeof(msg); ++idx) {
+				code.op(0x03, static_cast<uint8_t>(msg[idx]), 0x00, 0x00); // set c
+				code.op(0x10, 0x16, 0x00, 0x01);          // add ax, 1
+			}
+			code.op(0x01, 0x0E, 0xFF, 0xFF);              // ldx x14, 0xFFFF
+			idx_t loop(code.op(0x01, 0x00, bench_c::daddr >> 8, bench_c::daddr & 0xFF)); // ldx x0, data
+			code.op(0x01, 0x01, 0x00, static_cast<uint8_t>(sizeof(msg) - 1));   // ldx x1, length
+			code.op(0x01, 0x17, 0x00, 0x05);              // ldx sx, 5
+			code.op(0x06, 0x00, 0x00, 0x02);              // exc 2
+			code.op(0x12, 0x0E, 0x00, 0x01);              // sub x14, 1
+			code.op(0x23, 0x0E, 0x00, 0x00);              // cmp x14, 0
+			code.jump(0x0C, loop, 0x02);
+			code.exit();
+			progs.push_back(program_t{ "macro/print", std::move(code) });
+		}
+
+		bool ret(true);
+		for (const auto& i : progs) {
+			if (!selected(i.name)) {
+				continue;
+			}
+			for (const auto& j : m_engines) {
+				ret = guest(i.name, i.code, j) && ret;
+			}
+		}
+		return ret;
+	}
+
+	void bench_c::memory() {
+		const name_t val("micro/memory/get");
+		if (!selected(val)) {
+			return;
+		}
+		const idx_t len(0x01000000);
+		const uint64_t cnt(0x10000000);
+		memory_c mem(len);
+		std::pair<uint64_t, duration> res(best([&]() -> std::pair<uint64_t, duration> {
+			auto beg(std::chrono::steady_clock::now());
+			uint64_t sum(0);
+			for (uint64_t idx(0); idx < cnt; ++idx) {
+				sum += mem.get(static_cast<idx_t>(idx * 0x9E3779B1) & (len - 1)); // scattered reads
+			}
+			auto end(std::chrono::steady_clock::now());
+			volatile uint64_t sink(sum);
+			(void)sink;
+			return { cnt, std::chrono::duration_cast<duration>(end - beg) };
+		}));
+		report(val, nullptr, res.first, "reads", res.second);
+	}
+
+	void bench_c::registers() {
+		const name_t val("micro/core/get");
+		if (!selected(val)) {
+			return;
+		}
+		const uint64_t cnt(0x08000000);
+		core_c::rega_t regs[0x20];
+		for (uint32_t idx(0); idx < 0x20; ++idx) {
+			regs[idx] = static_cast<core_c::rega_t>(idx % 0x19); // x0 to fx
+		}
+		core_c core;
+		std::pair<uint64_t, duration> res(best([&]() -> std::pair<uint64_t, duration> {
+			auto beg(std::chrono::steady_clock::now());
+			uint64_t sum(0);
+			for (uint64_t idx(0); idx < cnt; ++idx) {
+				sum += core.get(regs[idx & 0x1F]);
+			}
+			auto end(std::chrono::steady_clock::now());
+			volatile uint64_t sink(sum);
+			(void)sink;
+			return { cnt, std::chrono::duration_cast<duration>(end - beg) };
+		}));
+		report(val, nullptr, res.first, "reads", res.second);
+	}
+
+	void bench_c::loader() {
+		static const uint32_t sizes[] = { 1, 10, 100 };
+		for (const auto& i : sizes) {
+			name_t val("micro/loader/" + std::to_string(i) + "MB");
+			if (!selected(val)) {
+				continue;
+			}
+
+			// one instruction per line, ended by an exit
+			code_t last;
+			last.exit();
+			std::string tail(bench_c::hex(last));
+			std::string txt;
+			txt.reserve(static_cast<size_t>(i) << 20);
+			while (txt.size() + 12 + tail.size() <= (static_cast<size_t>(i) << 20)) {
+				txt += "10 01 00 01\n"; // add x1, 1
+			}
+			txt += tail;
+
+			std::string path(write(val, txt));
+			if (path.empty()) {
+				continue;
+			}
+			std::pair<uint64_t, duration> res(best([&]() -> std::pair<uint64_t, duration> {
+				process_c prc;
+				auto beg(std::chrono::steady_clock::now());
+				bool ok(prc.load(path));
+				auto end(std::chrono::steady_clock::now());
+				return { ok ? txt.size() : 0, std::chrono::duration_cast<duration>(end - beg) };
+			}));
+			std::remove(path.c_str());
+			report(val, nullptr, res.first, "bytes", res.second);
+		}
+	}
+
+	void bench_c::construct() {
+		const name_t val("micro/vm/construct");
+		if (!selected(val)) {
+			return;
+		}
+		const uint64_t cnt(0x40);
+		std::pair<uint64_t, duration> res(best([&]() -> std::pair<uint64_t, duration> {
+			auto beg(std::chrono::steady_clock::now());
+			for (uint64_t idx(0); idx < cnt; ++idx) {
+				vm_c qvm(m_mem);
+			}
+			auto end(std::chrono::steady_clock::now());
+			return { cnt, std::chrono::duration_cast<duration>(end - beg) };
+		}));
+		report(val, nullptr, res.first, "vms", res.second);
+	}
+
+}
@@ -0,0 +1,200 @@
+#include "../inc/bulk.hpp"
+
+#include <cstring> // std::memmove
+
+#ifdef Q_SIMD
+#include <immintrin.h>
+#endif
+
+namespace vm { /* kernels */
+
+	namespace {
+
+		using loc_t = bulk_c::loc_t;
+
+		struct kernels_t {
+			bulk_c::isa_e isa;
+			void (*copy)(loc_t*, const loc_t*, size_t);
+			void (*fill)(loc_t*, loc_t, size_t);
+			int32_t (*compare)(const loc_t*, const loc_t*, size_t);
+		};
+
+#ifdef Q_SIMD
+		// true when a forward copy never reads what it has written
+		bool forward(loc_t* dst, const loc_t* src, const size_t len) {
+			return dst <= src || dst >= src + len;
+		}
+#else
+		void copy_scalar(loc_t* dst, const loc_t* src, size_t len) {
+			std::memmove(dst, src, len);
+		}
+
+		void fill_scalar(loc_t* dst, loc_t val, size_t len) {
+			for (size_t idx(0); idx < len; ++idx) {
+				dst[idx] = val;
+			}
+		}
+#endif
+
+		int32_t compare_scalar(const loc_t* lhs, const loc_t* rhs, size_t len) {
+			for (size_t idx(0); idx < len; ++idx) {
+				if (lhs[idx] != rhs[idx]) {
+					return static_cast<int32_t>(lhs[idx]) - rhs[idx];
+				}
+			}
+			return 0;
+		}
+
+#ifdef Q_SIMD
+
+		/* sse2 */
+
+		void copy_sse2(loc_t* dst, const loc_t* src, size_t len) {
+			size_t idx(0);
+			if (forward(dst, src, len)) {
+				for (; idx + 16 <= len; idx += 16) {
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + idx), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + idx)));
+				}
+				for (; idx < len; ++idx) {
+					dst[idx] = src[idx];
+				}
+				return;
+			}
+			for (; idx + 16 <= len; idx += 16) { // backward, from the end
+				size_t off(len - idx - 16);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + off), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + off)));
+			}
+			for (size_t off(len - idx); off > 0; --off) {
+				dst[off - 1] = src[off - 1];
+			}
+		}
+
+		void fill_sse2(loc_t* dst, loc_t val, size_t len) {
+			const __m128i vec(_mm_set1_epi8(static_cast<char>(val)));
+			size_t idx(0);
+			for (; idx + 16 <= len; idx += 16) {
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + idx), vec);
+			}
+			for (; idx < len; ++idx) {
+				dst[idx] = val;
+			}
+		}
+
+		int32_t compare_sse2(const loc_t* lhs, const loc_t* rhs, size_t len) {
+			size_t idx(0);
+			for (; idx + 16 <= len; idx += 16) {
+				__m128i eq(_mm_cmpeq_epi8(
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(lhs + idx)),
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(rhs + idx))
+				));
+				uint32_t msk(static_cast<uint32_t>(_mm_movemask_epi8(eq)) ^ 0xFFFF);
+				if (msk) {
+					size_t at(idx + __builtin_ctz(msk));
+					return static_cast<int32_t>(lhs[at]) - rhs[at];
+				}
+			}
+			return compare_scalar(lhs + idx, rhs + idx, len - idx);
+		}
+
+		/* avx2 */
+
+		__attribute__((target("avx2")))
+		void copy_avx2(loc_t* dst, const loc_t* src, size_t len) {
+			size_t idx(0);
+			if (forward(dst, src, len)) {
+				for (; idx + 32 <= len; idx += 32) {
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + idx), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + idx)));
+				}
+				for (; idx < len; ++idx) {
+					dst[idx] = src[idx];
+				}
+				return;
+			}
+			for (; idx + 32 <= len; idx += 32) { // backward, from the end
+				size_t off(len - idx - 32);
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + off), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + off)));
+			}
+			for (size_t off(len - idx); off > 0; --off) {
+				dst[off - 1] = src[off - 1];
+			}
+		}
+
+		__attribute__((target("avx2")))
+		void fill_avx2(loc_t* dst, loc_t val, size_t len) {
+			const __m256i vec(_mm256_set1_epi8(static_cast<char>(val)));
+			size_t idx(0);
+			for (; idx + 32 <= len; idx += 32) {
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + idx), vec);
+			}
+			for (; idx < len; ++idx) {
+				dst[idx] = val;
+			}
+		}
+
+		__attribute__((target("avx2")))
+		int32_t compare_avx2(const loc_t* lhs, const loc_t* rhs, size_t len) {
+			size_t idx(0);
+			for (; idx + 32 <= len; idx += 32) {
+				__m256i eq(_mm256_cmpeq_epi8(
+					_mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + idx)),
+					_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + idx))
+				));
+				uint32_t msk(~static_cast<uint32_t>(_mm256_movemask_epi8(eq)));
+				if (msk) {
+					size_t at(idx + __builtin_ctz(msk));
+					return static_cast<int32_t>(lhs[at]) - rhs[at];
+				}
+			}
+			return compare_scalar(lhs + idx, rhs + idx, len - idx);
+		}
+
+#endif
+
+		const kernels_t& kernels() {
+			static const kernels_t ret([]() {
+#ifdef Q_SIMD
+				if (__builtin_cpu_supports("avx2")) {
+					return kernels_t{ bulk_c::isa_e::AVX2, copy_avx2, fill_avx2, compare_avx2 };
+				}
+				return kernels_t{ bulk_c::isa_e::SSE2, copy_sse2, fill_sse2, compare_sse2 };
+#else
+				return kernels_t{ bulk_c::isa_e::SCALAR, copy_scalar, fill_scalar, compare_scalar };
+#endif
+			}());
+			return ret;
+		}
+
+	}
+
+}
+
+namespace vm { /* bulk_c */
+
+	bulk_c::isa_e bulk_c::isa() {
+		return kernels().isa;
+	}
+
+	const char* bulk_c::name(const isa_e val) {
+		switch (val) {
+		case isa_e::SSE2:
+			return "sse2";
+		case isa_e::AVX2:
+			return "avx2";
+		default:
+			return "scalar";
+		}
+	}
+
+	void bulk_c::copy(loc_t* dst, const loc_t* src, const size_t len) {
+		kernels().copy(dst, src, len);
+	}
+
+	void bulk_c::fill(loc_t* dst, const loc_t val, const size_t len) {
+		kernels().fill(dst, val, len);
+	}
+
+	int32_t bulk_c::compare(const loc_t* lhs, const loc_t* rhs, const size_t len) {
+		return kernels().compare(lhs, rhs, len);
+	}
+
+}
@@ -0,0 +1,400 @@
+#include "../inc/cache.hpp"
+#include "../inc/vm.hpp"
+
+#include <iostream>  // std::cerr
+#include <fstream>   // std::ifstream, std::ofstream
+#include <algorithm> // std::sort
+#include <cstring>   // std::memcpy
+#include <cstdio>    // std::rename, std::remove, std::snprintf
+#include <cstdlib>   // mkstemp
+#include <atomic>
+#include <map>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define Q_POSIX
+#include <fcntl.h>    // open, AT_FDCWD
+#include <sys/mman.h> // mmap, munmap
+#include <sys/stat.h> // fstat, stat, mkdir, utimensat
+#include <dirent.h>   // opendir, readdir, closedir
+#include <unistd.h>   // close, access
+#include <cerrno>     // errno
+#endif
+
+namespace vm { /* cache_c */
+
+	namespace {
+
+		const char* const exts[] = { "meta", "qvm", "so" };
+
+		// new file of a directory, written aside then renamed: every write has its own (other
+		// caches or threads can write the same directory), empty when it can not be created
+		std::string aside(const std::string& dir) {
+#ifdef Q_POSIX
+			std::string ret(dir + "/tmp_XXXXXX");
+			int fd(::mkstemp(&ret[0]));
+			if (fd < 0) {
+				return std::string();
+			}
+			::close(fd);
+			return ret;
+#else
+			static std::atomic<uint32_t> cnt(0);
+			return dir + "/tmp_" + std::to_string(++cnt);
+#endif
+		}
+
+		// SHA-256 (FIPS 180-4)
+		class sha256_c {
+		public:
+
+			sha256_c()
+				: m_h{ 0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19 } {
+			}
+
+			cache_c::digest_t run(const uint8_t* val, const size_t len) {
+				size_t idx(0);
+				for (; idx + 64 <= len; idx += 64) {
+					block(val + idx);
+				}
+
+				// padding: 0x80, zeros, length in bits (big-endian), one or two blocks
+				uint8_t tail[128] = { 0 };
+				const size_t rest(len - idx), cnt(rest < 56 ? 64 : 128);
+				if (rest) {
+					std::memcpy(tail, val + idx, rest);
+				}
+				tail[rest] = 0x80;
+				const uint64_t bits(static_cast<uint64_t>(len) << 3);
+				for (size_t i(0); i < 8; ++i) {
+					tail[cnt - 1 - i] = static_cast<uint8_t>(bits >> (i * 8));
+				}
+				for (size_t i(0); i < cnt; i += 64) {
+					block(tail + i);
+				}
+
+				cache_c::digest_t ret;
+				for (size_t i(0); i < 32; ++i) {
+					ret[i] = static_cast<uint8_t>(m_h[i / 4] >> (24 - (i % 4) * 8));
+				}
+				return ret;
+			}
+
+		protected:
+
+			static uint32_t rotr(const uint32_t val, const uint32_t cnt) {
+				return (val >> cnt) | (val << (32 - cnt));
+			}
+
+			void block(const uint8_t* val) {
+				static const uint32_t k[64] = {
+					0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+					0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+					0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+					0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+					0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+					0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+					0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+					0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+				};
+				uint32_t w[64];
+				for (size_t i(0); i < 16; ++i) {
+					w[i] = static_cast<uint32_t>(val[i * 4]) << 24 | static_cast<uint32_t>(val[i * 4 + 1]) << 16
+						| static_cast<uint32_t>(val[i * 4 + 2]) << 8 | val[i * 4 + 3];
+				}
+				for (size_t i(16); i < 64; ++i) {
+					const uint32_t s0(rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3));
+					const uint32_t s1(rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10));
+					w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+				}
+
+				uint32_t a(m_h[0]), b(m_h[1]), c(m_h[2]), d(m_h[3]), e(m_h[4]), f(m_h[5]), g(m_h[6]), h(m_h[7]);
+				for (size_t i(0); i < 64; ++i) {
+					const uint32_t t1(h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i]);
+					const uint32_t t2((rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c)));
+					h = g;
+					g = f;
+					f = e;
+					e = d + t1;
+					d = c;
+					c = b;
+					b = a;
+					a = t1 + t2;
+				}
+				m_h[0] += a;
+				m_h[1] += b;
+				m_h[2] += c;
+				m_h[3] += d;
+				m_h[4] += e;
+				m_h[5] += f;
+				m_h[6] += g;
+				m_h[7] += h;
+			}
+
+		protected:
+
+			uint32_t m_h[8];
+
+		};
+
+		std::string hex(const cache_c::digest_t& val) {
+			static const char dig[] = "0123456789abcdef";
+			std::string ret;
+			for (uint8_t i : val) {
+				ret += dig[i >> 4];
+				ret += dig[i & 0x0F];
+			}
+			return ret;
+		}
+
+	}
+
+	cache_c::cache_c(const path_t& dir, const len_t cap, const version_t ver)
+		: m_dir(dir)
+		, m_cap(cap ? cap : cache_c::dlen)
+		, m_ver(ver)
+		, m_hits(0)
+		, m_misses(0) {
+	}
+
+	bool cache_c::open() const {
+#ifdef Q_POSIX
+		if (::mkdir(m_dir.c_str(), 0755) != 0 && errno != EEXIST) {
+			return false;
+		}
+		struct stat st;
+		return ::stat(m_dir.c_str(), &st) == 0 && S_ISDIR(st.st_mode) && ::access(m_dir.c_str(), W_OK) == 0;
+#else
+		return false;
+#endif
+	}
+
+	cache_c::key_t cache_c::key(const path_t& val) const {
+#ifdef Q_POSIX
+		int fd(::open(val.c_str(), O_RDONLY));
+		if (fd < 0) {
+			return key_t();
+		}
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+			::close(fd);
+			return key_t();
+		}
+		void* src(mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0));
+		::close(fd);
+		if (src == MAP_FAILED) {
+			return key_t();
+		}
+		key_t ret(cache_c::hash(static_cast<const loc_t*>(src), static_cast<size_t>(st.st_size)));
+		munmap(src, static_cast<size_t>(st.st_size));
+		return ret;
+#else
+		(void)val;
+		return key_t();
+#endif
+	}
+
+	bool cache_c::fetch(const key_t& key, process_c& prc) {
+		const path_t img(entry(key.name, "qvm")), lib(entry(key.name, "so"));
+		uint32_t vrf(0);
+		const uint8_t st(meta(key, vrf));
+		if (st == 1) { // none, or the entry of another source with the same name
+			++m_misses;
+			return false;
+		}
+		std::ifstream chk(img, std::ios_base::binary);
+		if (st == 2 || !chk.is_open()) { // stale
+			chk.close();
+			drop(key.name);
+			++m_misses;
+			return false;
+		}
+		chk.close();
+		if (!prc.image.load(img) || prc.image.code_length() == 0 || prc.image.code_length() % sizeof(process_c::instr_t) != 0) {
+			prc.image.close();
+			drop(key.name);
+			++m_misses;
+			return false;
+		}
+		prc.verified = vrf != 0;
+
+#ifdef Q_POSIX
+		utimensat(AT_FDCWD, entry(key.name, "meta").c_str(), nullptr, 0); // most recently used
+		struct stat lst;
+		if (aot_c::supported() && ::stat(lib.c_str(), &lst) == 0 && !prc.link(lib)) {
+			std::remove(lib.c_str()); // built by another version
+		}
+#endif
+		++m_hits;
+		return true;
+	}
+
+	bool cache_c::store(const key_t& key, const process_c& prc) {
+		try {
+			// written aside, then renamed: a reader never sees half an entry, nor the description
+			// of the previous one over the new image
+			std::remove(entry(key.name, "meta").c_str());
+			std::remove(entry(key.name, "so").c_str()); // built for the previous content
+			path_t tmp(aside(m_dir));
+			if (tmp.empty() || !prc.image.save(tmp, false) || std::rename(tmp.c_str(), entry(key.name, "qvm").c_str()) != 0) {
+				std::remove(tmp.c_str());
+				throw exception_c("can not write the cache entry [" + entry(key.name, "qvm") + "]");
+			}
+			tmp = aside(m_dir);
+			if (tmp.empty()) {
+				throw exception_c("can not write the cache entry [" + entry(key.name, "meta") + "]");
+			}
+			{
+				std::ofstream out(tmp, std::ios_base::out | std::ios_base::trunc);
+				out << "qvm-cache " << cache_c::format << " " << m_ver << " " << (prc.verified ? 1 : 0)
+					<< " " << key.len << " " << hex(key.sum) << "\n";
+				if (!out.good()) {
+					out.close();
+					std::remove(tmp.c_str());
+					throw exception_c("can not write the cache entry [" + entry(key.name, "meta") + "]");
+				}
+			}
+			if (std::rename(tmp.c_str(), entry(key.name, "meta").c_str()) != 0) {
+				std::remove(tmp.c_str());
+				throw exception_c("can not write the cache entry [" + entry(key.name, "meta") + "]");
+			}
+			trim();
+			return true;
+		} catch (const exception_c& exc) {
+			std::cerr << exc.get() << std::endl;
+			return false;
+		}
+	}
+
+	bool cache_c::native(const key_t& key, const path_t& val) {
+		try {
+			uint32_t vrf(0);
+			if (meta(key, vrf) != 0) { // not the entry of this source
+				return false;
+			}
+
+			const path_t tmp(aside(m_dir));
+			if (tmp.empty()) {
+				throw exception_c("can not write the cache entry [" + entry(key.name, "so") + "]");
+			}
+			std::ifstream in(val, std::ios_base::binary);
+			std::ofstream out(tmp, std::ios_base::binary | std::ios_base::trunc);
+			if (!in.is_open() || !out.is_open() || !(out << in.rdbuf()) || !out.flush()) {
+				out.close();
+				std::remove(tmp.c_str());
+				throw exception_c("can not write the cache entry [" + entry(key.name, "so") + "]");
+			}
+			out.close();
+			if (std::rename(tmp.c_str(), entry(key.name, "so").c_str()) != 0) {
+				std::remove(tmp.c_str());
+				throw exception_c("can not write the cache entry [" + entry(key.name, "so") + "]");
+			}
+			trim();
+			return true;
+		} catch (const exception_c& exc) {
+			std::cerr << exc.get() << std::endl;
+			return false;
+		}
+	}
+
+	uint64_t cache_c::hits() const {
+		return m_hits;
+	}
+
+	uint64_t cache_c::misses() const {
+		return m_misses;
+	}
+
+	cache_c::path_t cache_c::entry(const name_t val, const char* ext) const {
+		char buf[32];
+		std::snprintf(buf, sizeof(buf), "/%016llx.", static_cast<unsigned long long>(val));
+		return m_dir + buf + ext;
+	}
+
+	void cache_c::drop(const name_t val) {
+		for (const char* i : exts) {
+			std::remove(entry(val, i).c_str());
+		}
+	}
+
+	uint8_t cache_c::meta(const key_t& key, uint32_t& vrf) const {
+		std::ifstream in(entry(key.name, "meta"));
+		if (!in.is_open()) {
+			return 1;
+		}
+
+		// qvm-cache <format> <vm version> <verified> <source length> <source SHA-256>
+		path_t tag, sum;
+		uint32_t fmt(0), ver(0);
+		len_t len(0);
+		in >> tag >> fmt >> ver >> vrf >> len >> sum;
+		if (tag != "qvm-cache" || fmt != cache_c::format || ver != m_ver) {
+			return 2;
+		}
+		return len == key.len && sum == hex(key.sum) ? 0 : 1;
+	}
+
+	void cache_c::trim() {
+#ifdef Q_POSIX
+		struct use_t {
+			len_t len;
+			int64_t last; // last use (meta written or read), 0 without meta
+		};
+		std::map<name_t, use_t> entries;
+		len_t total(0);
+
+		DIR* dir(opendir(m_dir.c_str()));
+		if (!dir) {
+			return;
+		}
+		while (const dirent* i = readdir(dir)) {
+			const path_t name(i->d_name);
+			const size_t dot(name.find('.'));
+			if (dot != 16 || name.find_first_not_of("0123456789abcdef") != dot) {
+				continue; // not an entry
+			}
+			struct stat st;
+			if (::stat((m_dir + "/" + name).c_str(), &st) != 0) {
+				continue;
+			}
+			use_t& use(entries[std::stoull(name.substr(0, dot), nullptr, 16)]);
+			use.len += static_cast<len_t>(st.st_size);
+			if (name.compare(dot + 1, path_t::npos, "meta") == 0) {
+#ifdef __APPLE__
+				use.last = static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+				use.last = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+			}
+			total += static_cast<len_t>(st.st_size);
+		}
+		closedir(dir);
+		if (total <= m_cap) {
+			return;
+		}
+
+		std::vector<std::pair<int64_t, name_t>> lru;
+		for (const auto& i : entries) {
+			lru.emplace_back(i.second.last, i.first);
+		}
+		std::sort(lru.begin(), lru.end());
+		for (size_t idx(0); idx < lru.size() && total > m_cap; ++idx) {
+			drop(lru[idx].second);
+			total -= entries[lru[idx].second].len;
+		}
+#endif
+	}
+
+	cache_c::key_t cache_c::hash(const loc_t* val, const size_t len) {
+		key_t ret;
+		ret.len = len;
+		ret.sum = sha256_c().run(val, len);
+		ret.name = 0;
+		for (size_t idx(0); idx < sizeof(name_t); ++idx) {
+			ret.name = ret.name << 8 | ret.sum[idx];
+		}
+		ret.name = ret.name ? ret.name : 1; // 0 is no key
+		return ret;
+	}
+
+}
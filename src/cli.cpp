@@ -0,0 +1,486 @@
+#include "../inc/cli.hpp"
+#include "../inc/runtime.hpp"
+#include "../inc/bench.hpp"
+
+#include <iostream> // std::cout, std::cerr
+#include <iomanip>  // std::setw, std::setprecision
+#include <fstream>  // std::ifstream
+#include <sstream>  // std::ostringstream
+#include <iterator> // std::istreambuf_iterator
+#include <cstring>  // std::memcmp
+#include <cstdio>   // std::remove
+#include <cstdlib>  // std::getenv
+#include <algorithm> // std::min
+
+#if defined(__unix__) || defined(__APPLE__)
+#define Q_POSIX
+#include <unistd.h> // getpid
+#endif
+
+namespace vm { /* cli_c */
+
+	cli_c::cli_c(const int argc, char** argv)
+		: m_cmd()
+		, m_args()
+		, m_mem(0)
+		, m_dbg(0)
+		, m_mode(vm_c::engine_e::REFERENCE)
+		, m_engine(false)
+		, m_console()
+		, m_sandbox()
+		, m_profile()
+		, m_sample()
+		, m_interval(0)
+		, m_fixed(false)
+		, m_native()
+		, m_check(false)
+		, m_cache()
+		, m_cap(0)
+		, m_quantum(0) {
+		if (argc > 1) {
+			m_cmd = argv[1];
+		}
+		for (int idx(2); idx < argc; ++idx) {
+			m_args.emplace_back(argv[idx]);
+		}
+	}
+
+	bool cli_c::headless() const {
+		return !m_cmd.empty();
+	}
+
+	int32_t cli_c::run() {
+		try {
+			args_t pos;
+			for (const auto& i : m_args) {
+				if (i.compare(0, 2, "--") == 0) {
+					option(i);
+				} else {
+					pos.push_back(i);
+				}
+			}
+			m_args.swap(pos);
+
+			if (m_cmd == "convert" && m_args.size() == 2) { // hex text to binary image
+				return image_c::convert(m_args[0], m_args[1]) ? 0 : 1;
+			}
+			if (m_cmd == "run" && !m_args.empty()) {
+				return single();
+			}
+			if (m_cmd == "batch" && m_args.size() == 1) {
+				return batch();
+			}
+			if (m_cmd == "scale" && !m_args.empty() && m_args.size() <= 3) {
+				return scale();
+			}
+			if (m_cmd == "bench" && m_args.size() <= 1) {
+				return bench();
+			}
+			if (m_cmd == "verify" && m_args.size() == 1) {
+				return verify();
+			}
+			if (m_cmd == "aot" && m_args.size() == 2) {
+				return aot();
+			}
+			throw exception_c("usage: qvm run <program>[@<priority>]... | batch <manifest> | scale <program> [processes] [workers]"
+				" | bench [filter] | verify <program> | aot <program> <library> [--check]"
+				" | convert <hex> <image> [--mem=<n>[K|M|G]] [--engine=jit|threaded|reference]"
+				" [--debug=regs|stack|both|step] [--console=<dir>] [--sandbox=<dir>]"
+				" [--profile=<file>] [--sample=<file>] [--interval=<us>] [--deterministic] [--native=<library>]"
+				" [--cache=<dir>] [--cache-size=<n>[K|M|G]] [--quantum=<n>]");
+		} catch (const exception_c& exc) {
+			std::cerr << exc.get() << std::endl;
+			return 2;
+		}
+	}
+
+	int32_t cli_c::single() {
+		vm_c qvm(m_mem);
+		configure(qvm);
+		std::unique_ptr<cache_c> kept(cache(qvm));
+
+		// every program but the last is queued, the vm runs until they all ended
+		for (size_t idx(0); idx < m_args.size(); ++idx) {
+			arg_t src;
+			process_c* prc(new process_c());
+			prc->id = static_cast<process_c::id_t>(idx + 1);
+			prc->priority = cli_c::priority(m_args[idx], src);
+			if (!prc->load(src, kept.get()) || (!m_native.empty() && !prc->link(m_native)) || !attach(*prc)) {
+				delete prc;
+				return 1;
+			}
+			if (idx + 1 == m_args.size()) {
+				return qvm.run(prc, m_dbg);
+			}
+			if (!qvm.submit(prc)) { // deleted
+				return 1;
+			}
+		}
+		return 1;
+	}
+
+	int32_t cli_c::batch() {
+		std::ifstream in(m_args[0]);
+		if (!in.is_open()) {
+			throw exception_c("can not read [" + m_args[0] + "]");
+		}
+
+		// relative paths start from the directory of the manifest
+		arg_t dir;
+		size_t sep(m_args[0].find_last_of('/'));
+		if (sep != arg_t::npos) {
+			dir = m_args[0].substr(0, sep + 1);
+		}
+
+		args_t src;
+		for (arg_t line; std::getline(in, line);) {
+			size_t beg(line.find_first_not_of(" \t\r"));
+			if (beg == arg_t::npos || line[beg] == '#') {
+				continue;
+			}
+			size_t end(line.find_last_not_of(" \t\r"));
+			arg_t val(line.substr(beg, end - beg + 1));
+			src.push_back(val[0] == '/' ? val : dir + val);
+		}
+
+		vm_c qvm(m_mem); // one memory for the whole batch, zeroed between programs
+		configure(qvm);
+		std::unique_ptr<cache_c> kept(cache(qvm));
+		qvm.report([&src](const process_c& prc) {
+			auto end(std::chrono::system_clock::now());
+			std::ostringstream out;
+			out << "{\"program\":" << cli_c::quote(src[prc.id - 1])
+				<< ",\"id\":" << prc.id
+				<< ",\"exit\":" << prc.ec
+				<< ",\"instructions\":" << prc.retired
+				<< ",\"faults\":" << prc.faults
+				<< ",\"heap_peak\":" << prc.heap.stats().peak_used
+				<< ",\"heap_fragmentation\":" << prc.heap.fragmentation()
+				<< ",\"cpu\":" << std::chrono::duration_cast<std::chrono::duration<double>>(prc.cpu).count()
+				<< ",\"elapsed\":" << std::chrono::duration_cast<std::chrono::duration<double>>(end - prc.beg).count()
+				<< "}\n";
+			std::cout << out.str();
+		});
+
+		int32_t ret(0);
+		for (size_t idx(0); idx < src.size(); ++idx) {
+			process_c* prc(new process_c());
+			prc->id = static_cast<process_c::id_t>(idx + 1);
+			if (!prc->load(src[idx], kept.get()) || !attach(*prc)) {
+				delete prc;
+				std::cout << "{\"program\":" << cli_c::quote(src[idx]) << ",\"id\":" << idx + 1
+					<< ",\"error\":\"can not load\"}\n";
+				ret = 1;
+				continue;
+			}
+			qvm.reset(); // nothing left by the previous programs
+			qvm.run(prc, m_dbg);
+		}
+		std::cout.flush();
+		return ret;
+	}
+
+	int32_t cli_c::scale() {
+		uint64_t jobs(m_args.size() > 1 ? cli_c::length(m_args[1]) : 0x100);
+		if (jobs == 0 || jobs > 0xFFFFFFFF) {
+			throw exception_c("invalid number of processes [" + m_args[1] + "]");
+		}
+		uint64_t mx(m_args.size() > 2 ? cli_c::length(m_args[2]) : std::min(runtime_c::cores(), runtime_c::mworkers));
+		if (mx == 0 || mx > runtime_c::mworkers) {
+			throw exception_c("invalid number of workers [" + m_args[2] + "] (1 to " + std::to_string(runtime_c::mworkers) + ")");
+		}
+		double one(0);
+
+		std::cout << "workers  seconds  processes  instructions/s  speedup" << std::endl;
+		for (uint32_t cnt(1); cnt <= mx; ++cnt) {
+			runtime_c rt(cnt, m_mem);
+			for (uint32_t idx(0); idx < jobs; ++idx) {
+				process_c* prc(new process_c());
+				if (!prc->load(m_args[0])) {
+					delete prc;
+					return 1;
+				}
+				rt.push(prc);
+			}
+
+			runtime_c::stats_t st(rt.run());
+			double sec(std::chrono::duration_cast<std::chrono::duration<double>>(st.elapsed).count());
+			if (cnt == 1) {
+				one = sec;
+			}
+			std::cout << std::setw(7) << cnt << std::setw(9) << std::fixed << std::setprecision(3) << sec
+				<< std::setw(11) << st.processes
+				<< std::setw(16) << std::setprecision(0) << (sec > 0 ? st.retired / sec : 0)
+				<< std::setw(9) << std::setprecision(2) << (sec > 0 ? one / sec : 0)
+				<< std::endl;
+		}
+		return 0;
+	}
+
+	int32_t cli_c::bench() {
+		bench_c suite(m_args.empty() ? arg_t() : m_args[0], m_mem, m_engine ? &m_mode : nullptr);
+		return suite.run();
+	}
+
+	int32_t cli_c::verify() {
+		image_c img;
+		if (!img.load(m_args[0])) {
+			return 1;
+		}
+		verifier_c ver;
+		bool ret(ver.run(img.code(), img.code_length() & ~image_c::len_t(3)));
+		std::cout << "{\"program\":" << cli_c::quote(m_args[0]) << "," << ver.json().substr(1);
+		return ret ? 0 : 1;
+	}
+
+	int32_t cli_c::aot() {
+		{
+			vm_c qvm(m_mem);
+			std::unique_ptr<cache_c> kept(cache(qvm));
+			process_c prc;
+			if (!prc.load(m_args[0], kept.get()) || !aot_c::build(aot_c::translate(prc.image.code(), prc.image.code_length()), m_args[1])) {
+				return 1;
+			}
+			if (kept) { // linked by the next runs of the program
+				kept->native(kept->key(m_args[0]), m_args[1]);
+			}
+		}
+		if (!m_check) {
+			return 0;
+		}
+
+		// same placement, console in a file: everything the program leaves has to be identical
+		struct result_t {
+			core_c state;
+			int32_t ec;
+			uint64_t retired, faults;
+			image_c::sum_t mem;
+			arg_t out;
+		} res[2];
+		const char* tmp(std::getenv("TMPDIR"));
+		const arg_t dir(tmp && *tmp ? tmp : "/tmp");
+		long pid(0);
+#ifdef Q_POSIX
+		pid = static_cast<long>(::getpid());
+#endif
+		for (uint8_t idx(0); idx < 2; ++idx) {
+			vm_c qvm(m_mem);
+			configure(qvm);
+			qvm.mode(vm_c::engine_e::REFERENCE);
+			qvm.deterministic(true);
+
+			result_t& cur(res[idx]);
+			qvm.report([&cur](const process_c& prc) {
+				cur.state = prc.state;
+				cur.ec = prc.ec;
+				cur.retired = prc.retired;
+				cur.faults = prc.faults;
+			});
+
+			const arg_t out(dir + "/qvm_aot_" + std::to_string(pid) + "_" + std::to_string(idx) + ".out");
+			process_c* prc(new process_c());
+			prc->id = 1;
+			if (!prc->load(m_args[0]) || (idx && !prc->link(m_args[1])) || !prc->console.redirect(out, out + ".in")) {
+				delete prc;
+				return 1;
+			}
+			qvm.run(prc);
+
+			const memory_c& mem(qvm.memory());
+			cur.mem = image_c::checksum(mem.span(0, mem.length()), mem.length());
+			std::ifstream in(out, std::ios_base::binary);
+			cur.out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+			in.close();
+			std::remove(out.c_str());
+		}
+
+		const result_t& ref(res[0]);
+		const result_t& nat(res[1]);
+		const bool regs(std::memcmp(&ref.state, &nat.state, sizeof(core_c)) == 0);
+		const bool same(regs && ref.ec == nat.ec && ref.retired == nat.retired && ref.faults == nat.faults
+			&& ref.mem == nat.mem && ref.out == nat.out);
+		std::cout << "{\"program\":" << cli_c::quote(m_args[0])
+			<< ",\"library\":" << cli_c::quote(m_args[1])
+			<< ",\"identical\":" << (same ? "true" : "false")
+			<< ",\"registers\":" << (regs ? "true" : "false")
+			<< ",\"exit\":[" << ref.ec << "," << nat.ec << "]"
+			<< ",\"instructions\":[" << ref.retired << "," << nat.retired << "]"
+			<< ",\"faults\":[" << ref.faults << "," << nat.faults << "]"
+			<< ",\"memory\":" << (ref.mem == nat.mem ? "true" : "false")
+			<< ",\"output\":" << (ref.out == nat.out ? "true" : "false")
+			<< "}" << std::endl;
+		return same ? 0 : 1;
+	}
+
+	void cli_c::option(const arg_t& val) {
+		size_t sep(val.find('='));
+		arg_t key(val.substr(0, sep)), arg(sep == arg_t::npos ? arg_t() : val.substr(sep + 1));
+
+		if (key == "--mem") {
+			uint64_t len(cli_c::length(arg));
+			if (len == 0 || len > 0xFFFFFFFF) {
+				throw exception_c("invalid memory length [" + arg + "]");
+			}
+			m_mem = static_cast<idx_t>(len);
+		} else if (key == "--engine") {
+			if (arg == "jit") {
+				m_mode = vm_c::engine_e::JIT;
+			} else if (arg == "threaded") {
+				m_mode = vm_c::engine_e::THREADED;
+			} else if (arg == "reference") {
+				m_mode = vm_c::engine_e::REFERENCE;
+			} else {
+				throw exception_c("invalid engine [" + arg + "]");
+			}
+			m_engine = true;
+		} else if (key == "--debug") {
+			if (arg == "regs") {
+				m_dbg = 1;
+			} else if (arg == "stack") {
+				m_dbg = 2;
+			} else if (arg == "both") {
+				m_dbg = 3;
+			} else if (arg == "step") {
+				m_dbg = 4;
+			} else {
+				throw exception_c("invalid debug mode [" + arg + "]");
+			}
+		} else if (key == "--console" && !arg.empty()) {
+			m_console = arg;
+		} else if (key == "--sandbox" && !arg.empty()) {
+			sandbox_c tmp;
+			if (!tmp.open(arg)) {
+				throw exception_c("invalid sandbox [" + arg + "]");
+			}
+			m_sandbox = arg;
+		} else if (key == "--profile" && !arg.empty()) {
+			m_profile = arg;
+		} else if (key == "--sample" && !arg.empty()) {
+			m_sample = arg;
+		} else if (key == "--interval") {
+			uint64_t num(cli_c::length(arg));
+			if (num == 0 || num > 0xFFFFFFFF) {
+				throw exception_c("invalid interval [" + arg + "]");
+			}
+			m_interval = static_cast<uint32_t>(num);
+		} else if (key == "--quantum") {
+			uint64_t num(cli_c::length(arg));
+			if (num == 0) {
+				throw exception_c("invalid quantum [" + arg + "]");
+			}
+			m_quantum = static_cast<int64_t>(num);
+		} else if (key == "--deterministic" && arg.empty()) {
+			m_fixed = true;
+		} else if (key == "--native" && !arg.empty()) {
+			m_native = arg;
+		} else if (key == "--check" && arg.empty()) {
+			m_check = true;
+		} else if (key == "--cache" && !arg.empty()) {
+			m_cache = arg;
+		} else if (key == "--cache-size") {
+			m_cap = cli_c::length(arg);
+			if (m_cap == 0) {
+				throw exception_c("invalid cache size [" + arg + "]");
+			}
+		} else {
+			throw exception_c("invalid option [" + val + "]");
+		}
+	}
+
+	void cli_c::configure(vm_c& val) const {
+		if (m_engine) {
+			val.mode(m_mode);
+		}
+		if (!m_sandbox.empty()) {
+			val.sandbox(m_sandbox);
+		}
+		if (!m_profile.empty()) {
+			val.profile(m_profile);
+		}
+		if (!m_sample.empty()) {
+			val.sample(m_sample, sampler_c::interval(m_interval));
+		}
+		val.deterministic(m_fixed);
+		val.quantum(m_quantum);
+	}
+
+	std::unique_ptr<cache_c> cli_c::cache(const vm_c& val) const {
+		if (m_cache.empty()) {
+			return nullptr;
+		}
+		std::unique_ptr<cache_c> ret(new cache_c(m_cache, m_cap, val.version()));
+		if (!ret->open()) {
+			throw exception_c("invalid cache [" + m_cache + "]");
+		}
+		return ret;
+	}
+
+	bool cli_c::attach(process_c& val) const {
+		if (m_console.empty()) {
+			return true;
+		}
+		arg_t dst(m_console + "/" + std::to_string(val.id));
+		if (!val.console.redirect(dst + ".out", dst + ".in")) {
+			std::cerr << "can not write [" << dst << ".out]" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	uint64_t cli_c::length(const arg_t& val) {
+		uint64_t ret(0);
+		size_t idx(0);
+		for (; idx < val.size() && val[idx] >= '0' && val[idx] <= '9'; ++idx) {
+			ret = ret * 10 + (val[idx] - '0');
+			if (ret > 0xFFFFFFFFull) {
+				return 0;
+			}
+		}
+		if (idx == 0 || idx + 1 < val.size()) {
+			return 0;
+		}
+		if (idx < val.size()) {
+			switch (val[idx]) {
+			case 'K': case 'k': ret <<= 10; break;
+			case 'M': case 'm': ret <<= 20; break;
+			case 'G': case 'g': ret <<= 30; break;
+			default: return 0;
+			}
+		}
+		return ret;
+	}
+
+	process_c::prio_t cli_c::priority(const arg_t& val, arg_t& src) {
+		size_t sep(val.find_last_of('@'));
+		if (sep == arg_t::npos || sep + 1 == val.size()
+			|| val.find_first_not_of("0123456789", sep + 1) != arg_t::npos) { // a path holding '@'
+			src = val;
+			return 0;
+		}
+		uint64_t ret(cli_c::length(val.substr(sep + 1)));
+		if (ret >= scheduler_c::levels) {
+			throw exception_c("invalid priority [" + val.substr(sep + 1) + "]");
+		}
+		src = val.substr(0, sep);
+		return static_cast<process_c::prio_t>(ret);
+	}
+
+	cli_c::arg_t cli_c::quote(const arg_t& val) {
+		static const char hex[] = "0123456789abcdef";
+		arg_t ret("\"");
+		for (unsigned char i : val) {
+			if (i == '"' || i == '\\') {
+				ret += '\\';
+				ret += static_cast<char>(i);
+			} else if (i < 0x20) {
+				ret += "\\u00";
+				ret += hex[i >> 4];
+				ret += hex[i & 0x0F];
+			} else {
+				ret += static_cast<char>(i);
+			}
+		}
+		return ret + "\"";
+	}
+
+}
@@ -0,0 +1,146 @@
+#include "../inc/console.hpp"
+
+#include <iostream> // std::cin, std::cout
+#include <cstdio>   // snprintf, fflush
+#include <charconv> // std::to_chars
+#include <cerrno>   // errno
+
+#if defined(__unix__) || defined(__APPLE__)
+#define Q_POSIX
+#include <fcntl.h>  // open
+#include <unistd.h> // write, close
+#endif
+
+namespace vm { /* console_c */
+
+	console_c::console_c()
+		: m_out()
+		, m_max(console_c::dlen)
+		, m_fd(-1)
+		, m_sink()
+		, m_in(&std::cin)
+		, m_file() {
+	}
+
+	console_c::~console_c() {
+		flush();
+#ifdef Q_POSIX
+		if (m_fd >= 0) {
+			::close(m_fd);
+		}
+#endif
+	}
+
+	bool console_c::redirect(const path_t& out, const path_t& in) {
+#ifdef Q_POSIX
+		int fd(::open(out.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+		if (fd < 0) {
+			return false;
+		}
+		flush();
+		if (m_fd >= 0) {
+			::close(m_fd);
+		}
+		m_fd = fd;
+#else
+		return false;
+#endif
+		m_file.open(in, std::ios_base::in | std::ios_base::binary);
+		m_in = m_file.is_open() ? static_cast<std::istream*>(&m_file) : &std::cin;
+		return true;
+	}
+
+	void console_c::attach(const sink_t& out, std::istream* in) {
+		flush();
+		m_sink = out ? out : sink_t([](const char*, const size_t) {});
+		m_file.close(); // never opened again: reads without a stream fail at once
+		m_in = in ? in : &m_file;
+	}
+
+	void console_c::threshold(const size_t val) {
+		m_max = val;
+		if (m_out.size() >= m_max) {
+			flush();
+		}
+	}
+
+	void console_c::write(const char* val, const size_t len) {
+		m_out.append(val, len);
+		if (m_out.size() < m_max) {
+			return;
+		}
+
+		// full: keep an unterminated line for the next write
+		size_t end(m_out.rfind('\n'));
+		if (end == buf_t::npos || m_max == 0) {
+			flush();
+			return;
+		}
+		buf_t rest(m_out, end + 1);
+		m_out.resize(end + 1);
+		flush();
+		m_out.swap(rest);
+	}
+
+	void console_c::put(const char val) {
+		write(&val, 1);
+	}
+
+	void console_c::put(const uint32_t val) {
+		char tmp[16];
+		write(tmp, static_cast<size_t>(std::to_chars(tmp, tmp + sizeof(tmp), val).ptr - tmp));
+	}
+
+	void console_c::put(const int32_t val) {
+		char tmp[16];
+		write(tmp, static_cast<size_t>(std::to_chars(tmp, tmp + sizeof(tmp), val).ptr - tmp));
+	}
+
+	void console_c::put(const float val) {
+		char tmp[64]; // as std::ostream (%g, 6 digits)
+		int len(snprintf(tmp, sizeof(tmp), "%g", static_cast<double>(val)));
+		write(tmp, len > 0 ? static_cast<size_t>(len) : 0);
+	}
+
+	std::istream& console_c::in() {
+		flush();
+		return *m_in;
+	}
+
+	void console_c::flush() {
+		if (m_out.empty()) {
+			return;
+		}
+		if (m_sink) {
+			m_sink(m_out.data(), m_out.size());
+			m_out.clear();
+			return;
+		}
+#ifdef Q_POSIX
+		int fd(m_fd);
+		if (fd < 0) { // after what the vm has already printed
+			std::cout.flush();
+			fflush(stdout);
+			fd = STDOUT_FILENO;
+		}
+		const char* src(m_out.data());
+		size_t len(m_out.size());
+		while (len) {
+			ssize_t ret(::write(fd, src, len));
+			if (ret < 0 && errno == EINTR) {
+				continue;
+			}
+			if (ret <= 0) {
+				break;
+			}
+			src += ret;
+			len -= static_cast<size_t>(ret);
+		}
+#else
+		std::cout.write(m_out.data(), m_out.size());
+		std::cout.flush();
+#endif
+		m_out.clear();
+	}
+
+}
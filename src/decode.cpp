@@ -0,0 +1,485 @@
+#include "../inc/decode.hpp"
+#include "../inc/vm.hpp"
+
+namespace vm { /* program_c */
+
+	program_c::program_c()
+		: m_code()
+		, m_native()
+		, m_natives(0)
+		, m_tbl(nullptr)
+		, m_state(nullptr)
+		, m_memory(nullptr)
+		, m_csx(0)
+		, m_clx(0)
+		, m_fuse(true)
+		, m_fused{ 0 } {
+	}
+
+	void program_c::decode(core_c& st, memory_c& mem, const reg32_t csx, const reg32_t clx) {
+		if (!mem.valid(csx, clx)) { // the reference engine reports the faults
+			clear();
+			return;
+		}
+		m_state = &st;
+		m_memory = &mem;
+		m_csx = csx;
+		m_clx = clx - (clx % 4);
+		m_tbl = nullptr;
+
+		idx_t len(m_clx / 4);
+		m_code.resize(len + 1);
+		m_native.assign(len, nullptr);
+		m_natives = 0;
+		for (idx_t idx(0); idx < len; ++idx) {
+			m_code[idx] = translate(idx);
+		}
+		m_code[len] = instr_t{ nullptr, nullptr, nullptr, 0, len, 0, op_e::END, 0 };
+
+		if (m_fuse) {
+			optimize();
+		}
+	}
+
+	void program_c::patch(const reg32_t val) {
+		if (m_code.empty() || val - m_csx >= m_clx) {
+			return;
+		}
+		// the previous instruction may have been fused with this one
+		idx_t idx((val - m_csx) / 4), beg(idx ? idx - 1 : idx);
+		for (idx_t i(beg); i <= idx; ++i) {
+			m_code[i] = translate(i);
+		}
+		for (idx_t i(beg); m_fuse && i <= idx; ++i) { // counted by the first decode only
+			combine(i);
+		}
+		for (idx_t i(beg); m_tbl && i <= idx; ++i) {
+			m_code[i].h = m_tbl[static_cast<uint8_t>(m_code[i].op)];
+		}
+	}
+
+	void program_c::link(const void* const* val) {
+		m_tbl = val;
+		for (auto& i : m_code) {
+			i.h = m_tbl[static_cast<uint8_t>(i.op)];
+		}
+	}
+
+	void program_c::native(const idx_t idx, const jit_c::block_t val) {
+		m_native[idx] = val;
+		m_code[idx].op = op_e::NATIVE;
+		if (m_tbl) {
+			m_code[idx].h = m_tbl[static_cast<uint8_t>(op_e::NATIVE)];
+		}
+		++m_natives;
+	}
+
+	void program_c::denative() {
+		for (idx_t idx(0); m_natives && idx < m_native.size(); ++idx) {
+			if (m_native[idx]) {
+				m_native[idx] = nullptr;
+				patch(m_csx + idx * 4);
+			}
+		}
+		m_natives = 0;
+	}
+
+	void program_c::optimize() {
+		for (auto& i : m_fused) {
+			i = 0;
+		}
+		// a jump landing on the second instruction of a pair still runs its own slot
+		for (idx_t idx(0); idx + 1 < length(); ++idx) {
+			const fuse_e kind(combine(idx));
+			if (kind != fuse_e::COUNT) {
+				++m_fused[static_cast<uint8_t>(kind)];
+				++idx;
+			}
+		}
+		if (m_tbl) {
+			link(m_tbl);
+		}
+	}
+
+	void program_c::clear() {
+		m_code.clear();
+		m_native.clear();
+		m_natives = 0;
+		m_tbl = nullptr;
+	}
+
+	void program_c::fuse(const bool val) {
+		m_fuse = val;
+	}
+
+	uint32_t program_c::fused(const fuse_e val) const {
+		return m_fused[static_cast<uint8_t>(val)];
+	}
+
+	const char* program_c::name(const fuse_e val) {
+		switch (val) {
+		case fuse_e::CMP_JIT:
+			return "cmp+jit";
+		case fuse_e::CMP_JIF:
+			return "cmp+jif";
+		case fuse_e::SUB_JIT:
+			return "sub+jit";
+		case fuse_e::SUB_JIF:
+			return "sub+jif";
+		case fuse_e::LDX_ADD:
+			return "ldx+add";
+		default:
+			return "";
+		}
+	}
+
+	bool program_c::valid() const {
+		return !m_code.empty();
+	}
+
+	bool program_c::linked() const {
+		return m_tbl != nullptr;
+	}
+
+	size_t program_c::natives() const {
+		return m_natives;
+	}
+
+	program_c::reg32_t program_c::csx() const {
+		return m_csx;
+	}
+
+	program_c::reg32_t program_c::clx() const {
+		return m_clx;
+	}
+
+	program_c::idx_t program_c::length() const {
+		return m_code.empty() ? 0 : static_cast<idx_t>(m_code.size() - 1);
+	}
+
+	program_c::instr_t* program_c::data() {
+		return m_code.data();
+	}
+
+	jit_c::block_t program_c::block(const idx_t idx) const {
+		return m_native[idx];
+	}
+
+	program_c::instr_t program_c::translate(const idx_t idx) const {
+		constexpr core_c::rega_t csx(core_c::xregs + 0), ipx(core_c::xregs + 1), slx(core_c::xregs + 5);
+
+		const memory_c::loc_t* ins(m_memory->span(m_csx + idx * 4, 4)); // checked by decode
+		uint8_t
+			a(ins[0]),
+			b(ins[1]),
+			c(ins[2]),
+			d(ins[3]);
+
+		instr_t ret{ nullptr, nullptr, nullptr, (static_cast<reg32_t>(c) << 8) | d, 0, 0, op_e::GENERIC, 0 };
+		bool generic(false);
+
+		// the handlers neither keep ipx up to date nor place the stack,
+		// so anything reading ipx or writing csx, ipx or slx stays in the engine,
+		// as does an invalid register address (checked here once, not on every access)
+		auto dst = [&](const uint8_t r) {
+			generic |= (r == csx || r == ipx || r == slx || r >= core_c::nregs);
+			return &m_state->get(r);
+		};
+		auto src = [&](const uint8_t r) {
+			generic |= (r == ipx || r >= core_c::nregs);
+			return &m_state->get(r);
+		};
+		// a taken jump sets ipx, then the step adds 4
+		auto jump = [&](const reg32_t val) {
+			reg32_t next(m_csx + val + 4);
+			if (next < m_csx || (next - m_csx) % 4 != 0) {
+				generic = true;
+				return idx_t(0);
+			}
+			return (next - m_csx) >= m_clx ? m_clx / 4 : (next - m_csx) / 4;
+		};
+
+		auto as = [&](const op_e op) {
+			ret.op = generic ? op_e::GENERIC : op;
+		};
+
+		switch (a) {
+		case 0x00: // nop
+			as(op_e::NOP);
+			break;
+
+		case 0x01: // ldx x,v
+			ret.r0 = dst(b);
+			as(op_e::LDX_V);
+			break;
+
+		case 0x02: // ldx x,x
+			ret.r0 = dst(b);
+			ret.r1 = src(c);
+			as(op_e::LDX_X);
+			break;
+
+		case 0x03: // set v
+			ret.imm = b;
+			as(op_e::SET_V);
+			break;
+
+		case 0x04: // set x
+			ret.r0 = src(b);
+			as(op_e::SET_X);
+			break;
+
+		case 0x05: // get x
+			ret.r0 = dst(b);
+			as(op_e::GET_X);
+			break;
+
+		case 0x25: // ldw x
+			ret.r0 = dst(b);
+			ret.imm = (c & 1) * 2;
+			as(op_e::LDW_X);
+			break;
+
+		case 0x26: // stw x
+			ret.r0 = src(b);
+			ret.imm = (c & 1) * 2;
+			as(op_e::STW_X);
+			break;
+
+		case 0x27: // ldd x
+			ret.r0 = dst(b);
+			ret.imm = (c & 1) * 4;
+			as(op_e::LDD_X);
+			break;
+
+		case 0x28: // std x
+			ret.r0 = src(b);
+			ret.imm = (c & 1) * 4;
+			as(op_e::STD_X);
+			break;
+
+		case 0x08: // jit v,v
+			ret.imm = d;
+			ret.tgt = jump((static_cast<reg32_t>(b) << 8) | c);
+			as(op_e::JIT_VV);
+			break;
+
+		case 0x09: // jit v,x
+			ret.r1 = src(d);
+			ret.tgt = jump((static_cast<reg32_t>(b) << 8) | c);
+			as(op_e::JIT_VX);
+			break;
+
+		case 0x0C: // jif v,v
+			ret.imm = d;
+			ret.tgt = jump((static_cast<reg32_t>(b) << 8) | c);
+			as(op_e::JIF_VV);
+			break;
+
+		case 0x0D: // jif v,x
+			ret.r1 = src(d);
+			ret.tgt = jump((static_cast<reg32_t>(b) << 8) | c);
+			as(op_e::JIF_VX);
+			break;
+
+		case 0x10: // add x,v
+			ret.r0 = dst(b);
+			as(op_e::ADD_V);
+			break;
+
+		case 0x11: // add x,x
+			ret.r0 = dst(b);
+			ret.r1 = src(c);
+			as(op_e::ADD_X);
+			break;
+
+		case 0x12: // sub x,v (compares with the register at c, as the engine does)
+			ret.r0 = dst(b);
+			ret.r1 = src(c);
+			as(op_e::SUB_V);
+			break;
+
+		case 0x13: // sub x,x
+			ret.r0 = dst(b);
+			ret.r1 = src(c);
+			as(op_e::SUB_X);
+			break;
+
+		case 0x14: // mul x,v
+			ret.r0 = dst(b);
+			as(op_e::MUL_V);
+			break;
+
+		case 0x15: // mul x,x
+			ret.r0 = dst(b);
+			ret.r1 = src(c);
+			as(op_e::MUL_X);
+			break;
+
+		case 0x16: // div x,v
+			ret.r0 = dst(b);
+			generic |= (ret.imm == 0);
+			as(op_e::DIV_V);
+			break;
+
+		case 0x17: // div x,x
+			ret.r0 = dst(b);
+			ret.r1 = src(c);
+			as(op_e::DIV_X);
+			break;
+
+		case 0x18: // and x,v
+			ret.r0 = dst(b);
+			as(op_e::AND_V);
+			break;
+
+		case 0x19: // and x,x
+			ret.r0 = dst(b);
+			ret.r1 = src(c);
+			as(op_e::AND_X);
+			break;
+
+		case 0x1A: // or x,v
+			ret.r0 = dst(b);
+			as(op_e::OR_V);
+			break;
+
+		case 0x1B: // or x,x
+			ret.r0 = dst(b);
+			ret.r1 = src(c);
+			as(op_e::OR_X);
+			break;
+
+		case 0x1C: // xor x,v
+			ret.r0 = dst(b);
+			as(op_e::XOR_V);
+			break;
+
+		case 0x1D: // xor x,x
+			ret.r0 = dst(b);
+			ret.r1 = src(c);
+			as(op_e::XOR_X);
+			break;
+
+		case 0x1E: // shl x,v
+			ret.r0 = dst(b);
+			as(op_e::SHL_V);
+			break;
+
+		case 0x1F: // shl x,x
+			ret.r0 = dst(b);
+			ret.r1 = src(c);
+			as(op_e::SHL_X);
+			break;
+
+		case 0x20: // shr x,v
+			ret.r0 = dst(b);
+			as(op_e::SHR_V);
+			break;
+
+		case 0x21: // shr x,x
+			ret.r0 = dst(b);
+			ret.r1 = src(c);
+			as(op_e::SHR_X);
+			break;
+
+		case 0x22: // not x
+			ret.r0 = dst(b);
+			as(op_e::NOT_X);
+			break;
+
+		case 0x23: // cmp x,v
+			ret.r0 = src(b);
+			as(op_e::CMP_V);
+			break;
+
+		case 0x24: // cmp x,x
+			ret.r0 = src(b);
+			ret.r1 = src(c);
+			as(op_e::CMP_X);
+			break;
+
+		default: // exc, register jumps and invalid instructions
+			ret.op = op_e::GENERIC;
+			break;
+		}
+
+		return ret;
+	}
+
+}
+
+namespace vm { /* program_c (superinstructions) */
+
+	program_c::fuse_e program_c::combine(const idx_t idx) {
+		instr_t& fst(m_code[idx]);
+		const instr_t& snd(m_code[idx + 1]);
+
+		op_e op(op_e::GENERIC);
+		fuse_e kind(fuse_e::COUNT);
+
+		switch (fst.op) {
+		case op_e::CMP_V:
+			switch (snd.op) {
+			case op_e::JIT_VV: op = op_e::CMPV_JITV; kind = fuse_e::CMP_JIT; break;
+			case op_e::JIF_VV: op = op_e::CMPV_JIFV; kind = fuse_e::CMP_JIF; break;
+			case op_e::JIT_VX: op = op_e::CMPV_JITX; kind = fuse_e::CMP_JIT; break;
+			case op_e::JIF_VX: op = op_e::CMPV_JIFX; kind = fuse_e::CMP_JIF; break;
+			default: break;
+			}
+			break;
+
+		case op_e::CMP_X:
+			switch (snd.op) {
+			case op_e::JIT_VV: op = op_e::CMPX_JITV; kind = fuse_e::CMP_JIT; break;
+			case op_e::JIF_VV: op = op_e::CMPX_JIFV; kind = fuse_e::CMP_JIF; break;
+			default: break;
+			}
+			break;
+
+		case op_e::SUB_V:
+			switch (snd.op) {
+			case op_e::JIT_VV: op = op_e::SUBV_JITV; kind = fuse_e::SUB_JIT; break;
+			case op_e::JIF_VV: op = op_e::SUBV_JIFV; kind = fuse_e::SUB_JIF; break;
+			default: break;
+			}
+			break;
+
+		case op_e::SUB_X:
+			switch (snd.op) {
+			case op_e::JIT_VV: op = op_e::SUBX_JITV; kind = fuse_e::SUB_JIT; break;
+			case op_e::JIF_VV: op = op_e::SUBX_JIFV; kind = fuse_e::SUB_JIF; break;
+			default: break;
+			}
+			break;
+
+		case op_e::LDX_V: // ldx a,v + add b,a
+			if (snd.op == op_e::ADD_X && snd.r1 == fst.r0) {
+				op = op_e::LDXV_ADDX;
+				kind = fuse_e::LDX_ADD;
+			}
+			break;
+
+		default:
+			break;
+		}
+
+		if (op == op_e::GENERIC) {
+			return fuse_e::COUNT;
+		}
+
+		if (op == op_e::LDXV_ADDX) {
+			fst.r1 = snd.r0;
+		} else {
+			fst.tgt = snd.tgt;
+			if (snd.op == op_e::JIT_VX || snd.op == op_e::JIF_VX) {
+				fst.r1 = snd.r1;
+			} else {
+				fst.cc = static_cast<uint8_t>(snd.imm);
+			}
+		}
+		fst.op = op;
+		return kind;
+	}
+
+}
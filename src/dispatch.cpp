@@ -0,0 +1,445 @@
+#include "../inc/vm.hpp"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define Q_THREADED // labels as values
+#endif
+
+// the fuel (and the sampling flag) is checked on taken jumps only, a straight run always ends in
+// the code segment
+#define Q_SAMPLE()  if (S && m_sampler.due()) { ++m_prc->samples[static_cast<idx_t>(ip - base) * 4]; }
+#define Q_YIELD()   Q_SAMPLE(); if (fuel <= 0) { m_state.ipx() = csx + static_cast<reg32_t>(ip - base) * 4; return 2; }
+
+// transfers of control of a profiled process, a taken pair leaves from its second instruction
+#define Q_ENTER()   if (P) { prf->enter(static_cast<idx_t>(ip - base)); }
+#define Q_TAKE(n)   if (P) { prf->take(static_cast<idx_t>(ip - base) + (n) - 1); }
+
+#ifdef Q_THREADED
+#define Q_OP(name)  l_##name:
+#define Q_DISPATCH() goto *ip->h
+#define Q_NEXT()    { --fuel; goto *(++ip)->h; }
+#define Q_SKIP()    { fuel -= 2; ip += 2; goto *ip->h; }
+#define Q_JUMP(val, n) { fuel -= (n); Q_TAKE(n); ip = base + (val); if (++ip->hits == hot) { heat(static_cast<idx_t>(ip - base)); } Q_YIELD(); Q_ENTER(); goto *ip->h; }
+#else
+#define Q_OP(name)  case op_e::name: l_##name:
+#define Q_DISPATCH() continue
+#define Q_NEXT()    { --fuel; ++ip; continue; }
+#define Q_SKIP()    { fuel -= 2; ip += 2; continue; }
+#define Q_JUMP(val, n) { fuel -= (n); Q_TAKE(n); ip = base + (val); if (++ip->hits == hot) { heat(static_cast<idx_t>(ip - base)); } Q_YIELD(); Q_ENTER(); continue; }
+#endif
+
+namespace vm {
+
+	int32_t vm_c::dispatch(int64_t& fuel) {
+		if (m_prc->profile) {
+			return interpret<true, false>(fuel);
+		}
+		return m_sampler.enabled() ? interpret<false, true>(fuel) : interpret<false, false>(fuel);
+	}
+
+	template <bool P, bool S>
+	int32_t vm_c::interpret(int64_t& fuel) {
+		using op_e    = program_c::op_e;
+		using reg32_t = core_c::reg32_t;
+
+		program_c& prog(m_prc->prog);
+		const reg32_t csx(prog.csx()), end(csx + prog.clx());
+		const uint32_t hot(m_jit.threshold()); // 0: interpret only
+
+#ifdef Q_THREADED
+		static const void* const tbl[] = {
+			&&l_NOP,
+			&&l_LDX_V, &&l_LDX_X,
+			&&l_SET_V, &&l_SET_X, &&l_GET_X,
+			&&l_LDW_X, &&l_STW_X, &&l_LDD_X, &&l_STD_X,
+			&&l_JIT_VV, &&l_JIT_VX, &&l_JIF_VV, &&l_JIF_VX,
+			&&l_ADD_V, &&l_ADD_X, &&l_SUB_V, &&l_SUB_X, &&l_MUL_V, &&l_MUL_X, &&l_DIV_V, &&l_DIV_X,
+			&&l_AND_V, &&l_AND_X, &&l_OR_V, &&l_OR_X, &&l_XOR_V, &&l_XOR_X,
+			&&l_SHL_V, &&l_SHL_X, &&l_SHR_V, &&l_SHR_X,
+			&&l_NOT_X, &&l_CMP_V, &&l_CMP_X,
+			&&l_CMPV_JITV, &&l_CMPV_JIFV, &&l_CMPV_JITX, &&l_CMPV_JIFX, &&l_CMPX_JITV, &&l_CMPX_JIFV,
+			&&l_SUBV_JITV, &&l_SUBV_JIFV, &&l_SUBX_JITV, &&l_SUBX_JIFV,
+			&&l_LDXV_ADDX,
+			&&l_NATIVE,
+			&&l_GENERIC,
+			&&l_END,
+		};
+		static_assert(sizeof(tbl) / sizeof(*tbl) == static_cast<size_t>(op_e::COUNT), "missing handler");
+
+		if (!prog.linked()) {
+			prog.link(tbl);
+		}
+#endif
+		profile_c* const prf(m_prc->profile.get());
+
+		if (m_state.ipx() >= end) {
+			return 0;
+		}
+		if (m_state.csx() != csx || m_state.ipx() < csx || (m_state.ipx() - csx) % 4 != 0) {
+			return 1;
+		}
+
+		program_c::instr_t* const base(prog.data());
+		program_c::instr_t* ip(base + (m_state.ipx() - csx) / 4);
+
+		Q_ENTER();
+
+#ifdef Q_THREADED
+		Q_DISPATCH();
+		{
+#else
+		while (true) {
+			switch (ip->op) {
+#endif
+
+		Q_OP(NOP)
+			Q_NEXT();
+
+		Q_OP(LDX_V)
+			*ip->r0 = ip->imm;
+			Q_NEXT();
+
+		Q_OP(LDX_X)
+			*ip->r0 = *ip->r1;
+			Q_NEXT();
+
+		Q_OP(SET_V)
+			m_memory.get(m_state.ax()) = static_cast<loc_t>(ip->imm);
+			if (m_state.ax() - csx < prog.clx()) {
+				patch(m_state.ax());
+			}
+			Q_NEXT();
+
+		Q_OP(SET_X)
+			m_memory.get(m_state.ax()) = static_cast<loc_t>(*ip->r0);
+			if (m_state.ax() - csx < prog.clx()) {
+				patch(m_state.ax());
+			}
+			Q_NEXT();
+
+		Q_OP(GET_X)
+			*ip->r0 = m_memory.get(m_state.ax());
+			Q_NEXT();
+
+		Q_OP(LDW_X)
+			{
+				uint16_t tmp(0);
+				m_memory.load16(m_state.ax(), tmp);
+				*ip->r0 = tmp;
+			}
+			m_state.ax() += ip->imm;
+			Q_NEXT();
+
+		Q_OP(STW_X)
+			if (m_memory.store16(m_state.ax(), static_cast<uint16_t>(*ip->r0)) && m_state.ax() < end && m_state.ax() + 2 > csx) {
+				touch(m_state.ax(), 2);
+			}
+			m_state.ax() += ip->imm;
+			Q_NEXT();
+
+		Q_OP(LDD_X)
+			{
+				uint32_t tmp(0);
+				m_memory.load32(m_state.ax(), tmp);
+				*ip->r0 = tmp;
+			}
+			m_state.ax() += ip->imm;
+			Q_NEXT();
+
+		Q_OP(STD_X)
+			if (m_memory.store32(m_state.ax(), *ip->r0) && m_state.ax() < end && m_state.ax() + 4 > csx) {
+				touch(m_state.ax(), 4);
+			}
+			m_state.ax() += ip->imm;
+			Q_NEXT();
+
+		Q_OP(JIT_VV)
+			if (m_state.fx() == ip->imm) {
+				Q_JUMP(ip->tgt, 1);
+			}
+			Q_NEXT();
+
+		Q_OP(JIT_VX)
+			if (m_state.fx() == *ip->r1) {
+				Q_JUMP(ip->tgt, 1);
+			}
+			Q_NEXT();
+
+		Q_OP(JIF_VV)
+			if (m_state.fx() != ip->imm) {
+				Q_JUMP(ip->tgt, 1);
+			}
+			Q_NEXT();
+
+		Q_OP(JIF_VX)
+			if (m_state.fx() != *ip->r1) {
+				Q_JUMP(ip->tgt, 1);
+			}
+			Q_NEXT();
+
+		Q_OP(ADD_V)
+			*ip->r0 += ip->imm;
+			Q_NEXT();
+
+		Q_OP(ADD_X)
+			*ip->r0 += *ip->r1;
+			Q_NEXT();
+
+		Q_OP(SUB_V)
+			m_state.fx() = compare_flags(*ip->r0, *ip->r1);
+			*ip->r0 -= ip->imm;
+			Q_NEXT();
+
+		Q_OP(SUB_X)
+			m_state.fx() = compare_flags(*ip->r0, *ip->r1);
+			*ip->r0 -= *ip->r1;
+			Q_NEXT();
+
+		Q_OP(MUL_V)
+			*ip->r0 *= ip->imm;
+			Q_NEXT();
+
+		Q_OP(MUL_X)
+			*ip->r0 *= *ip->r1;
+			Q_NEXT();
+
+		Q_OP(DIV_V)
+			*ip->r0 /= ip->imm;
+			Q_NEXT();
+
+		Q_OP(DIV_X)
+			if (*ip->r1 == 0) {
+				goto l_GENERIC; // reported by the engine
+			}
+			*ip->r0 /= *ip->r1;
+			Q_NEXT();
+
+		Q_OP(AND_V)
+			*ip->r0 &= ip->imm;
+			Q_NEXT();
+
+		Q_OP(AND_X)
+			*ip->r0 &= *ip->r1;
+			Q_NEXT();
+
+		Q_OP(OR_V)
+			*ip->r0 |= ip->imm;
+			Q_NEXT();
+
+		Q_OP(OR_X)
+			*ip->r0 |= *ip->r1;
+			Q_NEXT();
+
+		Q_OP(XOR_V)
+			*ip->r0 ^= ip->imm;
+			Q_NEXT();
+
+		Q_OP(XOR_X)
+			*ip->r0 ^= *ip->r1;
+			Q_NEXT();
+
+		Q_OP(SHL_V)
+			*ip->r0 <<= ip->imm;
+			Q_NEXT();
+
+		Q_OP(SHL_X)
+			*ip->r0 <<= *ip->r1;
+			Q_NEXT();
+
+		Q_OP(SHR_V)
+			*ip->r0 >>= ip->imm;
+			Q_NEXT();
+
+		Q_OP(SHR_X)
+			*ip->r0 >>= *ip->r1;
+			Q_NEXT();
+
+		Q_OP(NOT_X)
+			*ip->r0 = ~*ip->r0;
+			Q_NEXT();
+
+		Q_OP(CMP_V)
+			m_state.fx() = compare_flags(*ip->r0, ip->imm);
+			Q_NEXT();
+
+		Q_OP(CMP_X)
+			m_state.fx() = compare_flags(*ip->r0, *ip->r1);
+			Q_NEXT();
+
+		/* superinstructions, a pair ends on the instruction after the second */
+
+		Q_OP(CMPV_JITV)
+			m_state.fx() = compare_flags(*ip->r0, ip->imm);
+			if (m_state.fx() == ip->cc) {
+				Q_JUMP(ip->tgt, 2);
+			}
+			Q_SKIP();
+
+		Q_OP(CMPV_JIFV)
+			m_state.fx() = compare_flags(*ip->r0, ip->imm);
+			if (m_state.fx() != ip->cc) {
+				Q_JUMP(ip->tgt, 2);
+			}
+			Q_SKIP();
+
+		Q_OP(CMPV_JITX)
+			m_state.fx() = compare_flags(*ip->r0, ip->imm);
+			if (m_state.fx() == *ip->r1) {
+				Q_JUMP(ip->tgt, 2);
+			}
+			Q_SKIP();
+
+		Q_OP(CMPV_JIFX)
+			m_state.fx() = compare_flags(*ip->r0, ip->imm);
+			if (m_state.fx() != *ip->r1) {
+				Q_JUMP(ip->tgt, 2);
+			}
+			Q_SKIP();
+
+		Q_OP(CMPX_JITV)
+			m_state.fx() = compare_flags(*ip->r0, *ip->r1);
+			if (m_state.fx() == ip->cc) {
+				Q_JUMP(ip->tgt, 2);
+			}
+			Q_SKIP();
+
+		Q_OP(CMPX_JIFV)
+			m_state.fx() = compare_flags(*ip->r0, *ip->r1);
+			if (m_state.fx() != ip->cc) {
+				Q_JUMP(ip->tgt, 2);
+			}
+			Q_SKIP();
+
+		Q_OP(SUBV_JITV)
+			m_state.fx() = compare_flags(*ip->r0, *ip->r1);
+			*ip->r0 -= ip->imm;
+			if (m_state.fx() == ip->cc) {
+				Q_JUMP(ip->tgt, 2);
+			}
+			Q_SKIP();
+
+		Q_OP(SUBV_JIFV)
+			m_state.fx() = compare_flags(*ip->r0, *ip->r1);
+			*ip->r0 -= ip->imm;
+			if (m_state.fx() != ip->cc) {
+				Q_JUMP(ip->tgt, 2);
+			}
+			Q_SKIP();
+
+		Q_OP(SUBX_JITV)
+			m_state.fx() = compare_flags(*ip->r0, *ip->r1);
+			*ip->r0 -= *ip->r1;
+			if (m_state.fx() == ip->cc) {
+				Q_JUMP(ip->tgt, 2);
+			}
+			Q_SKIP();
+
+		Q_OP(SUBX_JIFV)
+			m_state.fx() = compare_flags(*ip->r0, *ip->r1);
+			*ip->r0 -= *ip->r1;
+			if (m_state.fx() != ip->cc) {
+				Q_JUMP(ip->tgt, 2);
+			}
+			Q_SKIP();
+
+		Q_OP(LDXV_ADDX)
+			*ip->r0 = ip->imm;
+			*ip->r1 += *ip->r0;
+			Q_SKIP();
+
+		Q_OP(NATIVE)
+			ip = base + prog.block(static_cast<idx_t>(ip - base))(reinterpret_cast<reg32_t*>(&m_state), &fuel);
+			Q_YIELD();
+			Q_DISPATCH();
+
+		Q_OP(GENERIC)
+			{
+				m_state.ipx() = csx + static_cast<reg32_t>(ip - base) * 4;
+				const loc_t* ins(&m_memory.at(m_state.ipx())); // the code segment is checked by decode
+				int32_t ret(engine(ins[0], ins[1], ins[2], ins[3]));
+				m_state.ipx() += 4;
+				--fuel;
+
+				const bool moved(m_state.ipx() != csx + static_cast<reg32_t>(ip - base + 1) * 4);
+				if (P && moved) {
+					prf->take(static_cast<idx_t>(ip - base));
+				} else if (P) { // the next run is an entry
+					prf->leave(static_cast<idx_t>(ip - base));
+				}
+				if (ret == 2) {
+					return 3; // parked, resumed from ipx
+				}
+				if (ret == 0 || m_state.ipx() >= end) {
+					return 0;
+				}
+				if (m_state.csx() != csx || m_state.ipx() < csx || (m_state.ipx() - csx) % 4 != 0) {
+					return 1; // moved out of the decoded program
+				}
+				if (fuel <= 0) {
+					return 2;
+				}
+				ip = base + (m_state.ipx() - csx) / 4;
+				Q_ENTER();
+			}
+			Q_DISPATCH();
+
+		Q_OP(END)
+			m_state.ipx() = end;
+			return 0;
+
+#ifdef Q_THREADED
+		}
+#else
+			default:
+				return 1;
+			}
+		}
+#endif
+
+		return 1;
+	}
+
+	void vm_c::heat(const program_c::idx_t idx) {
+		program_c& prog(m_prc->prog);
+		jit_c::block_t blk(m_jit.compile(m_memory, prog.csx(), prog.clx(), idx));
+		if (blk) {
+			prog.native(idx, blk);
+		}
+	}
+
+	void vm_c::touch(const idx_t val, const idx_t len) {
+		if (m_prc && m_prc->aot) {
+			m_prc->aot->invalidate(val, len);
+		}
+		if (!m_prc || !m_prc->prog.valid() || len == 0) {
+			return;
+		}
+		program_c& prog(m_prc->prog);
+		const idx_t beg(prog.csx()), end(beg + prog.clx());
+		if (val >= end || val + len <= beg) {
+			return;
+		}
+		idx_t idx(val > beg ? val - (val - beg) % 4 : beg);
+		for (; idx < end && idx < val + len; idx += 4) {
+			patch(idx);
+		}
+	}
+
+	void vm_c::patch(const idx_t val) {
+		program_c& prog(m_prc->prog);
+		prog.patch(val);
+		if (prog.natives()) { // a block may contain the modified instruction
+			prog.denative();
+		}
+	}
+
+}
+
+#undef Q_JUMP
+#undef Q_YIELD
+#undef Q_SAMPLE
+#undef Q_ENTER
+#undef Q_TAKE
+#undef Q_SKIP
+#undef Q_NEXT
+#undef Q_DISPATCH
+#undef Q_OP
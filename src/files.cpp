@@ -0,0 +1,286 @@
+#include "../inc/files.hpp"
+#include "../inc/vm.hpp"
+
+#include <algorithm> // std::min
+
+#if defined(__unix__) || defined(__APPLE__)
+#define Q_POSIX
+#include <fcntl.h>    // open, openat
+#include <sys/stat.h> // fstat
+#include <unistd.h>   // pread, lseek, close, unlinkat
+#include <cerrno>     // errno
+#endif
+
+namespace vm { /* sandbox_c */
+
+	sandbox_c::sandbox_c()
+		: m_fd(-1)
+		, m_path() {
+	}
+
+	sandbox_c::~sandbox_c() {
+#ifdef Q_POSIX
+		if (m_fd >= 0) {
+			::close(m_fd);
+		}
+#endif
+	}
+
+	bool sandbox_c::open(const path_t& val) {
+#ifdef Q_POSIX
+		int fd(::open(val.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+		if (fd < 0) {
+			return false;
+		}
+		if (m_fd >= 0) {
+			::close(m_fd);
+		}
+		m_fd = fd;
+		m_path = val;
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	bool sandbox_c::valid() const {
+		return m_fd >= 0;
+	}
+
+	int sandbox_c::fd() const {
+		return m_fd;
+	}
+
+	const sandbox_c::path_t& sandbox_c::path() const {
+		return m_path;
+	}
+
+	int sandbox_c::walk(const path_t& val, path_t& name) const {
+#ifdef Q_POSIX
+		if (m_fd < 0) {
+			return -1;
+		}
+		int ret(openat(m_fd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+		size_t beg(0), end(val.find('/'));
+		while (ret >= 0 && end != path_t::npos) {
+			if (end > beg) { // "a//b"
+				int fd(openat(ret, val.substr(beg, end - beg).c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC));
+				::close(ret);
+				ret = fd;
+			}
+			beg = end + 1;
+			end = val.find('/', beg);
+		}
+		name = val.substr(beg);
+		if (ret >= 0 && name.empty()) { // "a/"
+			::close(ret);
+			ret = -1;
+		}
+		return ret;
+#else
+		(void)val;
+		(void)name;
+		return -1;
+#endif
+	}
+
+	bool sandbox_c::safe(const path_t& val) {
+		if (val.empty() || val[0] == '/' || val.find('\0') != path_t::npos) {
+			return false;
+		}
+		size_t beg(0);
+		while (beg <= val.size()) {
+			size_t end(val.find('/', beg));
+			if (end == path_t::npos) {
+				end = val.size();
+			}
+			if (val.compare(beg, end - beg, "..") == 0) {
+				return false;
+			}
+			beg = end + 1;
+		}
+		return true;
+	}
+
+}
+
+namespace vm { /* files_c */
+
+	files_c::files_c()
+		: m_fds()
+		, m_maps() {
+	}
+
+	files_c::~files_c() {
+		for (fd_t idx(0); idx < m_fds.size(); ++idx) {
+			close(idx);
+		}
+	}
+
+	files_c::fd_t files_c::open(const sandbox_c& box, const path_t& val, const uint32_t mode) {
+#ifdef Q_POSIX
+		if (!box.valid() || !sandbox_c::safe(val)) {
+			return files_c::bad;
+		}
+
+		bool rd((mode & static_cast<uint32_t>(mode_e::READ)) != 0), wr((mode & static_cast<uint32_t>(mode_e::WRITE)) != 0);
+		int flg(O_CLOEXEC | O_NOFOLLOW | (rd && wr ? O_RDWR : wr ? O_WRONLY : O_RDONLY));
+		if (wr && (mode & static_cast<uint32_t>(mode_e::CREATE))) {
+			flg |= O_CREAT;
+		}
+		if (wr && (mode & static_cast<uint32_t>(mode_e::TRUNCATE))) {
+			flg |= O_TRUNC;
+		}
+		if (wr && (mode & static_cast<uint32_t>(mode_e::APPEND))) {
+			flg |= O_APPEND;
+		}
+
+		fd_t ret(0);
+		while (ret < m_fds.size() && m_fds[ret] >= 0) {
+			++ret;
+		}
+		if (ret >= files_c::mfds) {
+			return files_c::bad;
+		}
+
+		path_t name;
+		int dir(box.walk(val, name));
+		if (dir < 0) {
+			return files_c::bad;
+		}
+		int fd(openat(dir, name.c_str(), flg, 0644));
+		::close(dir);
+		if (fd < 0) {
+			return files_c::bad;
+		}
+		if (ret == m_fds.size()) {
+			m_fds.push_back(fd);
+		} else {
+			m_fds[ret] = fd;
+		}
+		return ret;
+#else
+		return files_c::bad;
+#endif
+	}
+
+	uint32_t files_c::close(const fd_t val) {
+		int fd(host(val));
+		if (fd < 0) {
+			return files_c::bad;
+		}
+#ifdef Q_POSIX
+		::close(fd);
+#endif
+		m_fds[val] = -1;
+		return 0;
+	}
+
+	uint32_t files_c::seek(const fd_t val, const int32_t off, const uint32_t org) {
+#ifdef Q_POSIX
+		int fd(host(val));
+		if (fd < 0 || org > 2) {
+			return files_c::bad;
+		}
+		off_t ret(lseek(fd, off, org == 0 ? SEEK_SET : org == 1 ? SEEK_CUR : SEEK_END));
+		return ret < 0 || ret >= files_c::bad ? files_c::bad : static_cast<uint32_t>(ret);
+#else
+		return files_c::bad;
+#endif
+	}
+
+	uint32_t files_c::size(const fd_t val) {
+#ifdef Q_POSIX
+		int fd(host(val));
+		struct stat st;
+		if (fd < 0 || fstat(fd, &st) != 0 || st.st_size >= files_c::bad) {
+			return files_c::bad;
+		}
+		return static_cast<uint32_t>(st.st_size);
+#else
+		return files_c::bad;
+#endif
+	}
+
+	uint32_t files_c::map(const fd_t val, memory_c& mem, const idx_t dst, const idx_t len, const idx_t off) {
+#ifdef Q_POSIX
+		int fd(host(val));
+		struct stat st;
+		if (fd < 0 || fstat(fd, &st) != 0 || static_cast<uint64_t>(off) >= static_cast<uint64_t>(st.st_size)) {
+			return files_c::bad;
+		}
+
+		// only the whole pages inside the block are mapped: the rest of a page can hold data of
+		// the program or of another process; the tail is copied (and pages past the end of the
+		// file can not be touched, SIGBUS)
+		const idx_t cnt(static_cast<idx_t>(std::min<uint64_t>(len, static_cast<uint64_t>(st.st_size) - off)));
+		const idx_t pg(memory_c::page());
+		const idx_t blk(cnt / pg * pg);
+		if (dst % pg != 0 || !mem.valid(dst, cnt) || (blk && !mem.map(fd, dst, blk, off))) {
+			return files_c::bad;
+		}
+		if (blk) {
+			m_maps.push_back(map_t{ dst, blk });
+		}
+		for (idx_t at(blk); at < cnt;) {
+			ssize_t ret(pread(fd, &mem.at(dst + at), cnt - at, static_cast<off_t>(off) + at));
+			if (ret < 0 && errno == EINTR) {
+				continue;
+			}
+			if (ret <= 0) {
+				return at; // the file shrank
+			}
+			at += static_cast<idx_t>(ret);
+		}
+		return cnt;
+#else
+		return files_c::bad;
+#endif
+	}
+
+	void files_c::release(memory_c& mem) {
+		for (const auto& i : m_maps) {
+			mem.unmap(i.addr, i.len);
+		}
+		m_maps.clear();
+		for (fd_t idx(0); idx < m_fds.size(); ++idx) {
+			close(idx);
+		}
+		m_fds.clear();
+	}
+
+	uint32_t files_c::remove(const sandbox_c& box, const path_t& val) {
+#ifdef Q_POSIX
+		if (!box.valid() || !sandbox_c::safe(val)) {
+			return files_c::bad;
+		}
+		path_t name;
+		int dir(box.walk(val, name));
+		if (dir < 0) {
+			return files_c::bad;
+		}
+		int ret(unlinkat(dir, name.c_str(), 0));
+		::close(dir);
+		return ret == 0 ? 0 : files_c::bad;
+#else
+		return files_c::bad;
+#endif
+	}
+
+	int files_c::host(const fd_t val) const {
+		return val < m_fds.size() ? m_fds[val] : -1;
+	}
+
+	bool files_c::empty() const {
+		if (!m_maps.empty()) {
+			return false;
+		}
+		for (int i : m_fds) {
+			if (i >= 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+}
@@ -0,0 +1,148 @@
+#include "../inc/heap.hpp"
+#include "../inc/vm.hpp"
+
+#include <algorithm> // std::min, std::max
+
+namespace vm { /* heap_c */
+
+	heap_c::heap_c()
+		: m_slabs()
+		, m_segments()
+		, m_live()
+		, m_stats() {
+	}
+
+	uint32_t heap_c::alloc(segments_c& seg, const idx_t len) {
+		const class_t cls(heap_c::size_class(len));
+		if (len == 0) {
+			return heap_c::bad;
+		}
+
+		idx_t ret(heap_c::bad);
+		if (cls == heap_c::classes) { // a segment of its own
+			ret = seg.alloc(len);
+			if (ret == segments_c::none) {
+				return heap_c::bad;
+			}
+			reserve(seg.length(ret));
+		} else {
+			slabs_t& sl(m_slabs[cls]);
+			if (!sl.free.empty()) {
+				ret = sl.free.back();
+				sl.free.pop_back();
+			} else {
+				if (sl.next == sl.end) { // next slab
+					idx_t at(seg.alloc(heap_c::slab));
+					if (at == segments_c::none) {
+						return heap_c::bad;
+					}
+					m_segments.push_back(at);
+					reserve(heap_c::slab);
+					sl.next = at;
+					sl.end = at + heap_c::slab;
+				}
+				ret = sl.next;
+				sl.next += heap_c::mblock << cls;
+			}
+		}
+
+		m_live[ret] = block_t{ len, cls };
+		++m_stats.allocs;
+		m_stats.used += len;
+		m_stats.peak_used = std::max(m_stats.peak_used, m_stats.used);
+		return ret;
+	}
+
+	uint32_t heap_c::free(segments_c& seg, const idx_t val) {
+		auto itr(m_live.find(val));
+		if (itr == m_live.end()) {
+			return heap_c::bad;
+		}
+		const class_t cls(itr->second.cls);
+		if (cls == heap_c::classes) {
+			m_stats.reserved -= seg.length(val);
+			seg.free(val);
+		} else {
+			m_slabs[cls].free.push_back(val);
+		}
+		++m_stats.frees;
+		m_stats.used -= itr->second.len;
+		m_live.erase(itr);
+		return 0;
+	}
+
+	uint32_t heap_c::resize(segments_c& seg, memory_c& mem, const idx_t val, const idx_t len) {
+		auto itr(m_live.find(val));
+		if (itr == m_live.end() || len == 0) {
+			return heap_c::bad;
+		}
+		// the block keeps the class it was taken from: a segment shrunk to a slab length
+		// stays a segment, freed as one
+		const class_t cls(itr->second.cls);
+		const bool fit(cls == heap_c::classes ? len <= seg.length(val) : heap_c::size_class(len) == cls);
+		if (fit) { // in place
+			m_stats.used = m_stats.used - itr->second.len + len;
+			m_stats.peak_used = std::max(m_stats.peak_used, m_stats.used);
+			itr->second.len = len;
+			return val;
+		}
+
+		const idx_t old(itr->second.len);
+		const idx_t ret(alloc(seg, len));
+		if (ret == heap_c::bad) {
+			return heap_c::bad;
+		}
+		if (const memory_c::loc_t* src = mem.span(val, std::min(old, len))) {
+			mem.copy(ret, src, std::min(old, len));
+		}
+		free(seg, val);
+		--m_stats.allocs; // one block moved
+		--m_stats.frees;
+		return ret;
+	}
+
+	uint32_t heap_c::size(const idx_t val) const {
+		auto itr(m_live.find(val));
+		return itr == m_live.end() ? heap_c::bad : itr->second.len;
+	}
+
+	void heap_c::release(segments_c& seg) {
+		for (const auto& i : m_live) {
+			if (i.second.cls == heap_c::classes) {
+				seg.free(i.first);
+			}
+		}
+		for (const auto& i : m_segments) {
+			seg.free(i);
+		}
+		m_live.clear();
+		m_segments.clear();
+		for (auto& i : m_slabs) {
+			i.free.clear();
+			i.next = i.end = 0;
+		}
+		m_stats.used = m_stats.reserved = 0;
+	}
+
+	const heap_c::stats_t& heap_c::stats() const {
+		return m_stats;
+	}
+
+	double heap_c::fragmentation() const {
+		return m_stats.peak_reserved ? 1.0 - static_cast<double>(m_stats.peak_used) / m_stats.peak_reserved : 0.0;
+	}
+
+	heap_c::class_t heap_c::size_class(const idx_t val) {
+		class_t ret(0);
+		while (ret < heap_c::classes && (heap_c::mblock << ret) < val) {
+			++ret;
+		}
+		return ret;
+	}
+
+	void heap_c::reserve(const count_t val) {
+		m_stats.reserved += val;
+		m_stats.peak_reserved = std::max(m_stats.peak_reserved, m_stats.reserved);
+	}
+
+}
@@ -0,0 +1,293 @@
+#include "../inc/hex.hpp"
+
+#include <algorithm> // std::min, std::max
+#include <thread>
+#include <vector>
+
+#ifdef Q_SIMD
+#include <immintrin.h>
+#endif
+
+namespace vm { /* kernels */
+
+	namespace {
+
+		using loc_t  = hex_c::loc_t;
+		using part_t = hex_c::part_t;
+
+		// characters of a staging block (their digits are compacted before they are paired)
+		constexpr size_t dblock = 0x00001000;
+
+		// value of every character, 0xFF when it is not a hex digit
+		struct digits_t {
+			uint8_t val[256];
+
+			constexpr digits_t() : val() {
+				for (uint32_t idx(0); idx < 256; ++idx) {
+					val[idx] = 0xFF;
+				}
+				for (uint32_t idx(0); idx < 10; ++idx) {
+					val['0' + idx] = static_cast<uint8_t>(idx);
+				}
+				for (uint32_t idx(0); idx < 6; ++idx) {
+					val['A' + idx] = static_cast<uint8_t>(idx + 10);
+					val['a' + idx] = static_cast<uint8_t>(idx + 10);
+				}
+			}
+		};
+
+		constexpr digits_t digits;
+
+		struct kernels_t {
+			hex_c::isa_e isa;
+			size_t (*count)(const char*, size_t);
+			void (*part)(part_t&, loc_t*);
+		};
+
+		size_t count_scalar(const char* src, size_t len) {
+			size_t ret(0);
+			for (size_t idx(0); idx < len; ++idx) {
+				ret += digits.val[static_cast<uint8_t>(src[idx])] != 0xFF;
+			}
+			return ret;
+		}
+
+		void part_scalar(part_t& prt, loc_t* dst) {
+			loc_t* out(dst + (prt.first + 1) / 2); // first byte held entirely
+			bool skip(prt.first & 1);
+			uint8_t hi(0xFF);
+			for (size_t idx(0); idx < prt.len; ++idx) {
+				uint8_t dig(digits.val[static_cast<uint8_t>(prt.src[idx])]);
+				if (dig == 0xFF) {
+					continue;
+				}
+				if (skip) {
+					prt.head = dig;
+					skip = false;
+				} else if (hi == 0xFF) {
+					hi = dig;
+				} else {
+					*out++ = static_cast<loc_t>((hi << 4) | dig);
+					hi = 0xFF;
+				}
+			}
+			prt.tail = hi;
+		}
+
+#ifdef Q_SIMD
+
+		// shuffle gathering the digits of 8 characters, by mask of the digits
+		struct compact_t {
+			alignas(16) uint8_t idx[256][8];
+
+			constexpr compact_t() : idx() {
+				for (uint32_t msk(0); msk < 256; ++msk) {
+					uint32_t n(0);
+					for (uint32_t bit(0); bit < 8; ++bit) {
+						if (msk & (1u << bit)) {
+							idx[msk][n++] = static_cast<uint8_t>(bit);
+						}
+					}
+					for (; n < 8; ++n) {
+						idx[msk][n] = 0x80; // zeroed
+					}
+				}
+			}
+		};
+
+		constexpr compact_t compact;
+
+		/* ssse3 */
+
+		// values of 16 characters, mask of the hex digits
+		__attribute__((target("ssse3,popcnt")))
+		inline uint32_t classify(const char* src, __m128i& val) {
+			const __m128i chr(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+			const __m128i dec(_mm_sub_epi8(chr, _mm_set1_epi8('0')));
+			const __m128i alp(_mm_sub_epi8(_mm_or_si128(chr, _mm_set1_epi8(0x20)), _mm_set1_epi8('a')));
+			const __m128i isd(_mm_and_si128(_mm_cmpgt_epi8(dec, _mm_set1_epi8(-1)), _mm_cmpgt_epi8(_mm_set1_epi8(10), dec)));
+			const __m128i isa(_mm_and_si128(_mm_cmpgt_epi8(alp, _mm_set1_epi8(-1)), _mm_cmpgt_epi8(_mm_set1_epi8(6), alp)));
+			val = _mm_or_si128(_mm_and_si128(isd, dec), _mm_and_si128(isa, _mm_add_epi8(alp, _mm_set1_epi8(10))));
+			return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(isd, isa)));
+		}
+
+		__attribute__((target("ssse3,popcnt")))
+		size_t count_ssse3(const char* src, size_t len) {
+			size_t ret(0), idx(0);
+			__m128i val;
+			for (; idx + 16 <= len; idx += 16) {
+				ret += static_cast<size_t>(__builtin_popcount(classify(src + idx, val)));
+			}
+			return ret + count_scalar(src + idx, len - idx);
+		}
+
+		// pairs of digits to bytes, 32 digits at a time
+		__attribute__((target("ssse3,popcnt")))
+		void pack_ssse3(const uint8_t* nib, const size_t len, loc_t* out) {
+			const __m128i mul(_mm_set1_epi16(0x0110)); // high digit * 16 + low digit
+			size_t idx(0);
+			for (; idx + 16 <= len; idx += 16) {
+				const __m128i lo(_mm_maddubs_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(nib + idx * 2)), mul));
+				const __m128i hi(_mm_maddubs_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(nib + idx * 2 + 16)), mul));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + idx), _mm_packus_epi16(lo, hi));
+			}
+			for (; idx < len; ++idx) {
+				out[idx] = static_cast<loc_t>((nib[idx * 2] << 4) | nib[idx * 2 + 1]);
+			}
+		}
+
+		__attribute__((target("ssse3,popcnt")))
+		void part_ssse3(part_t& prt, loc_t* dst) {
+			alignas(16) uint8_t nib[dblock + 32]; // digits of a block, after the one left by the previous
+			loc_t* out(dst + (prt.first + 1) / 2);
+			bool skip(prt.first & 1);
+			size_t n(0);
+			for (size_t off(0); off < prt.len; off += dblock) {
+				const size_t end(std::min(prt.len, off + dblock));
+				size_t idx(off);
+				for (; idx + 16 <= end; idx += 16) {
+					__m128i val;
+					const uint32_t msk(classify(prt.src + idx, val));
+					if (msk == 0xFFFF) {
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(nib + n), val);
+						n += 16;
+						continue;
+					}
+					_mm_storel_epi64(reinterpret_cast<__m128i*>(nib + n), _mm_shuffle_epi8(val,
+						_mm_loadl_epi64(reinterpret_cast<const __m128i*>(compact.idx[msk & 0xFF]))));
+					n += static_cast<size_t>(__builtin_popcount(msk & 0xFF));
+					_mm_storel_epi64(reinterpret_cast<__m128i*>(nib + n), _mm_shuffle_epi8(_mm_srli_si128(val, 8),
+						_mm_loadl_epi64(reinterpret_cast<const __m128i*>(compact.idx[msk >> 8]))));
+					n += static_cast<size_t>(__builtin_popcount(msk >> 8));
+				}
+				for (; idx < end; ++idx) {
+					uint8_t dig(digits.val[static_cast<uint8_t>(prt.src[idx])]);
+					if (dig != 0xFF) {
+						nib[n++] = dig;
+					}
+				}
+
+				size_t beg(0);
+				if (skip && n) {
+					prt.head = nib[0];
+					skip = false;
+					beg = 1;
+				}
+				const size_t pairs((n - beg) / 2);
+				pack_ssse3(nib + beg, pairs, out);
+				out += pairs;
+				if ((n - beg) & 1) { // carried to the next block
+					nib[0] = nib[n - 1];
+					n = 1;
+				} else {
+					n = 0;
+				}
+			}
+			prt.tail = n ? nib[0] : 0xFF;
+		}
+
+#endif
+
+		const kernels_t& kernels() {
+			static const kernels_t ret([]() {
+#ifdef Q_SIMD
+				if (__builtin_cpu_supports("ssse3") && __builtin_cpu_supports("popcnt")) {
+					return kernels_t{ hex_c::isa_e::SSSE3, count_ssse3, part_ssse3 };
+				}
+#endif
+				return kernels_t{ hex_c::isa_e::SCALAR, count_scalar, part_scalar };
+			}());
+			return ret;
+		}
+
+		// runs a job on every part, the first one in the calling thread
+		template <typename job_t>
+		void each(std::vector<part_t>& parts, const job_t& job) {
+			std::vector<std::thread> pool;
+			pool.reserve(parts.size());
+			for (size_t idx(1); idx < parts.size(); ++idx) {
+				pool.emplace_back([&parts, &job, idx]() { job(parts[idx]); });
+			}
+			job(parts[0]);
+			for (std::thread& i : pool) {
+				i.join();
+			}
+		}
+
+	}
+
+}
+
+namespace vm { /* hex_c */
+
+	hex_c::isa_e hex_c::isa() {
+		return kernels().isa;
+	}
+
+	const char* hex_c::name(const isa_e val) {
+		switch (val) {
+		case isa_e::SSSE3:
+			return "ssse3";
+		default:
+			return "scalar";
+		}
+	}
+
+	size_t hex_c::count(const char* src, const size_t len) {
+		return kernels().count(src, len);
+	}
+
+	void hex_c::parse(const char* src, const size_t len, std::vector<loc_t>& dst, const uint32_t threads) {
+		size_t cnt(std::max<size_t>(1, len / hex_c::dpart));
+		if (cnt > 1) { // the number of cores is read from the system
+			cnt = std::min<size_t>(cnt, threads ? threads : std::max(1u, std::thread::hardware_concurrency()));
+		}
+
+		// parts end on a character which is not a digit, the bytes spanning two of them are rare
+		std::vector<part_t> parts;
+		parts.reserve(cnt);
+		size_t beg(0);
+		for (size_t idx(1); idx <= cnt && beg < len; ++idx) {
+			size_t end(idx == cnt ? len : std::max(beg, len / cnt * idx));
+			while (end < len && digits.val[static_cast<uint8_t>(src[end])] != 0xFF) {
+				++end;
+			}
+			parts.push_back(part_t{ src + beg, end - beg, 0, 0, 0xFF, 0xFF });
+			beg = end;
+		}
+		if (parts.empty()) {
+			dst.clear();
+			return;
+		}
+
+		// digits of every part, then where each one writes
+		each(parts, [](part_t& prt) { prt.digits = hex_c::count(prt.src, prt.len); });
+		size_t total(0);
+		for (part_t& i : parts) {
+			i.first = total;
+			total += i.digits;
+		}
+		dst.clear();
+		dst.resize(total / 2);
+
+		loc_t* out(dst.data());
+		each(parts, [out](part_t& prt) { hex_c::part(prt, out); });
+
+		// bytes spanning two parts: the tail of the previous digits, the head of the next
+		uint8_t hi(0xFF);
+		for (const part_t& i : parts) {
+			if (i.digits == 0) {
+				continue;
+			}
+			if (i.first & 1) {
+				out[i.first / 2] = static_cast<loc_t>((hi << 4) | i.head);
+			}
+			hi = i.tail;
+		}
+	}
+
+	void hex_c::part(part_t& val, loc_t* dst) {
+		kernels().part(val, dst);
+	}
+
+}
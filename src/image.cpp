@@ -0,0 +1,244 @@
+#include "../inc/image.hpp"
+#include "../inc/vm.hpp"
+#include "../inc/hex.hpp"
+
+#include <iostream> // std::cerr
+#include <fstream>  // std::ifstream, std::ofstream
+#include <iterator> // std::istreambuf_iterator
+
+#if defined(__unix__) || defined(__APPLE__)
+#define Q_MMAP
+#include <fcntl.h>    // open
+#include <sys/mman.h> // mmap, munmap
+#include <sys/stat.h> // fstat
+#include <unistd.h>   // close
+#endif
+
+namespace vm { /* little-endian fields */
+
+	namespace {
+
+		uint32_t rd32(const uint8_t* val) {
+			return static_cast<uint32_t>(val[0])
+				| (static_cast<uint32_t>(val[1]) << 8)
+				| (static_cast<uint32_t>(val[2]) << 16)
+				| (static_cast<uint32_t>(val[3]) << 24);
+		}
+
+		uint16_t rd16(const uint8_t* val) {
+			return static_cast<uint16_t>(val[0] | (val[1] << 8));
+		}
+
+		void wr32(uint8_t* dst, const uint32_t val) {
+			for (uint8_t idx(0); idx < 4; ++idx) {
+				dst[idx] = static_cast<uint8_t>(val >> (idx * 8));
+			}
+		}
+
+		void wr16(uint8_t* dst, const uint16_t val) {
+			dst[0] = static_cast<uint8_t>(val);
+			dst[1] = static_cast<uint8_t>(val >> 8);
+		}
+
+	}
+
+}
+
+namespace vm { /* image_c */
+
+	image_c::image_c()
+		: m_map(nullptr)
+		, m_size(0)
+		, m_buf()
+		, m_code(nullptr)
+		, m_clen(0)
+		, m_data(nullptr)
+		, m_dlen(0) {
+	}
+
+	image_c::~image_c() {
+		close();
+	}
+
+	bool image_c::load(const path_t val) {
+		close();
+		try {
+			if (!map(val)) {
+				throw exception_c("empty source [" + val + "]");
+			}
+
+			const loc_t* src(m_map ? m_map : m_buf.data());
+			if (m_size >= image_c::hlen && rd32(src) == image_c::magic) {
+				return open(src, val);
+			}
+
+			// legacy hex text
+			std::vector<loc_t> raw;
+			raw.swap(m_buf);
+			parse(reinterpret_cast<const char*>(m_map ? m_map : raw.data()), m_size);
+#ifdef Q_MMAP
+			if (m_map) {
+				munmap(m_map, m_size);
+				m_map = nullptr;
+			}
+#endif
+			return true;
+		} catch (const exception_c& exc) {
+			std::cerr << exc.get() << std::endl;
+			close();
+			return false;
+		}
+	}
+
+	bool image_c::load(const loc_t* src, const size_t len) {
+		close();
+		try {
+			if (!src || len == 0) {
+				throw exception_c("empty source [buffer]");
+			}
+			m_size = len;
+			if (len >= image_c::hlen && rd32(src) == image_c::magic) {
+				return open(src, "buffer");
+			}
+			parse(reinterpret_cast<const char*>(src), len);
+			return true;
+		} catch (const exception_c& exc) {
+			std::cerr << exc.get() << std::endl;
+			close();
+			return false;
+		}
+	}
+
+	void image_c::parse(const char* src, const size_t len) {
+		hex_c::parse(src, len, m_buf);
+
+		m_code = m_buf.data();
+		m_clen = static_cast<len_t>(m_buf.size());
+		m_data = m_code + m_clen;
+		m_dlen = 0;
+	}
+
+	bool image_c::save(const path_t val, const bool sum) const {
+		try {
+			std::ofstream out(val, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+			if (!out.is_open()) {
+				throw exception_c("can not write [" + val + "]");
+			}
+
+			uint8_t hdr[image_c::hlen]{ 0 };
+			wr32(hdr, image_c::magic);
+			wr16(hdr + 4, image_c::version);
+			wr16(hdr + 6, sum ? static_cast<uint16_t>(flag_e::CHECKSUM) : 0);
+			wr32(hdr + 8, m_clen);
+			wr32(hdr + 12, m_dlen);
+			if (sum) {
+				wr32(hdr + 16, checksum(m_data, m_dlen, checksum(m_code, m_clen)));
+			}
+
+			out.write(reinterpret_cast<const char*>(hdr), sizeof(hdr));
+			out.write(reinterpret_cast<const char*>(m_code), m_clen);
+			out.write(reinterpret_cast<const char*>(m_data), m_dlen);
+			if (!out.good()) {
+				throw exception_c("can not write [" + val + "]");
+			}
+			return true;
+		} catch (const exception_c& exc) {
+			std::cerr << exc.get() << std::endl;
+			return false;
+		}
+	}
+
+	void image_c::close() {
+#ifdef Q_MMAP
+		if (m_map) {
+			munmap(m_map, m_size);
+		}
+#endif
+		m_map = nullptr;
+		m_size = 0;
+		m_buf.clear();
+		m_buf.shrink_to_fit();
+		m_code = m_data = nullptr;
+		m_clen = m_dlen = 0;
+	}
+
+	const image_c::loc_t* image_c::code() const {
+		return m_code;
+	}
+
+	image_c::len_t image_c::code_length() const {
+		return m_clen;
+	}
+
+	const image_c::loc_t* image_c::data() const {
+		return m_data;
+	}
+
+	image_c::len_t image_c::data_length() const {
+		return m_dlen;
+	}
+
+	image_c::sum_t image_c::checksum(const loc_t* val, const size_t len, sum_t ret) {
+		for (size_t idx(0); idx < len; ++idx) {
+			ret = (ret ^ val[idx]) * 0x01000193;
+		}
+		return ret;
+	}
+
+	bool image_c::convert(const path_t src, const path_t dst) {
+		image_c img;
+		return img.load(src) && img.save(dst, true);
+	}
+
+	bool image_c::open(const loc_t* src, const path_t val) {
+		header_t hdr{ rd32(src), rd16(src + 4), rd16(src + 6), rd32(src + 8), rd32(src + 12), rd32(src + 16), { 0 } };
+		if (hdr.version == 0 || hdr.version > image_c::version) {
+			throw exception_c("unsupported image version " + std::to_string(hdr.version) + " [" + val + "]");
+		}
+		if (static_cast<size_t>(hdr.code) + hdr.data > m_size - image_c::hlen) {
+			throw exception_c("truncated image [" + val + "]");
+		}
+
+		m_code = src + image_c::hlen;
+		m_clen = hdr.code;
+		m_data = m_code + m_clen;
+		m_dlen = hdr.data;
+
+		if ((hdr.flags & static_cast<uint16_t>(flag_e::CHECKSUM)) != 0
+			&& checksum(m_data, m_dlen, checksum(m_code, m_clen)) != hdr.sum) {
+			throw exception_c("bad checksum [" + val + "]");
+		}
+		return true;
+	}
+
+	bool image_c::map(const path_t val) {
+#ifdef Q_MMAP
+		int fd(::open(val.c_str(), O_RDONLY));
+		if (fd < 0) {
+			return false;
+		}
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+			::close(fd);
+			return false;
+		}
+		void* ret(mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0));
+		::close(fd);
+		if (ret == MAP_FAILED) {
+			return false;
+		}
+		m_map = static_cast<loc_t*>(ret);
+		m_size = static_cast<size_t>(st.st_size);
+		return true;
+#else
+		std::ifstream in(val, std::ios_base::in | std::ios_base::binary);
+		if (!in.is_open()) {
+			return false;
+		}
+		m_buf.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		m_size = m_buf.size();
+		return m_size != 0;
+#endif
+	}
+
+}
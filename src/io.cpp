@@ -0,0 +1,143 @@
+#include "../inc/io.hpp"
+#include "../inc/files.hpp"
+
+#include <cstring> // std::memcpy
+#include <cerrno>  // errno
+
+#if defined(__unix__) || defined(__APPLE__)
+#define Q_POSIX
+#include <unistd.h> // read, write
+#endif
+
+namespace vm { /* io_c */
+
+	io_c::io_c()
+		: m_thread()
+		, m_lock()
+		, m_wake()
+		, m_done()
+		, m_queue()
+		, m_results()
+		, m_pending(0)
+		, m_stop(false) {
+	}
+
+	io_c::~io_c() {
+		{
+			std::lock_guard<std::mutex> grd(m_lock);
+			m_stop = true;
+		}
+		m_wake.notify_one();
+		if (m_thread.joinable()) {
+			m_thread.join();
+		}
+	}
+
+	void io_c::submit(request_t&& val) {
+		{
+			std::lock_guard<std::mutex> grd(m_lock);
+			m_queue.push_back(std::move(val));
+		}
+		++m_pending;
+		if (!m_thread.joinable()) {
+			m_thread = std::thread(&io_c::work, this);
+		}
+		m_wake.notify_one();
+	}
+
+	size_t io_c::collect(requests_t& val, const bool wait) {
+		if (m_pending == 0) {
+			return 0;
+		}
+		std::unique_lock<std::mutex> grd(m_lock);
+		if (wait) {
+			m_done.wait(grd, [this] { return !m_results.empty(); });
+		}
+		size_t ret(m_results.size());
+		for (auto& i : m_results) {
+			val.push_back(std::move(i));
+		}
+		m_results.clear();
+		m_pending -= ret;
+		return ret;
+	}
+
+	size_t io_c::pending() const {
+		return m_pending;
+	}
+
+	void io_c::work() {
+		std::unique_lock<std::mutex> grd(m_lock);
+		while (true) {
+			m_wake.wait(grd, [this] { return m_stop || !m_queue.empty(); });
+			if (m_queue.empty()) { // stopped
+				return;
+			}
+			request_t req(std::move(m_queue.front()));
+			m_queue.pop_front();
+
+			grd.unlock();
+			complete(req);
+			grd.lock();
+
+			m_results.push_back(std::move(req));
+			m_done.notify_one();
+		}
+	}
+
+	void io_c::complete(request_t& val) {
+		switch (val.kind) {
+		case kind_e::CHAR:
+			std::getline(*val.in, val.buf);
+			val.val = val.buf.empty() ? 0 : static_cast<uint32_t>(val.buf.front());
+			break;
+
+		case kind_e::UINT:
+			*val.in >> val.val;
+			break;
+
+		case kind_e::INT:
+			{
+				int32_t tmp(0);
+				*val.in >> tmp;
+				val.val = static_cast<uint32_t>(tmp);
+			}
+			break;
+
+		case kind_e::FLOAT:
+			{
+				float tmp(0);
+				*val.in >> tmp;
+				std::memcpy(&val.val, &tmp, sizeof(tmp));
+			}
+			break;
+
+		case kind_e::LINE:
+			std::getline(*val.in, val.buf);
+			val.val = static_cast<uint32_t>(val.buf.size());
+			break;
+
+		case kind_e::READ:
+		case kind_e::WRITE:
+#ifdef Q_POSIX
+			{
+				ssize_t ret;
+				do {
+					ret = val.kind == kind_e::READ
+						? ::read(val.fd, &val.buf[0], val.buf.size())
+						: ::write(val.fd, val.buf.data(), val.buf.size());
+				} while (ret < 0 && errno == EINTR);
+				val.val = ret < 0 ? files_c::bad : static_cast<uint32_t>(ret);
+				val.buf.resize(ret < 0 || val.kind == kind_e::WRITE ? 0 : static_cast<size_t>(ret));
+			}
+#else
+			val.val = files_c::bad;
+#endif
+			break;
+
+		default:
+			break;
+		}
+	}
+
+}
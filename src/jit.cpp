@@ -0,0 +1,563 @@
+#include "../inc/jit.hpp"
+#include "../inc/vm.hpp"
+
+#include <algorithm> // std::sort
+#include <cstring>   // std::memcpy
+#include <map>
+
+#ifdef Q_JIT
+#include <sys/mman.h> // mmap, mprotect, munmap
+#endif
+
+namespace vm { /* x86-64 emitter */
+
+	namespace {
+
+		// host registers
+		enum hreg_e : uint8_t {
+			RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7,
+			R8, R9, R10, R11, R12, R13, R14, R15
+		};
+
+		// registers the guest registers are pinned to
+		// (rdi holds core_c, rsi the fuel, rax, rcx and rdx are scratch)
+		constexpr uint8_t pool[] = { RBX, RBP, R12, R13, R14, R15, R8, R9, R10, R11 };
+		constexpr uint8_t pools = sizeof(pool) / sizeof(*pool);
+
+		// guest register: 0x00-0x0F are x1..x16, FX the flags
+		constexpr uint8_t FX = core_c::xregs;
+
+		// location of a guest register: a host register or [rdi + disp8]
+		struct loc_t {
+			bool mem;
+			uint8_t val;
+		};
+
+		class emitter_c {
+		public:
+
+			std::vector<uint8_t> out;
+
+		public:
+
+			void u8(const uint8_t val) {
+				out.push_back(val);
+			}
+
+			void u32(const uint32_t val) {
+				for (uint8_t idx(0); idx < 4; ++idx) {
+					out.push_back(static_cast<uint8_t>(val >> (idx * 8)));
+				}
+			}
+
+			size_t pos() const {
+				return out.size();
+			}
+
+			void fix(const size_t at, const size_t to) { // rel32 at [at, at + 4)
+				uint32_t rel(static_cast<uint32_t>(static_cast<int64_t>(to) - static_cast<int64_t>(at + 4)));
+				for (uint8_t idx(0); idx < 4; ++idx) {
+					out[at + idx] = static_cast<uint8_t>(rel >> (idx * 8));
+				}
+			}
+
+			// opcode with a modrm: reg is a host register or an opcode extension
+			void rm(std::initializer_list<uint8_t> opc, const uint8_t reg, const loc_t loc) {
+				uint8_t rex(0x40 | ((reg & 8) ? 0x04 : 0) | ((!loc.mem && (loc.val & 8)) ? 0x01 : 0));
+				if (rex != 0x40) {
+					u8(rex);
+				}
+				for (auto i : opc) {
+					u8(i);
+				}
+				if (loc.mem) {
+					u8(0x40 | ((reg & 7) << 3) | RDI); // [rdi + disp8]
+					u8(loc.val);
+				} else {
+					u8(0xC0 | ((reg & 7) << 3) | (loc.val & 7));
+				}
+			}
+
+			void mov_ri(const uint8_t reg, const uint32_t val) { // mov r32, imm32
+				if (reg & 8) {
+					u8(0x41);
+				}
+				u8(0xB8 | (reg & 7));
+				u32(val);
+			}
+
+			void mov_li(const loc_t loc, const uint32_t val) {
+				if (loc.mem) {
+					rm({ 0xC7 }, 0, loc);
+					u32(val);
+				} else {
+					mov_ri(loc.val, val);
+				}
+			}
+
+			void load(const uint8_t reg, const loc_t loc) { // mov r32, r/m32
+				if (!loc.mem && loc.val == reg) {
+					return;
+				}
+				rm({ 0x8B }, reg, loc);
+			}
+
+			void store(const loc_t loc, const uint8_t reg) { // mov r/m32, r32
+				if (!loc.mem && loc.val == reg) {
+					return;
+				}
+				rm({ 0x89 }, reg, loc);
+			}
+
+			size_t jcc(const uint8_t cc) { // jcc rel32, returns the position of rel32
+				u8(0x0F);
+				u8(0x80 | cc);
+				u32(0);
+				return pos() - 4;
+			}
+
+			size_t jmp() {
+				u8(0xE9);
+				u32(0);
+				return pos() - 4;
+			}
+
+			void burn(const uint32_t val) { // sub qword [rsi], imm32
+				u8(0x48);
+				u8(0x81);
+				u8(0x2E);
+				u32(val);
+			}
+
+		};
+
+		constexpr uint8_t CC_B = 0x2, CC_E = 0x4, CC_NE = 0x5, CC_G = 0xF;
+
+		constexpr loc_t host(const uint8_t val) {
+			return loc_t{ false, val };
+		}
+
+	}
+
+}
+
+namespace vm { /* jit_c */
+
+	jit_c::jit_c(uint32_t val)
+		: m_buf(nullptr)
+		, m_len(jit_c::dlen)
+		, m_pos(0)
+		, m_hot(val ? val : jit_c::dhot)
+		, m_on(true)
+		, m_count(0) {
+#ifdef Q_JIT
+		void* buf(mmap(nullptr, m_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+		if (buf != MAP_FAILED) {
+			m_buf = static_cast<uint8_t*>(buf);
+		}
+#endif
+	}
+
+	jit_c::~jit_c() {
+#ifdef Q_JIT
+		if (m_buf) {
+			munmap(m_buf, m_len);
+		}
+#endif
+	}
+
+	bool jit_c::supported() {
+#ifdef Q_JIT
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	void jit_c::enable(const bool val) {
+		m_on = val;
+	}
+
+	bool jit_c::enabled() const {
+		return m_on && m_buf;
+	}
+
+	uint32_t jit_c::threshold() const {
+		return enabled() ? m_hot : 0;
+	}
+
+	size_t jit_c::blocks() const {
+		return m_count;
+	}
+
+	void jit_c::reset() {
+		m_count = 0;
+		m_pos = 0;
+	}
+
+	jit_c::block_t jit_c::compile(memory_c& mem, const reg32_t csx, const reg32_t clx, const idx_t beg) {
+#ifndef Q_JIT
+		return nullptr;
+#else
+		if (!enabled() || beg >= clx / 4) {
+			return nullptr;
+		}
+
+		struct ins_t {
+			uint8_t a, b, c, d;
+			idx_t tgt; // taken jump
+		};
+
+		const idx_t len(clx / 4);
+
+		// target of a static jump, false when the engine has to take it
+		auto target = [&](const ins_t& i, idx_t& val) {
+			reg32_t next(csx + ((static_cast<reg32_t>(i.b) << 8) | i.c) + 4);
+			if (next < csx || (next - csx) % 4 != 0) {
+				return false;
+			}
+			val = (next - csx) >= clx ? len : (next - csx) / 4;
+			return true;
+		};
+
+		// block: the longest run of supported instructions
+		std::vector<ins_t> ins;
+		uint32_t uses[0x100]{ 0 }; // any operand byte, only x1..x16 and FX are counted
+		for (idx_t idx(beg); idx < len && ins.size() < jit_c::mlen; ++idx) {
+			reg32_t addr(csx + idx * 4);
+			ins_t i{ mem.get(addr), mem.get(addr + 1), mem.get(addr + 2), mem.get(addr + 3), 0 };
+			bool ok(false);
+
+			switch (i.a) {
+			case 0x00: // nop
+				ok = true;
+				break;
+
+			case 0x01: // ldx x,v
+			case 0x10: case 0x14: case 0x18: case 0x1A: case 0x1C: case 0x1E: case 0x20: // op x,v
+			case 0x22: // not x
+				ok = i.b < core_c::xregs;
+				uses[i.b] += ok;
+				break;
+
+			case 0x16: // div x,v
+				ok = i.b < core_c::xregs && (i.c | i.d) != 0;
+				uses[i.b] += ok;
+				break;
+
+			case 0x23: // cmp x,v
+				ok = i.b < core_c::xregs;
+				uses[i.b] += ok;
+				uses[FX] += ok;
+				break;
+
+			case 0x12: // sub x,v (compares with the register at c)
+			case 0x13: case 0x24: // sub x,x, cmp x,x
+				ok = i.b < core_c::xregs && i.c < core_c::xregs;
+				uses[i.b] += ok;
+				uses[i.c] += ok;
+				uses[FX] += ok;
+				break;
+
+			case 0x17: // div x,x (the first instruction can not exit to itself)
+				ok = i.b < core_c::xregs && i.c < core_c::xregs && idx != beg;
+				uses[i.b] += ok;
+				uses[i.c] += ok;
+				break;
+
+			case 0x02: // ldx x,x
+			case 0x11: case 0x15: case 0x19: case 0x1B: case 0x1D: case 0x1F: case 0x21: // op x,x
+				ok = i.b < core_c::xregs && i.c < core_c::xregs;
+				uses[i.b] += ok;
+				uses[i.c] += ok;
+				break;
+
+			case 0x08: case 0x0C: // jit v,v, jif v,v
+				ok = target(i, i.tgt);
+				uses[FX] += ok;
+				break;
+
+			case 0x09: case 0x0D: // jit v,x, jif v,x
+				ok = i.d < core_c::xregs && target(i, i.tgt);
+				uses[i.d] += ok;
+				uses[FX] += ok;
+				break;
+
+			default: // memory, syscalls, register jumps...
+				break;
+			}
+
+			if (!ok) {
+				break;
+			}
+			ins.push_back(i);
+		}
+		if (ins.empty()) {
+			return nullptr;
+		}
+
+		// pin the most used guest registers
+		loc_t loc[core_c::xregs + 1];
+		uint8_t order[core_c::xregs + 1];
+		for (uint8_t idx(0); idx <= core_c::xregs; ++idx) {
+			order[idx] = idx;
+			uint8_t off(static_cast<uint8_t>(idx == FX ? (core_c::nregs - 1) * 4 : idx * 4));
+			loc[idx] = loc_t{ true, off };
+		}
+		std::stable_sort(order, order + core_c::xregs + 1, [&](uint8_t l, uint8_t r) {
+			return uses[l] > uses[r];
+		});
+		std::vector<std::pair<uint8_t, uint8_t>> pinned; // guest, host
+		for (uint8_t idx(0); idx < pools && uses[order[idx]]; ++idx) {
+			pinned.emplace_back(order[idx], pool[idx]);
+		}
+
+		emitter_c e;
+
+		// prologue
+		e.u8(0x53); // push rbx
+		e.u8(0x55); // push rbp
+		e.u8(0x41); e.u8(0x54); // push r12
+		e.u8(0x41); e.u8(0x55); // push r13
+		e.u8(0x41); e.u8(0x56); // push r14
+		e.u8(0x41); e.u8(0x57); // push r15
+		for (auto& i : pinned) {
+			e.load(i.second, loc[i.first]);
+			loc[i.first] = host(i.second);
+		}
+		const size_t head(e.pos());
+
+		// exits: rel32 to patch, next instruction, instructions retired from the block start
+		struct exit_t {
+			size_t at;
+			idx_t tgt;
+			uint32_t cnt;
+		};
+		std::vector<exit_t> exits, loops;
+
+		// fx = compare(l, r)
+		auto flags = [&](const uint8_t l, const loc_t* r, const uint32_t imm) {
+			e.load(RAX, loc[l]);
+			if (r) {
+				e.rm({ 0x3B }, RAX, *r); // cmp eax, r/m32
+			} else {
+				e.u8(0x3D); // cmp eax, imm32
+				e.u32(imm);
+			}
+			e.mov_ri(RAX, 0x0004);
+			e.mov_ri(RCX, 0x0002);
+			e.rm({ 0x0F, 0x44 }, RAX, host(RCX)); // cmove eax, ecx
+			e.mov_ri(RCX, 0x0001);
+			e.rm({ 0x0F, 0x42 }, RAX, host(RCX)); // cmovb eax, ecx
+			e.store(loc[FX], RAX);
+		};
+
+		// dst op= src (opc is the r32, r/m32 form)
+		auto alu = [&](const uint8_t opc, const uint8_t dst, const uint8_t src) {
+			if (!loc[dst].mem) {
+				e.rm({ opc }, loc[dst].val, loc[src]);
+			} else {
+				e.load(RAX, loc[dst]);
+				e.rm({ opc }, RAX, loc[src]);
+				e.store(loc[dst], RAX);
+			}
+		};
+
+		// dst op= imm (ext is the 81 /ext form)
+		auto alu_i = [&](const uint8_t ext, const uint8_t dst, const uint32_t imm) {
+			e.rm({ 0x81 }, ext, loc[dst]);
+			e.u32(imm);
+		};
+
+		// taken jump, a jump to the block start loops without leaving native code
+		auto branch = [&](const uint8_t cc, const idx_t tgt, const uint32_t cnt) {
+			(tgt == beg ? loops : exits).push_back(exit_t{ e.jcc(cc), tgt, cnt });
+		};
+
+		for (idx_t idx(0); idx < ins.size(); ++idx) {
+			const ins_t& i(ins[idx]);
+			const uint32_t imm((static_cast<uint32_t>(i.c) << 8) | i.d);
+
+			switch (i.a) {
+			case 0x00: // nop
+				break;
+
+			case 0x01: // ldx x,v
+				e.mov_li(loc[i.b], imm);
+				break;
+
+			case 0x02: // ldx x,x
+				e.load(RAX, loc[i.c]);
+				e.store(loc[i.b], RAX);
+				break;
+
+			case 0x08: case 0x09: case 0x0C: case 0x0D: // jit, jif
+				e.load(RAX, loc[FX]);
+				if (i.a & 0x01) { // v,x
+					e.rm({ 0x3B }, RAX, loc[i.d]);
+				} else {
+					e.u8(0x3D);
+					e.u32(i.d);
+				}
+				branch(i.a < 0x0C ? CC_E : CC_NE, i.tgt, idx + 1);
+				break;
+
+			case 0x10: // add x,v
+				alu_i(0, i.b, imm);
+				break;
+
+			case 0x11: // add x,x
+				alu(0x03, i.b, i.c);
+				break;
+
+			case 0x12: // sub x,v
+				flags(i.b, &loc[i.c], 0);
+				alu_i(5, i.b, imm);
+				break;
+
+			case 0x13: // sub x,x
+				flags(i.b, &loc[i.c], 0);
+				alu(0x2B, i.b, i.c);
+				break;
+
+			case 0x14: // mul x,v
+				if (!loc[i.b].mem) {
+					e.rm({ 0x69 }, loc[i.b].val, loc[i.b]);
+					e.u32(imm);
+				} else {
+					e.rm({ 0x69 }, RAX, loc[i.b]);
+					e.u32(imm);
+					e.store(loc[i.b], RAX);
+				}
+				break;
+
+			case 0x15: // mul x,x
+				if (!loc[i.b].mem) {
+					e.rm({ 0x0F, 0xAF }, loc[i.b].val, loc[i.c]);
+				} else {
+					e.load(RAX, loc[i.b]);
+					e.rm({ 0x0F, 0xAF }, RAX, loc[i.c]);
+					e.store(loc[i.b], RAX);
+				}
+				break;
+
+			case 0x16: // div x,v
+			case 0x17: // div x,x
+				if (i.a == 0x16) {
+					e.mov_ri(RCX, imm);
+				} else {
+					e.load(RCX, loc[i.c]);
+					e.u8(0x85); e.u8(0xC9); // test ecx, ecx
+					exits.push_back(exit_t{ e.jcc(CC_E), beg + idx, idx }); // reported by the engine
+				}
+				e.load(RAX, loc[i.b]);
+				e.u8(0x31); e.u8(0xD2); // xor edx, edx
+				e.rm({ 0xF7 }, 6, host(RCX)); // div ecx
+				e.store(loc[i.b], RAX);
+				break;
+
+			case 0x18: // and x,v
+				alu_i(4, i.b, imm);
+				break;
+
+			case 0x19: // and x,x
+				alu(0x23, i.b, i.c);
+				break;
+
+			case 0x1A: // or x,v
+				alu_i(1, i.b, imm);
+				break;
+
+			case 0x1B: // or x,x
+				alu(0x0B, i.b, i.c);
+				break;
+
+			case 0x1C: // xor x,v
+				alu_i(6, i.b, imm);
+				break;
+
+			case 0x1D: // xor x,x
+				alu(0x33, i.b, i.c);
+				break;
+
+			case 0x1E: case 0x20: // shl x,v, shr x,v (the count is masked as the host does)
+				e.rm({ 0xC1 }, i.a == 0x1E ? 4 : 5, loc[i.b]);
+				e.u8(static_cast<uint8_t>(imm));
+				break;
+
+			case 0x1F: case 0x21: // shl x,x, shr x,x
+				e.load(RCX, loc[i.c]);
+				e.rm({ 0xD3 }, i.a == 0x1F ? 4 : 5, loc[i.b]);
+				break;
+
+			case 0x22: // not x
+				e.rm({ 0xF7 }, 2, loc[i.b]);
+				break;
+
+			case 0x23: // cmp x,v
+				flags(i.b, nullptr, imm);
+				break;
+
+			case 0x24: // cmp x,x
+				flags(i.b, &loc[i.c], 0);
+				break;
+
+			default:
+				break;
+			}
+		}
+
+		// fall through to the instruction after the block
+		exits.push_back(exit_t{ e.jmp(), beg + static_cast<idx_t>(ins.size()), static_cast<uint32_t>(ins.size()) });
+
+		// back edges: retire the iteration, loop while the slice has fuel, else leave at the block start
+		for (auto& i : loops) {
+			e.fix(i.at, e.pos());
+			e.burn(i.cnt);
+			e.fix(e.jcc(CC_G), head);
+			exits.push_back(exit_t{ e.jmp(), beg, 0 });
+		}
+
+		// one exit per distinct (instruction, count): retire, write back, return the index
+		std::map<std::pair<idx_t, uint32_t>, size_t> stubs;
+		for (auto& i : exits) {
+			auto it(stubs.find({ i.tgt, i.cnt }));
+			if (it == stubs.end()) {
+				it = stubs.emplace(std::make_pair(i.tgt, i.cnt), e.pos()).first;
+				if (i.cnt) {
+					e.burn(i.cnt);
+				}
+				for (auto& p : pinned) {
+					uint8_t off(static_cast<uint8_t>(p.first == FX ? (core_c::nregs - 1) * 4 : p.first * 4));
+					e.store(loc_t{ true, off }, p.second);
+				}
+				e.mov_ri(RAX, i.tgt);
+				e.u8(0x41); e.u8(0x5F); // pop r15
+				e.u8(0x41); e.u8(0x5E); // pop r14
+				e.u8(0x41); e.u8(0x5D); // pop r13
+				e.u8(0x41); e.u8(0x5C); // pop r12
+				e.u8(0x5D); // pop rbp
+				e.u8(0x5B); // pop rbx
+				e.u8(0xC3); // ret
+			}
+			e.fix(i.at, it->second);
+		}
+
+		// copy to the executable buffer (aligned on 16 bytes)
+		size_t at((m_pos + 15) & ~size_t(15));
+		if (at + e.out.size() > m_len) {
+			return nullptr;
+		}
+		if (mprotect(m_buf, m_len, PROT_READ | PROT_WRITE) != 0) {
+			return nullptr;
+		}
+		std::memcpy(m_buf + at, e.out.data(), e.out.size());
+		mprotect(m_buf, m_len, PROT_READ | PROT_EXEC);
+		m_pos = at + e.out.size();
+
+		++m_count;
+		return reinterpret_cast<block_t>(m_buf + at);
+#endif
+	}
+
+}
@@ -1,6 +1,12 @@
-#include "../inc/vm.hpp"
-
-int main(int argc, char** argv) {
-	vm::vm_c qvm;
-	return qvm.start();
-}
+#include "../inc/vm.hpp"
+#include "../inc/cli.hpp"
+
+int main(int argc, char** argv) {
+	vm::cli_c cli(argc, argv);
+	if (cli.headless()) { // run, batch, scale, convert
+		return cli.run();
+	}
+
+	vm::vm_c qvm;
+	return qvm.start();
+}
@@ -0,0 +1,153 @@
+#include "../inc/profile.hpp"
+#include "../inc/vm.hpp"
+
+#include <sstream>   // std::ostringstream
+#include <fstream>   // std::ofstream
+#include <algorithm> // std::sort
+
+namespace vm { /* profile_c */
+
+	profile_c::profile_c(const idx_t len)
+		: m_enter(len / 4 + 1, 0)
+		, m_leave(len / 4 + 1, 0)
+		, m_taken(len / 4 + 1, 0)
+		, m_sys() {
+	}
+
+	void profile_c::syscall(const uint32_t exc, const uint32_t sx) {
+		++m_sys[(static_cast<uint64_t>(exc) << 32) | sx];
+	}
+
+	bool profile_c::write(const path_t& dst, const process_c& prc, memory_c& mem) const {
+		std::ofstream out(dst, std::ios_base::out | std::ios_base::app | std::ios_base::binary);
+		if (!out) {
+			return false;
+		}
+		std::string str(json(prc, mem));
+		out.write(str.data(), static_cast<std::streamsize>(str.size()));
+		return static_cast<bool>(out.flush());
+	}
+
+	std::vector<profile_c::count_t> profile_c::counts() const {
+		std::vector<count_t> ret(m_enter.size() - 1, 0);
+		count_t run(0); // executions falling through to the next instruction
+		for (size_t idx(0); idx < ret.size(); ++idx) {
+			run += m_enter[idx];
+			ret[idx] = run;
+			run -= std::min(run, m_leave[idx] + m_taken[idx]);
+		}
+		return ret;
+	}
+
+	const char* profile_c::name(const uint8_t val) {
+		static const char* const tbl[] = {
+			"nop", "ldx x,v", "ldx x,x", "set v", "set x", "get x", "exc v", "exc x",
+			"jit v,v", "jit v,x", "jit x,v", "jit x,x", "jif v,v", "jif v,x", "jif x,v", "jif x,x",
+			"add x,v", "add x,x", "sub x,v", "sub x,x", "mul x,v", "mul x,x", "div x,v", "div x,x",
+			"and x,v", "and x,x", "or x,v", "or x,x", "xor x,v", "xor x,x", "shl x,v", "shl x,x",
+			"shr x,v", "shr x,x", "not x", "cmp x,v", "cmp x,x",
+			"ldw x", "stw x", "ldd x", "std x", "mcp x,x", "mst x,x", "mcm x,x",
+		};
+		return val < sizeof(tbl) / sizeof(*tbl) ? tbl[val] : "invalid";
+	}
+
+	std::string profile_c::json(const process_c& prc, memory_c& mem) const {
+		struct block_t {
+			idx_t beg, len;
+			count_t entries, retired;
+		};
+
+		const std::vector<count_t> num(counts());
+		const idx_t cnt(static_cast<idx_t>(num.size()));
+		const idx_t base(prc.base);
+		auto opcode = [&](const idx_t idx) -> uint8_t {
+			return mem.valid(base + idx * 4) ? mem.get(base + idx * 4) : 0xFF;
+		};
+		auto branch = [](const uint8_t op) -> bool {
+			return op >= 0x06 && op <= 0x0F; // exc, jit, jif
+		};
+
+		count_t total(0);
+		count_t ops[0x100] = { 0 };
+		std::vector<block_t> blocks;
+		for (idx_t idx(0); idx < cnt; ++idx) {
+			if (!num[idx]) {
+				continue;
+			}
+			const uint8_t op(opcode(idx));
+			ops[op] += num[idx];
+			total += num[idx];
+
+			// a block starts where the count changes or after a transfer of control
+			bool lead(blocks.empty() || idx == 0 || num[idx] != num[idx - 1]
+				|| m_taken[idx - 1] != 0 || branch(opcode(idx - 1))
+				|| blocks.back().beg + blocks.back().len != idx);
+			if (lead) {
+				blocks.push_back(block_t{ idx, 0, num[idx], 0 });
+			}
+			++blocks.back().len;
+			blocks.back().retired += num[idx];
+		}
+		std::sort(blocks.begin(), blocks.end(), [](const block_t& l, const block_t& r) {
+			return l.retired != r.retired ? l.retired > r.retired : l.beg < r.beg;
+		});
+
+		std::ostringstream out;
+		out << "{\"id\":" << prc.id << ",\"retired\":" << total << ",\"base\":" << base;
+
+		out << ",\"blocks\":[";
+		for (size_t idx(0); idx < blocks.size() && idx < profile_c::mblocks; ++idx) {
+			const block_t& blk(blocks[idx]);
+			out << (idx ? "," : "") << "{\"addr\":" << base + blk.beg * 4
+				<< ",\"length\":" << blk.len
+				<< ",\"entries\":" << blk.entries
+				<< ",\"retired\":" << blk.retired
+				<< ",\"share\":" << (total ? static_cast<double>(blk.retired) / total : 0.0) << "}";
+		}
+
+		out << "],\"opcodes\":[";
+		bool sep(false);
+		for (uint32_t op(0); op < 0x100; ++op) {
+			if (ops[op]) {
+				out << (sep ? "," : "") << "{\"op\":" << op
+					<< ",\"name\":\"" << profile_c::name(static_cast<uint8_t>(op))
+					<< "\",\"count\":" << ops[op] << "}";
+				sep = true;
+			}
+		}
+
+		out << "],\"branches\":[";
+		sep = false;
+		for (idx_t idx(0); idx < cnt; ++idx) {
+			const uint8_t op(opcode(idx));
+			if (num[idx] && op >= 0x08 && op <= 0x0F) { // jit, jif
+				out << (sep ? "," : "") << "{\"addr\":" << base + idx * 4
+					<< ",\"op\":" << static_cast<uint32_t>(op)
+					<< ",\"taken\":" << m_taken[idx]
+					<< ",\"not_taken\":" << num[idx] - m_taken[idx] << "}";
+				sep = true;
+			}
+		}
+
+		out << "],\"syscalls\":[";
+		sep = false;
+		for (const auto& i : m_sys) {
+			out << (sep ? "," : "") << "{\"exc\":" << (i.first >> 32)
+				<< ",\"sx\":" << (i.first & 0xFFFFFFFF)
+				<< ",\"count\":" << i.second << "}";
+			sep = true;
+		}
+
+		out << "],\"addresses\":[";
+		sep = false;
+		for (idx_t idx(0); idx < cnt; ++idx) {
+			if (num[idx]) {
+				out << (sep ? "," : "") << "[" << base + idx * 4 << "," << num[idx] << "]";
+				sep = true;
+			}
+		}
+		out << "]}\n";
+		return out.str();
+	}
+
+}
@@ -0,0 +1,113 @@
+#include "../inc/runtime.hpp"
+
+#include <thread>    // std::thread
+#include <algorithm> // std::min
+
+namespace vm { /* runtime_c */
+
+	runtime_c::runtime_c(count_t val, idx_t len)
+		: m_workers()
+		, m_next(0)
+		, m_ids(0) {
+		count_t cnt(std::min(val ? val : runtime_c::cores(), runtime_c::mworkers));
+		for (count_t idx(0); idx < cnt; ++idx) {
+			worker_t* wrk(new worker_t());
+			wrk->vm.reset(new vm_c(len));
+			wrk->processes = wrk->retired = wrk->steals = 0;
+			wrk->vm->report([wrk](const process_c& prc) {
+				++wrk->processes;
+				wrk->retired += prc.retired;
+			});
+			m_workers.emplace_back(wrk);
+		}
+	}
+
+	runtime_c::~runtime_c() {
+		for (auto& i : m_workers) { // never run
+			for (auto prc : i->jobs) {
+				delete prc;
+			}
+		}
+	}
+
+	runtime_c::count_t runtime_c::workers() const {
+		return static_cast<count_t>(m_workers.size());
+	}
+
+	void runtime_c::push(process_c* val) {
+		worker_t& wrk(*m_workers[m_next]);
+		m_next = (m_next + 1) % m_workers.size();
+
+		val->id = ++m_ids;
+		std::lock_guard<std::mutex> grd(wrk.lock);
+		wrk.jobs.push_back(val);
+	}
+
+	runtime_c::stats_t runtime_c::run() {
+		auto beg(std::chrono::steady_clock::now());
+
+		std::vector<std::thread> thr;
+		thr.reserve(m_workers.size());
+		for (size_t idx(0); idx < m_workers.size(); ++idx) {
+			thr.emplace_back(&runtime_c::work, this, idx);
+		}
+		for (auto& i : thr) {
+			i.join();
+		}
+
+		stats_t ret{ 0, 0, 0, std::chrono::steady_clock::now() - beg };
+		for (auto& i : m_workers) {
+			ret.processes += i->processes;
+			ret.retired += i->retired;
+			ret.steals += i->steals;
+			i->processes = i->retired = i->steals = 0;
+		}
+		return ret;
+	}
+
+	runtime_c::count_t runtime_c::cores() {
+		count_t ret(std::thread::hardware_concurrency());
+		return ret ? ret : 1;
+	}
+
+	void runtime_c::work(const size_t val) {
+		vm_c& vm(*m_workers[val]->vm);
+
+		while (true) {
+			if (vm.tick()) { // a started process stays on its worker (its segments are in this memory)
+				continue;
+			}
+
+			process_c* prc(take(val));
+			if (!prc) { // nothing is pushed while the runtime runs
+				break;
+			}
+			vm.submit(prc);
+		}
+	}
+
+	process_c* runtime_c::take(const size_t val) {
+		{
+			worker_t& wrk(*m_workers[val]);
+			std::lock_guard<std::mutex> grd(wrk.lock);
+			if (!wrk.jobs.empty()) {
+				process_c* ret(wrk.jobs.back());
+				wrk.jobs.pop_back();
+				return ret;
+			}
+		}
+
+		for (size_t idx(1); idx < m_workers.size(); ++idx) { // steal, starting from the next worker
+			worker_t& vic(*m_workers[(val + idx) % m_workers.size()]);
+			std::lock_guard<std::mutex> grd(vic.lock);
+			if (!vic.jobs.empty()) {
+				process_c* ret(vic.jobs.front());
+				vic.jobs.pop_front();
+				++m_workers[val]->steals;
+				return ret;
+			}
+		}
+		return nullptr;
+	}
+
+}
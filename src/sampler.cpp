@@ -0,0 +1,119 @@
+#include "../inc/sampler.hpp"
+#include "../inc/vm.hpp"
+
+#include <sstream>   // std::ostringstream
+#include <fstream>   // std::ofstream
+#include <algorithm> // std::sort
+#include <vector>
+
+namespace vm { /* sampler_c */
+
+	sampler_c::sampler_c()
+		: m_thread()
+		, m_lock()
+		, m_wake()
+		, m_due(false)
+		, m_interval(sampler_c::dinterval)
+		, m_path()
+		, m_stop(false) {
+	}
+
+	sampler_c::~sampler_c() {
+		stop();
+	}
+
+	void sampler_c::start(const path_t& dst, const interval val) {
+		stop();
+		m_path = dst;
+		m_interval = val.count() > 0 ? val : interval(sampler_c::dinterval);
+		m_stop = false;
+		m_thread = std::thread(&sampler_c::work, this);
+	}
+
+	void sampler_c::stop() {
+		if (!m_thread.joinable()) {
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> grd(m_lock);
+			m_stop = true;
+		}
+		m_wake.notify_one();
+		m_thread.join();
+		m_due.store(false, std::memory_order_relaxed);
+	}
+
+	bool sampler_c::enabled() const {
+		return !m_path.empty() && m_thread.joinable();
+	}
+
+	bool sampler_c::write(const process_c& prc, memory_c& mem) const {
+		struct loop_t {
+			idx_t beg, end; // offsets of the target and of the backward jump
+		};
+
+		if (prc.samples.empty()) {
+			return true;
+		}
+
+		// loops of the code segment: jumps to an immediate address before them
+		std::vector<loop_t> loops;
+		const idx_t len(prc.state.clx() & ~idx_t(3));
+		if (const memory_c::loc_t* src = mem.span(prc.base, len)) {
+			for (idx_t off(0); off < len; off += 4) {
+				const memory_c::loc_t* ins(src + off);
+				if (ins[0] == 0x08 || ins[0] == 0x09 || ins[0] == 0x0C || ins[0] == 0x0D) { // jit v / jif v
+					idx_t tgt(((static_cast<idx_t>(ins[1]) << 8) | ins[2]) + 4);
+					if (tgt <= off) {
+						loops.push_back(loop_t{ tgt, off });
+					}
+				}
+			}
+		}
+		std::sort(loops.begin(), loops.end(), [](const loop_t& l, const loop_t& r) { // outer first
+			return l.end - l.beg != r.end - r.beg ? l.end - l.beg > r.end - r.beg : l.beg < r.beg;
+		});
+
+		// root frame: the program
+		std::string root(prc.name.substr(prc.name.find_last_of("/\\") + 1));
+		if (root.empty()) {
+			root = "process_" + std::to_string(prc.id);
+		}
+		for (auto& i : root) {
+			if (i == ';' || i == ' ') {
+				i = '_';
+			}
+		}
+
+		std::vector<std::pair<idx_t, count_t>> samples(prc.samples.begin(), prc.samples.end());
+		std::sort(samples.begin(), samples.end());
+
+		std::ostringstream out;
+		out << std::hex;
+		for (const auto& i : samples) {
+			out << root;
+			for (const auto& j : loops) {
+				if (j.beg <= i.first && i.first <= j.end) {
+					out << ";loop@0x" << j.beg;
+				}
+			}
+			out << ";0x" << i.first << " " << std::dec << i.second << std::hex << "\n";
+		}
+
+		std::ofstream dst(m_path, std::ios_base::out | std::ios_base::app | std::ios_base::binary);
+		if (!dst) {
+			return false;
+		}
+		std::string str(out.str());
+		dst.write(str.data(), static_cast<std::streamsize>(str.size()));
+		return static_cast<bool>(dst.flush());
+	}
+
+	void sampler_c::work() {
+		std::unique_lock<std::mutex> grd(m_lock);
+		while (!m_wake.wait_for(grd, m_interval, [this] { return m_stop; })) {
+			m_due.store(true, std::memory_order_relaxed);
+		}
+	}
+
+}
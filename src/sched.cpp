@@ -0,0 +1,62 @@
+#include "../inc/sched.hpp"
+#include "../inc/vm.hpp"
+
+namespace vm { /* scheduler_c */
+
+	scheduler_c::scheduler_c(fuel_t val)
+		: m_queue()
+		, m_quantum(val > 0 ? val : scheduler_c::dquantum)
+		, m_size(0) {
+	}
+
+	void scheduler_c::push(process_c* val) {
+		prio_t lvl(val->priority < scheduler_c::levels ? val->priority : scheduler_c::levels - 1);
+		val->info |= static_cast<process_c::info_t>(process_c::info_e::READY);
+		m_queue[lvl].push_back(val);
+		++m_size;
+	}
+
+	process_c* scheduler_c::pop() {
+		for (auto& i : m_queue) {
+			if (!i.empty()) {
+				process_c* ret(i.front());
+				i.pop_front();
+				ret->info &= ~static_cast<process_c::info_t>(process_c::info_e::READY);
+				--m_size;
+				return ret;
+			}
+		}
+		return nullptr;
+	}
+
+	bool scheduler_c::erase(process_c* val) {
+		for (auto& i : m_queue) {
+			for (auto itr(i.begin()); itr != i.end(); ++itr) {
+				if (*itr == val) {
+					i.erase(itr);
+					val->info &= ~static_cast<process_c::info_t>(process_c::info_e::READY);
+					--m_size;
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	bool scheduler_c::empty() const {
+		return m_size == 0;
+	}
+
+	size_t scheduler_c::size() const {
+		return m_size;
+	}
+
+	scheduler_c::fuel_t scheduler_c::quantum() const {
+		return m_quantum;
+	}
+
+	void scheduler_c::quantum(const fuel_t val) {
+		m_quantum = val > 0 ? val : scheduler_c::dquantum;
+	}
+
+}
@@ -0,0 +1,155 @@
+#include "../inc/segments.hpp"
+
+#include <chrono> // std::chrono::steady_clock
+
+namespace vm { /* segments_c */
+
+	segments_c::segments_c(const idx_t len)
+		: m_free()
+		, m_slots()
+		, m_used()
+		, m_len(0)
+		, m_fixed(false)
+		, m_rng(static_cast<std::minstd_rand::result_type>(std::chrono::steady_clock::now().time_since_epoch().count())) {
+		reset(len);
+	}
+
+	void segments_c::reset(const idx_t len) {
+		for (auto& i : m_free) {
+			i.clear();
+		}
+		m_slots.clear();
+		m_used.clear();
+		m_len = len & ~((idx_t(1) << segments_c::morder) - 1);
+
+		// largest blocks first: every block is aligned on its length
+		idx_t at(0);
+		for (int32_t ord(segments_c::xorder); ord >= segments_c::morder; --ord) {
+			if (m_len - at >= (idx_t(1) << ord)) {
+				push(at, static_cast<order_t>(ord));
+				at += idx_t(1) << ord;
+			}
+		}
+	}
+
+	segments_c::idx_t segments_c::alloc(const idx_t len) {
+		const order_t want(segments_c::order(len));
+		if (len == 0 || want > segments_c::xorder) {
+			return segments_c::none;
+		}
+
+		order_t ord(want);
+		while (ord <= segments_c::xorder && m_free[ord].empty()) {
+			++ord;
+		}
+		if (ord > segments_c::xorder) {
+			return segments_c::none;
+		}
+
+		const std::vector<idx_t>& lst(m_free[ord]);
+		idx_t at(m_fixed ? lst.back() : lst[m_rng() % lst.size()]);
+		remove(at);
+		while (ord > want) { // keep the upper half, the lower one is free
+			--ord;
+			push(at, ord);
+			at += idx_t(1) << ord;
+		}
+		m_used[at] = want;
+		return at;
+	}
+
+	bool segments_c::free(const idx_t val) {
+		auto itr(m_used.find(val));
+		if (itr == m_used.end()) {
+			return false;
+		}
+		idx_t at(val);
+		order_t ord(itr->second);
+		m_used.erase(itr);
+
+		while (ord < segments_c::xorder) {
+			idx_t bud(at ^ (idx_t(1) << ord));
+			auto slt(m_slots.find(bud));
+			if (slt == m_slots.end() || slt->second.order != ord) {
+				break;
+			}
+			remove(bud);
+			at &= ~(idx_t(1) << ord);
+			++ord;
+		}
+		push(at, ord);
+		return true;
+	}
+
+	bool segments_c::claim(const idx_t val, const idx_t len) {
+		const order_t want(segments_c::order(len));
+		if (len == 0 || want > segments_c::xorder || (val & ((idx_t(1) << want) - 1)) != 0) {
+			return false;
+		}
+
+		// free block holding the address
+		order_t ord(want);
+		idx_t at(val);
+		for (; ord <= segments_c::xorder; ++ord) {
+			at = val & ~((idx_t(1) << ord) - 1);
+			auto slt(m_slots.find(at));
+			if (slt != m_slots.end() && slt->second.order == ord) {
+				break;
+			}
+		}
+		if (ord > segments_c::xorder) {
+			return false;
+		}
+
+		remove(at);
+		while (ord > want) { // keep the half holding the address
+			--ord;
+			idx_t half(idx_t(1) << ord);
+			if (val & half) {
+				push(at, ord);
+				at += half;
+			} else {
+				push(at + half, ord);
+			}
+		}
+		m_used[at] = want;
+		return true;
+	}
+
+	void segments_c::fixed(const bool val) {
+		m_fixed = val;
+	}
+
+	segments_c::idx_t segments_c::length(const idx_t val) const {
+		auto itr(m_used.find(val));
+		return itr == m_used.end() ? 0 : idx_t(1) << itr->second;
+	}
+
+	size_t segments_c::used() const {
+		return m_used.size();
+	}
+
+	segments_c::order_t segments_c::order(const idx_t val) {
+		order_t ret(segments_c::morder);
+		while (ret <= segments_c::xorder && (idx_t(1) << ret) < val) {
+			++ret;
+		}
+		return ret;
+	}
+
+	void segments_c::push(const idx_t at, const order_t ord) {
+		m_slots[at] = slot_t{ static_cast<uint32_t>(m_free[ord].size()), ord };
+		m_free[ord].push_back(at);
+	}
+
+	void segments_c::remove(const idx_t at) {
+		auto itr(m_slots.find(at));
+		std::vector<idx_t>& lst(m_free[itr->second.order]);
+		idx_t last(lst.back());
+		lst[itr->second.pos] = last;
+		m_slots[last].pos = itr->second.pos;
+		lst.pop_back();
+		m_slots.erase(at);
+	}
+
+}
@@ -0,0 +1,100 @@
+#include "../inc/snapshot.hpp"
+
+#include <iostream> // std::cerr
+
+#if defined(__linux__)
+#define Q_MEMFD
+#include <fcntl.h>    // fcntl, F_ADD_SEALS
+#include <sys/mman.h> // memfd_create
+#include <unistd.h>   // ftruncate, close
+#endif
+
+namespace vm { /* snapshot_c */
+
+	snapshot_c::snapshot_c()
+		: m_fd(-1)
+		, m_len(0)
+		, m_clen(0)
+		, m_stack(segments_c::none)
+		, m_slen(0)
+		, m_state()
+		, m_ec(1)
+		, m_priority(0)
+		, m_retired(0)
+		, m_base(0)
+		, m_limit(0) {
+	}
+
+	snapshot_c::~snapshot_c() {
+		close();
+	}
+
+	bool snapshot_c::valid() const {
+		return m_fd >= 0;
+	}
+
+	bool snapshot_c::take(const memory_c& mem, const process_c& prc, const segments_c& seg) {
+		close();
+		try {
+#ifdef Q_MEMFD
+			m_fd = memfd_create("qvm-snapshot", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+			if (m_fd < 0) {
+				throw exception_c("can not create a snapshot");
+			}
+			if (ftruncate(m_fd, mem.length()) != 0 || !mem.dump(m_fd)) {
+				throw exception_c("can not write a snapshot [memory@length: " + std::to_string(mem.length()) + "]");
+			}
+			// frozen: forks map it privately, nobody can change the shared pages
+			fcntl(m_fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+#else
+			throw exception_c("snapshots are not supported on this host");
+#endif
+			m_len = mem.length();
+			m_clen = seg.length(prc.base);
+			m_stack = prc.stack;
+			m_slen = prc.stack == segments_c::none ? 0 : seg.length(prc.stack);
+			m_state = prc.state;
+			m_ec = prc.ec;
+			m_priority = prc.priority;
+			m_retired = prc.retired;
+			m_base = prc.base;
+			m_limit = prc.limit;
+			return true;
+		} catch (const exception_c& exc) {
+			std::cerr << exc.get() << std::endl;
+			close();
+			return false;
+		}
+	}
+
+	bool snapshot_c::map(memory_c& val) const {
+		return valid() && val.fork(m_fd, m_len);
+	}
+
+	void snapshot_c::restore(process_c& val) const {
+		val.state = m_state;
+		val.ec = m_ec;
+		val.priority = m_priority;
+		val.retired = m_retired;
+		val.base = m_base;
+		val.limit = m_limit;
+		val.info |= static_cast<process_c::info_t>(process_c::info_e::STARTED);
+		val.beg = std::chrono::system_clock::now();
+	}
+
+	bool snapshot_c::claim(segments_c& seg, process_c& prc) const {
+		prc.stack = m_stack;
+		return seg.claim(m_base, m_clen) && (m_stack == segments_c::none || seg.claim(m_stack, m_slen));
+	}
+
+	void snapshot_c::close() {
+#ifdef Q_MEMFD
+		if (m_fd >= 0) {
+			::close(m_fd);
+		}
+#endif
+		m_fd = -1;
+		m_len = 0;
+	}
+
+}
@@ -0,0 +1,204 @@
+#include "../inc/verify.hpp"
+#include "../inc/vm.hpp"
+
+#include <sstream>   // std::ostringstream
+#include <algorithm> // std::sort, std::unique
+
+namespace vm { /* verifier_c */
+
+	// operands of every opcode: registers read or written (b, c, d) and b written
+	enum operand_e : uint8_t {
+		RB = 0x01, RC = 0x02, RD = 0x04, WB = 0x08,
+	};
+
+	static constexpr uint8_t operands[] = {
+		0,            RB | WB,      RB | RC | WB, 0,            RB,           RB | WB,      0,            RB,           // nop..exc x
+		0,            RD,           RB,           RB | RC,      0,            RD,           RB | RC,      RB | RC,      // jit, jif
+		RB | WB,      RB | RC | WB, RB | WB,      RB | RC | WB, RB | WB,      RB | RC | WB, RB | WB,      RB | RC | WB, // add..div
+		RB | WB,      RB | RC | WB, RB | WB,      RB | RC | WB, RB | WB,      RB | RC | WB, RB | WB,      RB | RC | WB, // and..shl
+		RB | WB,      RB | RC | WB, RB | WB,      RB,           RB | RC,                                              // shr, not, cmp
+		RB | WB,      RB,           RB | WB,      RB,           RB | RC,      RB | RC,      RB | RC,                    // ldw..mcm
+	};
+
+	verifier_c::verifier_c()
+		: m_blocks()
+		, m_error()
+		, m_length(0)
+		, m_reachable(0)
+		, m_verified(false)
+		, m_dynamic(false) {
+	}
+
+	bool verifier_c::run(const loc_t* code, const idx_t len) {
+		const idx_t cnt(len / 4);
+		m_blocks.clear();
+		m_error.clear();
+		m_length = len;
+		m_reachable = 0;
+		m_verified = false;
+		m_dynamic = false;
+
+		// reachable instructions, from the entry
+		std::vector<uint8_t> seen(cnt, 0);
+		std::vector<idx_t> work;
+		std::vector<idx_t> leaders;
+		idx_t bad(verifier_c::none);
+		const char* why(nullptr);
+		if (cnt) {
+			work.push_back(0);
+			seen[0] = 1;
+			leaders.push_back(0);
+		}
+		while (!work.empty()) {
+			const idx_t idx(work.back());
+			work.pop_back();
+			++m_reachable;
+
+			const loc_t* ins(code + idx * 4);
+			if (const char* err = verifier_c::check(ins, len)) {
+				if (bad == verifier_c::none || idx < bad) { // the first one is reported
+					bad = idx;
+					why = err;
+				}
+				continue;
+			}
+			m_dynamic |= verifier_c::transfer(ins);
+
+			const idx_t tgt(verifier_c::target(ins));
+			if (tgt != verifier_c::none || ins[0] == 0x0A || ins[0] == 0x0B || ins[0] == 0x0E || ins[0] == 0x0F) {
+				if (idx + 1 < cnt) {
+					leaders.push_back(idx + 1); // after a jump
+				}
+			}
+			if (tgt != verifier_c::none && tgt / 4 < cnt) {
+				leaders.push_back(tgt / 4);
+				if (!seen[tgt / 4]) {
+					seen[tgt / 4] = 1;
+					work.push_back(tgt / 4);
+				}
+			}
+			if (idx + 1 < cnt && !seen[idx + 1]) {
+				seen[idx + 1] = 1;
+				work.push_back(idx + 1);
+			}
+		}
+		if (bad != verifier_c::none) {
+			std::ostringstream out;
+			out << why << " at 0x" << std::hex << bad * 4;
+			m_error = out.str();
+			return false;
+		}
+
+		// with a dynamic transfer any instruction may run
+		m_verified = true;
+		if (m_dynamic) {
+			for (idx_t idx(0); idx < cnt && m_verified; ++idx) {
+				m_verified = verifier_c::check(code + idx * 4, len) == nullptr;
+			}
+		}
+
+		// basic blocks of the reachable code
+		std::sort(leaders.begin(), leaders.end());
+		leaders.erase(std::unique(leaders.begin(), leaders.end()), leaders.end());
+		for (size_t idx(0); idx < leaders.size(); ++idx) {
+			const idx_t beg(leaders[idx]);
+			idx_t end(idx + 1 < leaders.size() ? leaders[idx + 1] : cnt);
+			for (idx_t i(beg); i < end; ++i) { // stops at the first unreachable instruction
+				if (!seen[i]) {
+					end = i;
+				}
+			}
+			if (end == beg) {
+				continue;
+			}
+			const loc_t* last(code + (end - 1) * 4);
+			m_blocks.push_back(block_t{
+				beg * 4, (end - beg) * 4, end < cnt ? end * 4 : verifier_c::none, verifier_c::target(last)
+			});
+		}
+		return true;
+	}
+
+	bool verifier_c::verified() const {
+		return m_verified;
+	}
+
+	bool verifier_c::dynamic() const {
+		return m_dynamic;
+	}
+
+	verifier_c::idx_t verifier_c::reachable() const {
+		return m_reachable;
+	}
+
+	const std::string& verifier_c::error() const {
+		return m_error;
+	}
+
+	const std::vector<verifier_c::block_t>& verifier_c::blocks() const {
+		return m_blocks;
+	}
+
+	std::string verifier_c::json() const {
+		std::ostringstream out;
+		out << "{\"length\":" << m_length
+			<< ",\"valid\":" << (m_error.empty() ? "true" : "false")
+			<< ",\"verified\":" << (m_verified ? "true" : "false")
+			<< ",\"dynamic\":" << (m_dynamic ? "true" : "false")
+			<< ",\"reachable\":" << m_reachable;
+		if (!m_error.empty()) {
+			out << ",\"error\":\"" << m_error << "\"";
+		}
+		out << ",\"blocks\":[";
+		for (size_t idx(0); idx < m_blocks.size(); ++idx) {
+			const block_t& blk(m_blocks[idx]);
+			out << (idx ? "," : "") << "{\"addr\":" << blk.beg << ",\"length\":" << blk.len << ",\"successors\":[";
+			bool sep(false);
+			for (const idx_t i : { blk.next, blk.target }) {
+				if (i != verifier_c::none) {
+					out << (sep ? "," : "") << i;
+					sep = true;
+				}
+			}
+			out << "]}";
+		}
+		out << "]}\n";
+		return out.str();
+	}
+
+	const char* verifier_c::check(const loc_t* ins, const idx_t len) {
+		if (ins[0] >= sizeof(operands) / sizeof(*operands)) {
+			return "unknown opcode";
+		}
+		const uint8_t ops(operands[ins[0]]);
+		if (((ops & RB) && ins[1] >= core_c::nregs) || ((ops & RC) && ins[2] >= core_c::nregs) || ((ops & RD) && ins[3] >= core_c::nregs)) {
+			return "invalid register";
+		}
+		const idx_t tgt(verifier_c::target(ins));
+		if (tgt != verifier_c::none && (tgt % 4 != 0 || tgt > len)) {
+			return "jump target outside the code";
+		}
+		return nullptr;
+	}
+
+	verifier_c::idx_t verifier_c::target(const loc_t* ins) {
+		switch (ins[0]) {
+		case 0x08: // jit v,v
+		case 0x09: // jit v,x
+		case 0x0C: // jif v,v
+		case 0x0D: // jif v,x
+			return ((static_cast<idx_t>(ins[1]) << 8) | ins[2]) + 4; // ipx is set, then the step adds 4
+		default:
+			return verifier_c::none;
+		}
+	}
+
+	bool verifier_c::transfer(const loc_t* ins) {
+		constexpr uint8_t csx(core_c::xregs + 0), clx(core_c::xregs + 2);
+		if (ins[0] == 0x0A || ins[0] == 0x0B || ins[0] == 0x0E || ins[0] == 0x0F) { // register target
+			return true;
+		}
+		return ins[0] < sizeof(operands) / sizeof(*operands) && (operands[ins[0]] & WB) && ins[1] >= csx && ins[1] <= clx;
+	}
+
+}
@@ -1,1029 +1,1742 @@
-#include "../inc/vm.hpp"
-
-#if defined(_DEBUG) || defined(DEBUG)
-#define Q_DEBUG
-#endif
-
-#include <xtr1common> // std::enable_if, std::is_arithmetic, std::remove_reference...
-
-namespace vm { /* conversion utilities */
-
-	using float32_t = float;
-	using float64_t = double;
-
-#define ARITHMETIC(tp)                                     \
-	std::enable_if_t<                                      \
-		std::is_arithmetic_v<std::remove_reference_t<tp>>, \
-		std::remove_reference_t<tp>                        \
-	>* = nullptr
-
-	template <class src_t, class dst_t, ARITHMETIC(src_t), ARITHMETIC(dst_t)>
-	dst_t to_type(const src_t val) {
-		union {
-			src_t s;
-			dst_t d;
-		} v;
-		v.s = val;
-		return v.d;
-	}
-
-}
-
-#include <iostream> // std::cout, std::cin, std::cerr
-#include <cctype>
-
-namespace vm { /* hex utilities */
-
-	uint8_t hex_dig_to_dec_dig(uint8_t val) {
-		if (val >= '0' && val <= '9') { // [0-9]
-			return val - '0';
-		}
-		if ((val = toupper(val)) >= 'A' && val <= 'F') { // [A-F]
-			return val - 'A' + 10;
-		}
-		return 0;
-	}
-
-	uint8_t dec_val_to_hex_dig(uint8_t val) {
-		if (val >= 0 && val <= 9) {
-			return val + '0';
-		} else if (val >= 10 && val <= 15) {
-			return (val - 10) + 'A';
-		}
-		return 0;
-	}
-
-#define INTEGRAL(tp)                                     \
-	std::enable_if_t<                                    \
-		std::is_integral_v<std::remove_reference_t<tp>>, \
-		std::remove_reference_t<tp>                      \
-	>* = nullptr
-
-	template <class type_t, INTEGRAL(type_t)>
-	std::string to_hex(type_t val) {
-		uint8_t len(sizeof(type_t));
-		
-		uint8_t* var = new uint8_t[len]{ 0 }; // val as array of u8
-		for (uint8_t idx(0); idx < len; ++idx) {
-			var[idx] = val >> (((len - 1) - idx) * 8);
-		}
-
-		std::string ret;
-		uint8_t tmp[2]{ 0 }; // string in format 00
-		for (uint8_t idx(0); idx < len; ++idx) {
-			uint8_t dig(var[idx] / 0x10); // digit to parse
-			tmp[0] = dec_val_to_hex_dig(dig);
-			dig = var[idx] - (dig * 0x10);
-			tmp[1] = dec_val_to_hex_dig(dig);
-			ret.push_back(tmp[0]);
-			ret.push_back(tmp[1]);
-		}
-		delete[] var;
-		return std::string(ret);
-	}
-
-}
-
-#include <fstream> // std::ifstream, std::ofstream, std::ios_base
-
-namespace vm { /* file */
-
-	std::string read(std::string path, std::ios_base::openmode mode) {
-		std::ifstream in(path, mode);
-		if (in.is_open()) {
-			std::string ret;
-			while (!in.eof()) {
-				ret.push_back(in.get());
-			}
-			return ret;
-		}
-		return std::string();
-	}
-
-	void write(std::string path, std::ios_base::openmode mode, const std::string val) {
-		std::ofstream out(path, mode);
-		if (out.is_open()) {
-			out.write(val.c_str(), val.size());
-		}
-	}
-
-}
-
-namespace vm { /* exception_c */
-
-	exception_c::exception_c(msg_t val) 
-		: m_msg(val) {
-	}
-
-	exception_c::exception_c(const exception_c& val)
-		: m_msg(val.get()) {
-	}
-
-	exception_c::exception_c(exception_c&& val) noexcept
-		: m_msg(std::move(val.get())) {
-	}
-
-	exception_c& exception_c::operator=(const exception_c& val) {
-		m_msg = val.get();
-		return *this;
-	}
-
-	exception_c& exception_c::operator=(exception_c&& val) noexcept {
-		m_msg = std::move(val.get());
-		return *this;
-	}
-
-	exception_c::msg_t exception_c::get() const {
-		return m_msg;
-	}
-
-	exception_c::msg_t& exception_c::get() {
-		return m_msg;
-	}
-
-}
-
-namespace vm { /* core_c */
-
-	core_c::core_c(const core_c& val) 
-		: csx(val.csx)
-		, ipx(val.ipx)
-		, clx(val.clx) 
-		, ssx(val.ssx) 
-		, spx(val.spx) 
-		, slx(val.slx) 
-		, ax(val.ax) 
-		, sx(val.sx) 
-		, fx(val.fx) {
-		for (rega_t idx(0); idx < core_c::xregs; ++idx) {
-			x[idx] = val.x[idx];
-		}
-	}
-
-	core_c::core_c(core_c&& val) noexcept
-		: csx(std::move(val.csx))
-		, ipx(std::move(val.ipx))
-		, clx(std::move(val.clx))
-		, ssx(std::move(val.ssx))
-		, spx(std::move(val.spx))
-		, slx(std::move(val.slx))
-		, ax(std::move(val.ax))
-		, sx(std::move(val.sx))
-		, fx(std::move(val.fx)) {
-		for (rega_t idx(0); idx < core_c::xregs; ++idx) {
-			x[idx] = std::move(val.x[idx]);
-		}
-	}
-
-	core_c& core_c::operator=(const core_c& val) {
-		for (rega_t idx(0); idx < core_c::xregs; ++idx) {
-			x[idx] = val.x[idx];
-		}
-		csx = val.csx;
-		ipx = val.ipx;
-		clx = val.clx;
-		ssx = val.ssx;
-		spx = val.spx;
-		slx = val.slx;
-		ax = val.ax;
-		sx = val.sx;
-		fx = val.fx;
-		return *this;
-	}
-
-	core_c& core_c::operator=(core_c&& val) noexcept {
-		for (rega_t idx(0); idx < core_c::xregs; ++idx) {
-			x[idx] = std::move(val.x[idx]);
-		}
-		csx = std::move(val.csx);
-		ipx = std::move(val.ipx);
-		clx = std::move(val.clx);
-		ssx = std::move(val.ssx);
-		spx = std::move(val.spx);
-		slx = std::move(val.slx);
-		ax = std::move(val.ax);
-		sx = std::move(val.sx);
-		fx = std::move(val.fx);
-		return *this;
-	}
-
-	core_c::reg32_t& core_c::get(const rega_t val) {
-		if (val < core_c::xregs) {
-			return x[val];
-		}
-		switch (val - core_c::xregs) {
-		/* code segment */
-		case 0:
-			return csx;
-		case 1:
-			return ipx;
-		case 2:
-			return clx;
-
-		/* stack segment */
-		case 3:
-			return ssx;
-		case 4:
-			return spx;
-		case 5:
-			return slx;
-
-		/* memory address  */
-		case 6:
-			return ax;
-
-		/* system flags    */
-		case 7:
-			return sx;
-
-		/* internal flags  */
-		case 8:
-			return fx;
-
-		default:
-			static reg32_t ret = 0;
-			return ret;
-		}
-	}
-
-	core_c core_c::flush() {
-		return core_c(std::move(*this));
-	}
-
-}
-
-namespace vm { /* memory_c */
-
-	memory_c::memory_c(idx_t val)
-		: m_len(val ? val : memory_c::dlen)
-		, m_data(nullptr) {
-		try {
-			m_data = new loc_t[m_len]{ 0 };
-		} catch (...) {
-			std::cerr << "bad alloc [memory@length: " << m_len << "]";
-		}
-	}
-
-	memory_c::~memory_c() {
-		delete[] m_data;
-	}
-
-	memory_c::idx_t memory_c::length() const {
-		return m_len;
-	}
-
-	memory_c::loc_t& memory_c::get(const idx_t val) {
-		static loc_t ret(0);
-		try {
-			if (val >= m_len) {
-				throw exception_c("bad index");
-			}
-			return m_data[val];
-		} catch (const exception_c& exc) {
-			std::cerr << exc.get() << std::endl;
-			return ret;
-		}
-	}
-
-}
-
-#include <cmath> // rand
-#include <ctime> // time
-
-namespace vm { /* process_c */
-
-	process_c::process_c(info_t val)
-		: id(0)
-		, info(val)
-		, state() {
-	}
-
-	process_c::code_t process_c::load(const path_t val) {
-		try {
-			code_t src(read(val, std::ios_base::in));
-			if (src.empty()) {
-				throw exception_c("empty source [" + val + "]");
-			}
-
-			code_t ret, tmp;
-
-			auto to_dec = [](const char* hex) {
-				if (!hex || strlen(hex) != 2) {
-					return 0;
-				}
-				return hex_dig_to_dec_dig(hex[0]) * 0x10 + hex_dig_to_dec_dig(hex[1]);
-			};
-
-			for (auto i : src) {
-				if ((i >= '0' && i <= '9') || ((i = toupper(i)) >= 'A' && i <= 'F')) {
-					tmp.push_back(i);
-				}
-				if (tmp.size() == 2) {
-					ret.push_back(to_dec(tmp.c_str()));
-					tmp.clear();
-				}
-			}
-
-			if (ret.size() % sizeof(instr_t) != 0) {
-				throw exception_c("invalid bytecode source [" + val + "]");
-			}
-			if (ret.empty()) {
-				throw exception_c("empty bytecode source [" + val + "]");
-			}
-
-			state.clx = ret.size();
-			return ret;
-		} catch (const exception_c& exc) {
-			std::cerr << exc.get() << std::endl;
-			return code_t();
-		}
-	}
-
-	void process_c::start(const id_t mx, const memory_c::idx_t mx_len) {
-		id = rand() % 0xFFFFFFFF;
-		state.csx = rand() % mx;
-		// state.clx = mx_len - mx; // size of code segment
-		state.ipx = state.csx;
-		info |= (uint8_t)info_e::STARTED;
-	}
-
-}
-
-#define PRC_IS_STARTED(prc) ((prc->info & (uint8_t)process_c::info_e::STARTED) != 0)
-#define PRC_CLOSE(prc)       \
-	do {                     \
-		prc->info &= 0xFFFE; \
-		delete m_prc;        \
-		prc = nullptr;       \
-	} while (false);
-
-#include <string> // std::to_string, std::getline...
-#include <thread> // std::this_thread
-
-namespace vm {
-
-	vm_c::vm_c(idx_t val)
-		: m_memory(val)
-		, m_start(std::chrono::system_clock::now())
-		, m_prc(nullptr)
-		, m_ver(1)
-		, m_ec(1) {
-		srand(time(nullptr));
-	}
-
-	int32_t vm_c::start() {
-
-		std::cin.clear();
-		std::cout.clear();
-		std::cerr.clear();
-
-		int32_t ret(1);
-		time_point beg;
-		uint8_t dbg(0);
-
-		static core_c::reg32_t mx_ip(0);
-
-		while (true) {
-			if (m_prc && PRC_IS_STARTED(m_prc)) {
-				if (m_state.ipx < mx_ip) {
-					ret = engine(
-						m_memory.get(m_state.ipx),
-						m_memory.get(m_state.ipx + 1),
-						m_memory.get(m_state.ipx + 2),
-						m_memory.get(m_state.ipx + 3)
-					);
-					m_state.ipx += 4;
-
-					if (dbg) { // view
-						ret = view(dbg);
-					}
-				} else {
-					ret = 0;
-				}
-
-				// check special codes
-
-				if (ret == 0) { // close
-					auto end(std::chrono::system_clock::now());
-					std::cout << "process (" << m_prc->id << ") ended with " << m_ec
-						<< std::endl << "time elapsed: "
-						<< std::chrono::duration_cast<std::chrono::duration<double>>(end - beg).count() << "s"
-						<< std::endl;
-					PRC_CLOSE(m_prc);
-				}
-			} else {
-				ret = menu();
-
-				// check special codes
-
-				switch (ret) {
-				case 1: // close
-					beg = std::chrono::system_clock::now();
-					m_state = m_prc->state;
-					mx_ip = m_state.csx + m_state.clx;
-					m_state.ipx = m_state.csx;
-					break;
-
-				/* debug */
-				case 2:
-					dbg = 1; // show registers
-					break;
-				case 3:
-					dbg = 2; // show stack
-					break;
-				case 4:
-					dbg = 3; // show registers and stack
-					break;
-				case 5:
-					dbg = 4; // stop after each instruction and show registers and stack
-					break;
-
-				default:
-					dbg = 0;
-					break;
-				}
-			}
-
-			if (ret == -1) {
-				break;
-			}
-		}
-
-		return ret;
-	}
-
-	int32_t vm_c::engine(const loc_t a, const loc_t b, const loc_t c, const loc_t d) {
-		core_c::reg32_t val(0);
-
-		switch (a) {
-		case 0x00: // nop
-			break;
-
-		case 0x01: // ldx x,v
-			m_state.get(b) = (static_cast<core_c::reg32_t>(c) << 8) | d;
-			if (b == core_c::xregs + 5) { // slx
-				while (true) {
-					m_state.ssx = rand() % 0xFFFFFFFF;
-					if (
-						(m_state.ssx + m_state.slx < m_state.csx) ||
-						(m_state.ssx > m_state.csx + m_state.clx)
-						) {
-						break;
-					}
-				}
-			}
-			break;
-
-		case 0x02: // ldx x,x
-			m_state.get(b) = m_state.get(c);
-			if (b == core_c::xregs + 5) { // slx
-				while (true) {
-					m_state.ssx = rand() % 0xFFFFFFFF;
-					if (
-						(m_state.ssx + m_state.slx < m_state.csx) ||
-						(m_state.ssx > m_state.csx + m_state.clx)
-						) {
-						break;
-					}
-				}
-			}
-			break;
-
-		case 0x03: // set v
-			m_memory.get(m_state.ax) = b;
-			break;
-
-		case 0x04: // set x
-			m_memory.get(m_state.ax) = m_state.get(b);
-			break;
-
-		case 0x05: // get x
-			m_state.get(b) = m_memory.get(m_state.ax);
-			break;
-
-		case 0x06: // exc v
-			return execute(
-				(static_cast<core_c::reg32_t>(b) << 0x10) | (static_cast<core_c::reg32_t>(c) << 8) | d
-			);
-
-		case 0x07: // exc x
-			return execute(m_state.get(b));
-
-		case 0x08: // jit v,v
-			if (m_state.fx == d) {
-				m_state.ipx = m_state.csx + ((static_cast<core_c::reg32_t>(b) << 8) | c);
-			}
-			break;
-
-		case 0x09: // jit v,x
-			if (m_state.fx == m_state.get(d)) {
-				m_state.ipx = m_state.csx + ((static_cast<core_c::reg32_t>(b) << 8) | c);
-			}
-			break;
-
-		case 0x0A: // jit x,v
-			if (m_state.fx == ((static_cast<core_c::reg32_t>(c) << 8) | d)) {
-				m_state.ipx = m_state.csx + m_state.get(b);
-			}
-			break;
-
-		case 0x0B: // jit x,x
-			if (m_state.fx == m_state.get(c)) {
-				m_state.ipx = m_state.csx + m_state.get(b);
-			}
-			break;
-
-		case 0x0C: // jif v,v
-			if (m_state.fx != d) {
-				m_state.ipx = m_state.csx + ((static_cast<core_c::reg32_t>(b) << 8) | c);
-			}
-			break;
-
-		case 0x0D: // jif v,x
-			if (m_state.fx != m_state.get(d)) {
-				m_state.ipx = m_state.csx + ((static_cast<core_c::reg32_t>(b) << 8) | c);
-			}
-			break;
-
-		case 0x0E: // jif x,v
-			if (m_state.fx != m_state.get(c)) {
-				m_state.ipx = m_state.csx + m_state.get(b);
-			}
-			break;
-
-		case 0x0F: // jif x,x
-			if (m_state.fx != m_state.get(c)) {
-				m_state.ipx = m_state.csx + m_state.get(b);
-			}
-			break;
-
-		case 0x10: // add x,v
-			m_state.get(b) += (static_cast<core_c::reg32_t>(c) << 8) | d;
-			break;
-
-		case 0x11: // add x,x
-			m_state.get(b) += m_state.get(c);
-			break;
-
-		case 0x12: // sub x,v
-			compare(m_state.get(b), m_state.get(c));
-			m_state.get(b) -= (static_cast<core_c::reg32_t>(c) << 8) | d;
-			break;
-
-		case 0x13: // sub x,x
-			compare(m_state.get(b), m_state.get(c));
-			m_state.get(b) -= m_state.get(c);
-			break;
-
-		case 0x14: // mul x,v
-			m_state.get(b) *= (static_cast<core_c::reg32_t>(c) << 8) | d;
-			break;
-
-		case 0x15: // mul x,x
-			m_state.get(b) *= m_state.get(c);
-			break;
-
-		case 0x16: // div x,v
-			val = (static_cast<core_c::reg32_t>(c) << 8) | d;
-			if (throw_if(val == 0, "math [0 as divisor]")) {
-				return 0;
-			}
-			m_state.get(b) /= val;
-			break;
-
-		case 0x17: // div x,x
-			if (throw_if(m_state.get(c) == 0, "math [0 as divisor]")) {
-				return 0;
-			}
-			m_state.get(b) /= m_state.get(c);
-			break;
-
-		case 0x18: // and x,v
-			m_state.get(b) &= (static_cast<core_c::reg32_t>(c) << 8) | d;
-			break;
-
-		case 0x19: // and x,x
-			m_state.get(b) &= m_state.get(c);
-			break;
-
-		case 0x1A: // or x,v
-			m_state.get(b) |= (static_cast<core_c::reg32_t>(c) << 8) | d;
-			break;
-
-		case 0x1B: // or x,x
-			m_state.get(b) |= m_state.get(c);
-			break;
-
-		case 0x1C: // xor x,v
-			m_state.get(b) ^= (static_cast<core_c::reg32_t>(c) << 8) | d;
-			break;
-
-		case 0x1D: // xor x,x
-			m_state.get(b) ^= m_state.get(c);
-			break;
-
-		case 0x1E: // shl x,v
-			m_state.get(b) <<= (static_cast<core_c::reg32_t>(c) << 8) | d;
-			break;
-
-		case 0x1F: // shl x,x
-			m_state.get(b) <<= m_state.get(c);
-			break;
-
-		case 0x20: // shr x,v
-			m_state.get(b) >>= (static_cast<core_c::reg32_t>(c) << 8) | d;
-			break;
-
-		case 0x21: // shr x,x
-			m_state.get(b) >>= m_state.get(c);
-			break;
-
-		case 0x22: // not x
-			m_state.get(b) = ~m_state.get(b);
-			break;
-
-		case 0x23: // cmp x,v
-			compare(m_state.get(b), (static_cast<core_c::reg32_t>(c) << 8) | d);
-			break;
-
-		case 0x24: // cmp x,x
-			compare(m_state.get(b), m_state.get(c));
-			break;
-
-		default:
-			throw_if(true, "process (" + std::to_string(m_prc->id) 
-				+ ") has an invalid instruction [" + to_hex(a) + " " + to_hex(b) + " "
-				+ to_hex(c) + " " + to_hex(d) + "]");
-			return 0;
-		}
-
-		return 1;
-	}
-
-	int32_t vm_c::execute(const uint32_t val) {
-
-		// used by input methods
-		static uint8_t vc(0);
-		static int32_t vi(0);
-		static float32_t vf(0);
-
-		// used by string input and output methods
-		uint32_t ptr(m_state.x[0]), len(m_state.x[1]), idx(ptr);
-		static std::string str;
-
-		switch (val) {
-		case 0x00000001: // exit, abort...
-
-			switch (m_state.sx) {
-			case 0x00000001: // exit
-				m_ec = to_type<ecode_t, core_c::reg32_t>(m_state.x[0]);
-				return 0;
-
-			case 0x00000002: // abort
-				throw_if(true, "process (" + std::to_string(m_prc->id) + ") aborted");
-				m_ec = -1;
-				return 0;
-
-			default:
-				break;
-			}
-
-			break;
-
-		case 0x00000002: // [console] input, output...
-
-			switch (m_state.sx) {
-			case 0x00000001: // [output] char
-				std::cout << (char)m_state.x[0];
-				break;
-
-			case 0x00000002: // [output] unsigned integer number
-				std::cout << m_state.x[0];
-				break;
-
-			case 0x00000003: // [output] signed integer number
-				std::cout << to_type<core_c::reg32_t, int>(m_state.x[0]);
-				break;
-
-			case 0x00000004: // [output] floating point number
-				std::cout << to_type<core_c::reg32_t, float>(m_state.x[0]);
-				break;
-
-			case 0x00000005: // [output] string
-				while (idx < ptr + len) {
-					std::cout << m_memory.get(idx);
-					++idx;
-				}
-				break;
-
-			case 0x00000006: // [input] char
-				std::getline(std::cin, str);
-				m_state.x[0] = str.front();
-				break;
-
-			case 0x00000007: // [input] unsigned integer number
-				std::cin >> m_state.x[0];
-				break;
-
-			case 0x00000008: // [input] signed integer number
-				std::cin >> vi;
-				m_state.x[0] = to_type<int, core_c::reg32_t>(vi);
-				break;
-
-			case 0x00000009: // [input] floating point number
-				std::cin >> vf;
-				m_state.x[0] = to_type<float, core_c::reg32_t>(vf);
-				break;
-
-			case 0x0000000A: // [input] string
-				std::getline(std::cin, str);
-				m_state.x[0] = str.size();
-				for (auto i : str) {
-					++m_state.spx;
-					m_memory.get(m_state.spx) = i;
-				}
-				break;
-
-			case 0x0000000B: // [output] clear screen
-				system("cls");
-				break;
-
-			default:
-				break;
-			}
-
-			break;
-
-		case 0x00000003: // [file] input, output...
-
-			// coming soon...
-
-			switch (m_state.sx) {
-			case 0x00000001: // open file
-				break;
-
-			case 0x00000002: // close file
-				break;
-
-			case 0x00000003: // remove file
-				break;
-
-			default:
-				break;
-			}
-
-			break;
-
-		default:
-			break;
-		}
-	}
-
-	bool vm_c::throw_if(const bool cnd, const msg_t val) {
-		try {
-			if (cnd) {
-				throw exception_c(val);
-			}
-		} catch (const exception_c& exc) {
-			std::cerr << exc.get() << std::endl;
-			return true;
-		}
-		return false;
-	}
-
-	void vm_c::compare(const uint32_t left, const uint32_t right) {
-		if (left < right) {
-			m_state.fx = 0x0001; // less flag
-		} else if (left == right) {
-			m_state.fx = 0x0002; // equal flag
-		} else {
-			m_state.fx = 0x0004; // greater flag
-		}
-	}
-
-	void vm_c::show_regs() {
-		std::cout << "\n" << msg_t(47, '-') << "\n";
-		std::cout << "registers" << "\n";
-		std::cout << msg_t(47, '-') << "\n";
-		core_c::rega_t i(1);
-		for (core_c::rega_t idx(0); idx < core_c::xregs; ++idx, ++i) {
-			std::cout << "[x" << idx + 1;
-			if (idx + 1 < 10) {
-				std::cout << " ";
-			}
-			std::cout << "][" << to_hex(m_state.x[idx]) << "]\t";
-			if (i == 3) {
-				std::cout << "\n";
-				i = 0;
-			}
-		}
-		std::cout << "\n" << msg_t(47, '-') << "\n";
-		std::cout << "[csx][" << to_hex(m_state.csx) << "]\t";
-		std::cout << "[ipx][" << to_hex(m_state.ipx) << "]\t";
-		std::cout << "[clx][" << to_hex(m_state.clx) << "]\t\n";
-		std::cout << msg_t(47, '-') << "\n";
-		std::cout << "[ssx][" << to_hex(m_state.ssx) << "]\t";
-		std::cout << "[spx][" << to_hex(m_state.spx) << "]\t";
-		std::cout << "[slx][" << to_hex(m_state.slx) << "]\t\n";
-		std::cout << msg_t(47, '-') << "\n";
-		std::cout << "[ax][" << to_hex(m_state.ax) << "]\t";
-		std::cout << "[sx][" << to_hex(m_state.sx) << "]\t";
-		std::cout << "[fx][" << to_hex(m_state.fx) << "]\t\n";
-		std::cout << msg_t(47, '-') << "\n";
-	}
-
-	void vm_c::show_stack() {
-		std::cout << "\n" << msg_t(47, '-') << "\n";
-		std::cout << "stack" << "\n";
-		std::cout << msg_t(47, '-') << "\n";
-		idx_t i(1);
-		for (idx_t idx(m_state.ssx); idx < m_state.spx; ++idx, ++i) {
-			std::cout << "[" << to_hex(m_state.ssx + idx) << "][" << to_hex(m_memory.get(idx)) << "]\t";
-			if (i == 3) {
-				std::cout << "\n";
-				i = 0;
-			}
-		}
-		if (m_state.ssx == m_state.spx || m_state.slx == 0 || m_state.ssx == 0 || m_state.spx == 0) {
-			std::cout << "empty stack...";
-		}
-		std::cout << "\n" << msg_t(47, '-') << "\n";
-	}
-
-	int32_t vm_c::view(const uint8_t val) {
-		switch (val) {
-		case 1:
-			show_regs();
-			break;
-		case 2:
-			show_stack();
-			break;
-		case 3:
-			show_regs();
-			show_stack();
-			break;
-		case 4:
-			show_regs();
-			show_stack();
-			std::cout << "\n" << msg_t(47, '-') << "\n";
-			char c;
-			std::cout << "press 'b' to break or other key to continue: ";
-			std::cin >> c;
-			std::cout << msg_t(47, '-') << "\n";
-			if ((c = tolower(c)) == 'b') {
-				return 0;
-			}
-			break;
-		default:
-			break;
-		}
-		return 1;
-	}
-
-#define MAX_HYPENS 50
-#define VPAD_CLS 30
-
-	int32_t vm_c::menu() {
-		static std::string dir;
-		static std::string ver("-----[ QVM " + std::to_string(m_ver) + " ]-----");
-		static size_t hypens(MAX_HYPENS - ver.size());
-
-		while (true) {
-			bool brk(false);
-			char c('\0');
-			while (!brk) {
-				std::cout << std::string(VPAD_CLS, '\n');
-
-				std::cout << ver << std::string(hypens, '-') << "\n";
-				std::cout << "[1] load program\n";
-				std::cout << "[2] run program\n";
-				std::cout << "[3] debug\n";
-				std::cout << "[4] directory\n";
-				std::cout << "[0] exit\n";
-				std::cout << std::string(MAX_HYPENS, '-') << "\n";
-				std::cin.clear();
-				std::cin >> c;
-
-				if (c > '4') {
-					std::cout << std::string(MAX_HYPENS, '-') << "\n";
-					std::cerr << "invalid choice...\n";
-					std::cout << std::string(MAX_HYPENS, '-') << "\n";
-					std::this_thread::sleep_for(std::chrono::seconds(2));
-					brk = false;
-				} else {
-					brk = true;
-				}
-			}
-
-			std::string src;
-
-			switch (c) {
-			case '0':
-				return -1;
-
-			case '1': // load
-				brk = false;
-				while (!brk) {
-					std::cout << std::string(VPAD_CLS, '\n');
-
-					std::cout << ver << std::string(hypens, '-') << "\n";
-					std::cout << "program file: ";
-					std::cin.clear();
-					std::cin >> src;
-					std::cout << std::string(MAX_HYPENS, '-') << "\n";
-
-					if (src.empty()) {
-						std::cout << std::string(MAX_HYPENS, '-') << "\n";
-						std::cerr << "invalid source path...\n";
-						std::cout << std::string(MAX_HYPENS, '-') << "\n";
-						std::this_thread::sleep_for(std::chrono::seconds(2));
-						brk = false;
-					} else {
-						brk = true;
-					}
-				}
-				m_prc = new process_c();
-				m_code = m_prc->load(dir + "/" + src);
-				if (m_code.empty()) {
-					delete m_prc;
-					m_prc = nullptr;
-				}
-				break;
-
-			case '2': // run
-				if (!m_prc) {
-					std::cout << std::string(MAX_HYPENS, '-') << "\n";
-					std::cerr << "invalid choice...\n";
-					std::cout << std::string(MAX_HYPENS, '-') << "\n";
-					std::this_thread::sleep_for(std::chrono::seconds(2));
-				} else {
-					m_prc->start(m_memory.length() - m_code.size(), m_memory.length());
-					for (idx_t idx(0); idx < (m_prc->state.clx); ++idx) {
-						m_memory.get(m_prc->state.csx + idx) = m_code.at(idx);
-					}
-					m_code.clear();
-					return 1;
-				}
-				break;
-
-			case '3': // debug
-				brk = false;
-				while (!brk) {
-					std::cout << std::string(VPAD_CLS, '\n');
-
-					std::cout << ver << std::string(hypens, '-') << "\n";
-					std::cout << "[1] show registers\n";
-					std::cout << "[2] show stack\n";
-					std::cout << "[3] show both\n";
-					std::cout << "[4] stop after each instruction and show both\n";
-					std::cout << "[0] exit\n";
-					std::cout << std::string(MAX_HYPENS, '-') << "\n";
-					std::cin.clear();
-					std::cin >> c;
-
-					if (c > '4') {
-						std::cout << std::string(MAX_HYPENS, '-') << "\n";
-						std::cerr << "invalid choice...\n";
-						std::cout << std::string(MAX_HYPENS, '-') << "\n";
-						std::this_thread::sleep_for(std::chrono::seconds(2));
-						brk = false;
-					} else {
-						brk = true;
-					}
-				}
-
-				if (c == '0') {
-					return 0;
-				}
-				return (c - '0' + 1);
-
-			case '4': // directory
-				brk = false;
-				while (!brk) {
-					std::cout << std::string(VPAD_CLS, '\n');
-
-					std::cout << ver << std::string(hypens, '-') << "\n";
-					std::cout << "directory: ";
-					std::cin.clear();
-					std::cin >> src;
-					std::cout << std::string(MAX_HYPENS, '-') << "\n";
-
-					if (src.empty()) {
-						std::cout << std::string(MAX_HYPENS, '-') << "\n";
-						std::cerr << "invalid source path...\n";
-						std::cout << std::string(MAX_HYPENS, '-') << "\n";
-						std::this_thread::sleep_for(std::chrono::seconds(2));
-						brk = false;
-					} else {
-						brk = true;
-					}
-				}
-				dir = src;
-				break;
-
-			}
-		}
-		return 0;
-	}
-
-}
+#include "../inc/vm.hpp"
+#include "../inc/snapshot.hpp"
+#include "../inc/cache.hpp"
+#include "../inc/bulk.hpp"
+
+#if defined(_DEBUG) || defined(DEBUG)
+#define Q_DEBUG
+#endif
+
+#include <type_traits> // std::enable_if, std::is_arithmetic, std::remove_reference...
+#include <cstring>     // std::memcpy
+
+namespace vm { /* conversion utilities */
+
+	using float32_t = float;
+	using float64_t = double;
+
+#define ARITHMETIC(tp)                                     \
+	std::enable_if_t<                                      \
+		std::is_arithmetic_v<std::remove_reference_t<tp>>, \
+		std::remove_reference_t<tp>                        \
+	>* = nullptr
+
+	template <class src_t, class dst_t, ARITHMETIC(src_t), ARITHMETIC(dst_t)>
+	dst_t to_type(const src_t val) {
+		union {
+			src_t s;
+			dst_t d;
+		} v;
+		v.s = val;
+		return v.d;
+	}
+
+}
+
+#include <iostream> // std::cout, std::cin, std::cerr
+#include <cctype>
+
+namespace vm { /* hex utilities */
+
+	uint8_t hex_dig_to_dec_dig(uint8_t val) {
+		if (val >= '0' && val <= '9') { // [0-9]
+			return val - '0';
+		}
+		if ((val = toupper(val)) >= 'A' && val <= 'F') { // [A-F]
+			return val - 'A' + 10;
+		}
+		return 0;
+	}
+
+	uint8_t dec_val_to_hex_dig(uint8_t val) {
+		if (val <= 9) {
+			return val + '0';
+		} else if (val >= 10 && val <= 15) {
+			return (val - 10) + 'A';
+		}
+		return 0;
+	}
+
+#define INTEGRAL(tp)                                     \
+	std::enable_if_t<                                    \
+		std::is_integral_v<std::remove_reference_t<tp>>, \
+		std::remove_reference_t<tp>                      \
+	>* = nullptr
+
+	template <class type_t, INTEGRAL(type_t)>
+	std::string to_hex(type_t val) {
+		uint8_t len(sizeof(type_t));
+		
+		uint8_t* var = new uint8_t[len]{ 0 }; // val as array of u8
+		for (uint8_t idx(0); idx < len; ++idx) {
+			var[idx] = val >> (((len - 1) - idx) * 8);
+		}
+
+		std::string ret;
+		uint8_t tmp[2]{ 0 }; // string in format 00
+		for (uint8_t idx(0); idx < len; ++idx) {
+			uint8_t dig(var[idx] / 0x10); // digit to parse
+			tmp[0] = dec_val_to_hex_dig(dig);
+			dig = var[idx] - (dig * 0x10);
+			tmp[1] = dec_val_to_hex_dig(dig);
+			ret.push_back(tmp[0]);
+			ret.push_back(tmp[1]);
+		}
+		delete[] var;
+		return std::string(ret);
+	}
+
+}
+
+#include <fstream> // std::ifstream, std::ofstream, std::ios_base
+
+namespace vm { /* file */
+
+	void write(std::string path, std::ios_base::openmode mode, const std::string val) {
+		std::ofstream out(path, mode);
+		if (out.is_open()) {
+			out.write(val.c_str(), val.size());
+		}
+	}
+
+}
+
+namespace vm { /* exception_c */
+
+	exception_c::exception_c(msg_t val) 
+		: m_msg(val) {
+	}
+
+	exception_c::exception_c(const exception_c& val)
+		: m_msg(val.get()) {
+	}
+
+	exception_c::exception_c(exception_c&& val) noexcept
+		: m_msg(std::move(val.get())) {
+	}
+
+	exception_c& exception_c::operator=(const exception_c& val) {
+		m_msg = val.get();
+		return *this;
+	}
+
+	exception_c& exception_c::operator=(exception_c&& val) noexcept {
+		m_msg = std::move(val.get());
+		return *this;
+	}
+
+	exception_c::msg_t exception_c::get() const {
+		return m_msg;
+	}
+
+	exception_c::msg_t& exception_c::get() {
+		return m_msg;
+	}
+
+}
+
+namespace vm { /* core_c */
+
+	core_c core_c::flush() {
+		return core_c(std::move(*this));
+	}
+
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+#define Q_MMAP
+#include <sys/mman.h> // mmap, munmap
+#include <unistd.h>   // pwrite, sysconf
+#endif
+
+#include <algorithm> // std::fill, std::min
+#include <vector>
+
+namespace vm { /* memory_c */
+
+	memory_c::memory_c(idx_t val)
+		: m_data(nullptr)
+		, m_len(val ? val : memory_c::dlen)
+		, m_faults(0)
+		, m_fault(0) {
+#ifdef Q_MMAP
+		// reserved only: pages are zero-filled by the kernel on first touch
+		int flg(MAP_PRIVATE | MAP_ANONYMOUS);
+#ifdef MAP_NORESERVE
+		flg |= MAP_NORESERVE;
+#endif
+		void* ret(mmap(nullptr, m_len, PROT_READ | PROT_WRITE, flg, -1, 0));
+		if (ret != MAP_FAILED) {
+			m_data = static_cast<loc_t*>(ret);
+			return;
+		}
+#else
+		try {
+			m_data = new loc_t[m_len]{ 0 };
+			return;
+		} catch (...) {
+		}
+#endif
+		std::cerr << "bad alloc [memory@length: " << m_len << "]";
+		m_len = 0;
+	}
+
+	memory_c::~memory_c() {
+#ifdef Q_MMAP
+		if (m_data) {
+			munmap(m_data, m_len);
+		}
+#else
+		delete[] m_data;
+#endif
+	}
+
+	memory_c::idx_t memory_c::length() const {
+		return m_len;
+	}
+
+	uint64_t memory_c::faults() const {
+		return m_faults;
+	}
+
+	memory_c::idx_t memory_c::fault() const {
+		return m_fault;
+	}
+
+	memory_c::loc_t& memory_c::miss(const idx_t val) {
+		thread_local loc_t ret(0);
+		++m_faults;
+		m_fault = val;
+		ret = 0; // nothing written out of range can be read back
+		return ret;
+	}
+
+	bool memory_c::copy(const idx_t dst, const loc_t* src, const idx_t len) {
+		try {
+			if (!m_data || dst > m_len || len > m_len - dst) {
+				throw exception_c("bad block [" + std::to_string(dst) + ", " + std::to_string(len) + "]");
+			}
+			if (len) {
+				std::memcpy(m_data + dst, src, len);
+			}
+			return true;
+		} catch (const exception_c& exc) {
+			std::cerr << exc.get() << std::endl;
+			return false;
+		}
+	}
+
+	bool memory_c::move(const idx_t dst, const idx_t src, const idx_t len) {
+		if (!valid(dst, len) || !valid(src, len)) {
+			miss(valid(dst, len) ? src : dst);
+			return false;
+		}
+		bulk_c::copy(m_data + dst, m_data + src, len);
+		return true;
+	}
+
+	bool memory_c::fill(const idx_t dst, const loc_t val, const idx_t len) {
+		if (!valid(dst, len)) {
+			miss(dst);
+			return false;
+		}
+		bulk_c::fill(m_data + dst, val, len);
+		return true;
+	}
+
+	bool memory_c::compare(const idx_t lhs, const idx_t rhs, const idx_t len, int32_t& ret) {
+		if (!valid(lhs, len) || !valid(rhs, len)) {
+			miss(valid(lhs, len) ? rhs : lhs);
+			return false;
+		}
+		ret = bulk_c::compare(m_data + lhs, m_data + rhs, len);
+		return true;
+	}
+
+	bool memory_c::dump(const int fd) const {
+#ifdef Q_MMAP
+		const size_t pg(static_cast<size_t>(sysconf(_SC_PAGESIZE)));
+		const size_t cnt((m_len + pg - 1) / pg);
+
+		// every page is read: residency says nothing of the pages swapped out
+		for (size_t idx(0); idx < cnt; ++idx) {
+			const loc_t* src(m_data + idx * pg);
+			size_t len(std::min(pg, m_len - idx * pg));
+			uint64_t acc(0); // by words, pages are aligned
+			for (size_t off(0); off + sizeof(acc) <= len; off += sizeof(acc)) {
+				uint64_t word;
+				std::memcpy(&word, src + off, sizeof(word));
+				acc |= word;
+			}
+			for (size_t off(len & ~(sizeof(acc) - 1)); off < len; ++off) {
+				acc |= src[off];
+			}
+			const bool nul(acc == 0);
+			if (!nul && pwrite(fd, src, len, static_cast<off_t>(idx * pg)) != static_cast<ssize_t>(len)) {
+				return false;
+			}
+		}
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	bool memory_c::fork(const int fd, const idx_t len) {
+#ifdef Q_MMAP
+		void* ret(mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0));
+		if (ret == MAP_FAILED) {
+			return false;
+		}
+		if (m_data) {
+			munmap(m_data, m_len);
+		}
+		m_data = static_cast<loc_t*>(ret);
+		m_len = len;
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	bool memory_c::map(const int fd, const idx_t dst, const idx_t len, const uint64_t off) {
+#ifdef Q_MMAP
+		if (!m_data || len == 0 || dst % page() != 0 || off % page() != 0 || !valid(dst, len)) {
+			return false;
+		}
+		void* ret(mmap(m_data + dst, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, static_cast<off_t>(off)));
+		return ret != MAP_FAILED;
+#else
+		return false;
+#endif
+	}
+
+	void memory_c::unmap(const idx_t dst, const idx_t len) {
+#ifdef Q_MMAP
+		if (!m_data || !valid(dst, len)) {
+			return;
+		}
+		int flg(MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED);
+#ifdef MAP_NORESERVE
+		flg |= MAP_NORESERVE;
+#endif
+		mmap(m_data + dst, len, PROT_READ | PROT_WRITE, flg, -1, 0);
+#endif
+	}
+
+	void memory_c::clear() {
+#ifdef Q_MMAP
+		unmap(0, m_len); // also drops the pages shared with a snapshot
+#else
+		if (m_data) {
+			std::fill(m_data, m_data + m_len, static_cast<loc_t>(0));
+		}
+#endif
+		m_faults = 0;
+		m_fault = 0;
+	}
+
+	memory_c::idx_t memory_c::page() {
+#ifdef Q_MMAP
+		static const idx_t ret(static_cast<idx_t>(sysconf(_SC_PAGESIZE)));
+		return ret;
+#else
+		return 0x1000;
+#endif
+	}
+
+}
+
+namespace vm { /* process_c */
+
+	process_c::process_c(info_t val)
+		: id(0)
+		, info(val)
+		, priority(0)
+		, state()
+		, ec(1)
+		, retired(0)
+		, faults(0)
+		, cpu(0)
+		, base(0)
+		, limit(0)
+		, stack(segments_c::none)
+		, verified(false) {
+	}
+
+	bool process_c::load(const path_t val, cache_c* cache) {
+		try {
+			const cache_c::key_t key(cache ? cache->key(val) : cache_c::key_t());
+			if (key.name && cache->fetch(key, *this)) { // parsed and verified by a previous run
+				state.clx() = image.code_length();
+				name = val;
+				return true;
+			}
+
+			if (!image.load(val)) {
+				return false;
+			}
+			check(val);
+			if (key.name) {
+				cache->store(key, *this);
+			}
+			return true;
+		} catch (const exception_c& exc) {
+			std::cerr << exc.get() << std::endl;
+			image.close();
+			return false;
+		}
+	}
+
+	bool process_c::load(const loc_t* src, const size_t len) {
+		try {
+			if (!image.load(src, len)) {
+				return false;
+			}
+			check("buffer");
+			return true;
+		} catch (const exception_c& exc) {
+			std::cerr << exc.get() << std::endl;
+			image.close();
+			return false;
+		}
+	}
+
+	bool process_c::link(const path_t val) {
+		std::unique_ptr<aot_c> tmp(new aot_c());
+		if (!tmp->open(val, image.code(), image.code_length())) {
+			return false;
+		}
+		aot = std::move(tmp);
+		return true;
+	}
+
+	void process_c::check(const path_t val) {
+		if (image.code_length() % sizeof(instr_t) != 0) {
+			throw exception_c("invalid bytecode source [" + val + "]");
+		}
+		if (image.code_length() == 0) {
+			throw exception_c("empty bytecode source [" + val + "]");
+		}
+
+		verifier_c ver;
+		if (!ver.run(image.code(), image.code_length())) {
+			throw exception_c("invalid bytecode source [" + val + "]: " + ver.error());
+		}
+		verified = ver.verified();
+		state.clx() = image.code_length();
+		name = val;
+	}
+
+	void process_c::start(const id_t val, const memory_c::idx_t csx) {
+		id = val;
+		state.csx() = csx;
+		state.ipx() = state.csx();
+		base = csx;
+		limit = csx + state.clx(); // latched: a program writing clx does not move it
+		beg = std::chrono::system_clock::now();
+		info |= (uint8_t)info_e::STARTED;
+	}
+
+}
+
+#define PRC_IS_STARTED(prc) ((prc->info & (uint8_t)process_c::info_e::STARTED) != 0)
+#define PRC_CLOSE(prc)       \
+	do {                     \
+		prc->info &= 0xFFFE; \
+		delete m_prc;        \
+		prc = nullptr;       \
+	} while (false);
+
+#include <string> // std::to_string, std::getline...
+#include <thread> // std::this_thread
+
+namespace vm {
+
+	vm_c::vm_c(idx_t val)
+		: m_ver(1)
+		, m_state()
+		, m_memory(val)
+		, m_start(std::chrono::system_clock::now())
+		, m_prc(nullptr)
+		, m_mode(jit_c::supported() ? engine_e::JIT : engine_e::THREADED)
+		, m_jit()
+		, m_sched()
+		, m_staged()
+		, m_ids(0)
+		, m_segments(m_memory.length())
+		, m_report()
+		, m_sandbox()
+		, m_io()
+		, m_profile()
+		, m_sampler()
+		, m_ec(1)
+		, m_guest(nullptr)
+		, m_retired(0)
+		, m_sink()
+		, m_input(nullptr) {
+		m_sandbox.open(".");
+	}
+
+	vm_c::~vm_c() {
+		drop();
+	}
+
+	vm_c::engine_e vm_c::mode() const {
+		return m_mode;
+	}
+
+	void vm_c::mode(const engine_e val) {
+		m_mode = val;
+	}
+
+	void vm_c::report(const report_t val) {
+		m_report = val;
+	}
+
+	bool vm_c::sandbox(const sandbox_c::path_t& val) {
+		return m_sandbox.open(val);
+	}
+
+	void vm_c::profile(const profile_c::path_t& val) {
+		m_profile = val;
+	}
+
+	void vm_c::sample(const sampler_c::path_t& dst, const sampler_c::interval val) {
+		if (dst.empty()) {
+			m_sampler.stop();
+			return;
+		}
+		m_sampler.start(dst, val);
+	}
+
+	void vm_c::deterministic(const bool val) {
+		m_segments.fixed(val);
+	}
+
+	void vm_c::quantum(const int64_t val) {
+		m_sched.quantum(val);
+	}
+
+	vm_c::version_t vm_c::version() const {
+		return m_ver;
+	}
+
+	const memory_c& vm_c::memory() const {
+		return m_memory;
+	}
+
+	bool vm_c::submit(process_c* val) {
+		return spawn(val, true);
+	}
+
+	vm_c::ecode_t vm_c::run(process_c* val, const uint8_t dbg) {
+		if (!spawn(val, dbg == 0)) {
+			return -1;
+		}
+		while (tick(dbg)) {
+		}
+		return m_ec; // left by the last slice
+	}
+
+	bool vm_c::snapshot(snapshot_c& val) {
+		if (throw_if(m_prc || m_sched.size() != 1 || m_io.pending(), "snapshot of a vm without a single ready process")) {
+			return false;
+		}
+		process_c* prc(m_sched.pop());
+		prc->console.flush(); // printed before the snapshot, not by every fork
+		bool ret(!throw_if(prc->heap.stats().reserved != 0, "snapshot of a process using its heap")
+			&& !throw_if(!prc->files.empty(), "snapshot of a process with open files")
+			&& val.take(m_memory, *prc, m_segments));
+		m_sched.push(prc);
+		return ret;
+	}
+
+	bool vm_c::fork(const snapshot_c& val) {
+		if (throw_if(m_prc || !m_sched.empty() || m_io.pending(), "fork of a running vm") || !val.map(m_memory)) {
+			return false;
+		}
+		m_segments.reset(m_memory.length());
+		m_jit.reset();
+
+		process_c* prc(new process_c());
+		val.restore(*prc);
+		if (throw_if(!val.claim(m_segments, *prc), "can not place the segments of the snapshot")) {
+			delete prc;
+			return false;
+		}
+		prc->id = ++m_ids;
+		if (!m_profile.empty()) {
+			prc->profile.reset(new profile_c(prc->state.clx()));
+		}
+		if (m_mode != engine_e::REFERENCE) {
+			prc->prog.decode(m_state, m_memory, prc->base, prc->state.clx());
+		}
+		m_sched.push(prc);
+		return true;
+	}
+
+	void vm_c::attach(const sink_t out, std::istream* in) {
+		m_sink = out;
+		m_input = in;
+	}
+
+	bool vm_c::load(const loc_t* src, const size_t len) {
+		reset();
+		process_c* prc(new process_c());
+		if (!prc->load(src, len)) {
+			delete prc;
+			return false;
+		}
+		prc->console.attach(m_sink, m_input);
+		if (!spawn(prc, true)) { // deleted
+			return false;
+		}
+		m_guest = prc;
+		return true;
+	}
+
+	bool vm_c::priority(const process_c::prio_t val) {
+		if (!m_guest || m_prc) {
+			return false;
+		}
+		const bool rdy(m_sched.erase(m_guest)); // queued again at its new level
+		m_guest->priority = val;
+		if (rdy) {
+			m_sched.push(m_guest);
+		}
+		return true;
+	}
+
+	bool vm_c::advance(const uint64_t val) {
+		uint64_t left(val);
+		while (m_guest && (val == 0 || left > 0)) {
+			if (m_io.pending()) {
+				resume(m_sched.empty());
+			}
+			if (m_sched.empty()) {
+				continue;
+			}
+			m_prc = m_sched.pop();
+			const bool own(m_prc == m_guest);
+			const uint64_t beg(m_prc->retired);
+			int32_t ret(slice(0, own ? static_cast<int64_t>(std::min<uint64_t>(left, m_sched.quantum())) : 0));
+			if (own) {
+				left -= std::min(left, m_prc->retired - beg);
+			}
+			if (ret == 0) {
+				close(0);
+			} else {
+				if (ret == 1) {
+					m_sched.push(m_prc);
+				}
+				m_prc = nullptr;
+			}
+		}
+		return m_guest != nullptr;
+	}
+
+	core_c::reg32_t vm_c::reg(const core_c::rega_t val) const {
+		return val < core_c::nregs ? (m_guest ? m_guest->state : m_state).r[val] : 0;
+	}
+
+	bool vm_c::reg(const core_c::rega_t val, const core_c::reg32_t src) {
+		if (!m_guest || m_prc || val >= core_c::nregs) {
+			return false;
+		}
+		m_prc = m_guest; // written as by the engine
+		m_state = m_guest->state;
+		m_state.r[val] = src;
+		if (val == core_c::xregs + 5) { // slx
+			stack();
+		} else if (val == core_c::xregs || val == core_c::xregs + 2) { // csx, clx
+			m_guest->prog.clear();
+			m_guest->aot.reset();
+			m_guest->verified = false;
+			m_guest->limit = m_state.csx() + m_state.clx(); // as a new start
+		}
+		m_guest->state = m_state;
+		m_prc = nullptr;
+		return true;
+	}
+
+	bool vm_c::peek(const idx_t val, loc_t* dst, const idx_t len) const {
+		const loc_t* src(m_memory.span(val, len));
+		if (!src) {
+			return false;
+		}
+		std::copy(src, src + len, dst);
+		return true;
+	}
+
+	bool vm_c::poke(const idx_t val, const loc_t* src, const idx_t len) {
+		if (!m_memory.valid(val, len) || m_prc || !m_memory.copy(val, src, len)) {
+			return false;
+		}
+		if (m_guest) {
+			m_prc = m_guest; // its native blocks
+			touch(val, len);
+			m_prc = nullptr;
+		}
+		return true;
+	}
+
+	vm_c::ecode_t vm_c::ec() const {
+		return m_guest ? m_guest->ec : m_ec;
+	}
+
+	uint64_t vm_c::retired() const {
+		return m_guest ? m_guest->retired : m_retired;
+	}
+
+	void vm_c::reset() {
+		drop();
+		m_memory.clear();
+		m_segments.reset(m_memory.length());
+		m_jit.reset();
+		m_state = core_c();
+		m_ec = 1;
+		m_retired = 0;
+	}
+
+	size_t vm_c::tick(const uint8_t dbg) {
+		if (m_io.pending()) {
+			resume(m_sched.empty());
+		}
+		if (!m_sched.empty()) {
+			m_prc = m_sched.pop();
+			int32_t ret(slice(dbg));
+			if (ret == 0) {
+				close(dbg);
+			} else {
+				if (ret == 1) {
+					m_sched.push(m_prc);
+				}
+				m_prc = nullptr;
+			}
+		}
+		return m_sched.size() + m_io.pending();
+	}
+
+	int32_t vm_c::start() {
+
+		std::cin.clear();
+		std::cout.clear();
+		std::cerr.clear();
+
+		int32_t ret(1);
+		uint8_t dbg(0);
+
+		while (true) {
+			if (m_io.pending()) { // nothing else to run: wait for a parked process
+				resume(m_sched.empty());
+			}
+			if (!m_sched.empty()) {
+				m_prc = m_sched.pop();
+				ret = slice(dbg);
+
+				// check special codes
+
+				if (ret == 0) { // close
+					close(dbg);
+				} else {
+					if (ret == 1) {
+						m_sched.push(m_prc);
+					}
+					m_prc = nullptr;
+				}
+			} else {
+				ret = menu();
+
+				// check special codes
+
+				switch (ret) {
+				case 1: // run every loaded program
+					for (auto prc : m_staged) {
+						spawn(prc, dbg == 0);
+					}
+					m_staged.clear();
+					break;
+
+				/* debug */
+				case 2:
+					dbg = 1; // show registers
+					break;
+				case 3:
+					dbg = 2; // show stack
+					break;
+				case 4:
+					dbg = 3; // show registers and stack
+					break;
+				case 5:
+					dbg = 4; // stop after each instruction and show registers and stack
+					break;
+
+				default:
+					dbg = 0;
+					break;
+				}
+			}
+
+			if (ret == -1) {
+				break;
+			}
+		}
+
+		for (auto prc : m_staged) { // loaded, never started
+			delete prc;
+		}
+		m_staged.clear();
+
+		return ret;
+	}
+
+	void vm_c::drop() {
+		while (m_io.pending()) { // the syscalls in flight write their process
+			resume(true);
+		}
+		while (!m_sched.empty()) {
+			process_c* prc(m_sched.pop());
+			prc->files.release(m_memory);
+			delete prc; // flushes its console
+		}
+		for (auto prc : m_staged) {
+			delete prc;
+		}
+		m_staged.clear();
+
+		m_prc = nullptr;
+		m_guest = nullptr;
+	}
+
+	bool vm_c::spawn(process_c* prc, const bool dec) {
+		const image_c& img(prc->image);
+		idx_t len(img.code_length() + img.data_length());
+
+		if (m_sched.empty() && !m_prc && !m_io.pending()) { // nothing runs: reuse the native code
+			m_jit.reset();
+		}
+
+		// code and data in one segment, given back when the process ends
+		idx_t at(m_segments.alloc(len));
+		if (throw_if(at == segments_c::none, "out of memory [process@length: " + std::to_string(len) + "]")) {
+			delete prc;
+			return false;
+		}
+
+		prc->start(prc->id ? prc->id : ++m_ids, at);
+		m_memory.copy(prc->state.csx(), img.code(), img.code_length());
+		if (img.data_length()) { // data section, right after the code
+			m_memory.copy(prc->state.csx() + img.code_length(), img.data(), img.data_length());
+			prc->state.ax() = prc->state.csx() + img.code_length();
+		}
+		prc->image.close();
+
+		if (!m_profile.empty()) {
+			prc->profile.reset(new profile_c(prc->state.clx()));
+		}
+		if (dec && !prc->aot && m_mode != engine_e::REFERENCE) {
+			prc->prog.decode(m_state, m_memory, prc->state.csx(), prc->state.clx());
+		}
+
+		m_sched.push(prc);
+		return true;
+	}
+
+	int32_t vm_c::slice(const uint8_t dbg, const int64_t lim) {
+		process_c& prc(*m_prc);
+		const core_c::reg32_t mx_ip(prc.limit);
+		const auto beg(std::chrono::steady_clock::now());
+
+		prc.info |= static_cast<process_c::info_t>(process_c::info_e::RUNNING);
+		m_state = prc.state;
+		m_ec = prc.ec;
+		m_jit.enable(m_mode == engine_e::JIT && !prc.profile);
+
+		int64_t fuel(lim > 0 ? std::min<int64_t>(lim, m_sched.quantum()) : m_sched.quantum()), init(fuel);
+		const bool smp(m_sampler.enabled());
+		uint64_t flt(m_memory.faults());
+		int32_t ret(1);
+		const loc_t* code(prc.verified && !dbg && !prc.profile && !smp ? m_memory.span(prc.base, prc.state.clx()) : nullptr);
+
+		while (ret == 1 && fuel > 0) {
+			if (prc.aot && !dbg && !prc.profile && !smp) {
+				ret = compiled(fuel);
+				if (ret == 1) {
+					prc.aot.reset(); // an interpreter continues from ipx
+				} else if (ret == 2) {
+					ret = 1; // end of the slice
+				} else if (ret == 3) {
+					ret = 2; // parked
+				}
+			} else if (prc.prog.valid() && !dbg) {
+				ret = dispatch(fuel);
+				if (ret == 1) {
+					prc.prog.clear(); // the engine continues from ipx
+				} else if (ret == 2) {
+					ret = 1; // end of the slice
+				} else if (ret == 3) {
+					ret = 2; // parked
+				}
+			} else if (code && m_state.ipx() - prc.base < prc.state.clx() && (m_state.ipx() - prc.base) % 4 == 0) {
+				ret = unchecked(code, fuel);
+			} else if (m_state.ipx() < mx_ip) {
+				const core_c::reg32_t at(m_state.ipx());
+				const bool prf(prc.profile && at >= prc.base && (at - prc.base) % 4 == 0);
+				if (prf) { // one step: entered and left
+					prc.profile->enter((at - prc.base) / 4);
+				}
+				if (smp && at >= prc.base && m_sampler.due()) {
+					++prc.samples[at - prc.base];
+				}
+				const loc_t* ins(m_memory.span(m_state.ipx(), 4));
+				ret = ins ? engine(ins[0], ins[1], ins[2], ins[3]) : engine(
+					m_memory.get(m_state.ipx()),
+					m_memory.get(m_state.ipx() + 1),
+					m_memory.get(m_state.ipx() + 2),
+					m_memory.get(m_state.ipx() + 3)
+				);
+				m_state.ipx() += 4;
+				--fuel;
+				if (prf && m_state.ipx() != at + 4) {
+					prc.profile->take((at - prc.base) / 4);
+				} else if (prf) {
+					prc.profile->leave((at - prc.base) / 4);
+				}
+
+				if (dbg && ret == 1) { // view
+					prc.console.flush();
+					ret = view(dbg);
+				}
+			} else {
+				ret = 0;
+			}
+		}
+
+		prc.state = m_state;
+		prc.ec = m_ec;
+		prc.retired += static_cast<uint64_t>(init - fuel);
+		prc.faults += m_memory.faults() - flt;
+		prc.cpu += std::chrono::steady_clock::now() - beg;
+		prc.info &= ~static_cast<process_c::info_t>(process_c::info_e::RUNNING);
+		return ret;
+	}
+
+	int32_t vm_c::unchecked(const loc_t* code, int64_t& fuel) {
+		const core_c::reg32_t base(m_prc->base), len(m_prc->state.clx());
+		core_c::reg32_t off(m_state.ipx() - base);
+		int32_t ret(1);
+
+		while (fuel > 0) {
+			const loc_t* ins(code + off);
+			ret = engine(ins[0], ins[1], ins[2], ins[3]);
+			m_state.ipx() += 4;
+			--fuel;
+			off += 4;
+			if (ret != 1) {
+				break;
+			}
+			if (m_state.ipx() - base != off) { // immediate targets are proven, register ones and rewritten code are not
+				off = m_state.ipx() - base;
+				if (off >= len || off % 4 != 0) {
+					break;
+				}
+			} else if (off == len) {
+				break;
+			}
+		}
+		return ret;
+	}
+
+	int32_t vm_c::compiled(int64_t& fuel) {
+		return m_prc->aot->run(this, &vm_c::step, m_state.r, &m_memory.at(0), m_memory.length(), m_prc->base, fuel);
+	}
+
+	int32_t vm_c::step(void* val) {
+		vm_c& qvm(*static_cast<vm_c*>(val));
+		const loc_t* ins(&qvm.m_memory.at(qvm.m_state.ipx())); // inside the code segment
+		int32_t ret(qvm.engine(ins[0], ins[1], ins[2], ins[3]));
+		qvm.m_state.ipx() += 4;
+		return ret;
+	}
+
+	void vm_c::close(const uint8_t dbg) {
+		m_prc->console.flush();
+		m_prc->files.release(m_memory);
+		m_prc->heap.release(m_segments);
+		m_segments.free(m_prc->base);
+		if (m_prc->stack != segments_c::none) {
+			m_segments.free(m_prc->stack);
+		}
+		if (m_prc->profile && !m_prc->profile->write(m_profile, *m_prc, m_memory)) {
+			std::cerr << "can not write the profile [" << m_profile << "]" << std::endl;
+		}
+		if (m_sampler.enabled() && !m_sampler.write(*m_prc, m_memory)) {
+			std::cerr << "can not write the samples" << std::endl;
+		}
+		if (m_prc == m_guest) { // the host reads the results from the vm
+			m_guest = nullptr;
+			m_retired = m_prc->retired;
+			if (m_report) {
+				m_report(*m_prc);
+			}
+			PRC_CLOSE(m_prc);
+			return;
+		}
+		if (m_report) { // the owner of the vm keeps the results
+			m_report(*m_prc);
+			PRC_CLOSE(m_prc);
+			return;
+		}
+
+		auto end(std::chrono::system_clock::now());
+		std::cout << "process (" << m_prc->id << ") ended with " << m_prc->ec
+			<< std::endl << "time elapsed: "
+			<< std::chrono::duration_cast<std::chrono::duration<double>>(end - m_prc->beg).count() << "s"
+			<< std::endl << "instructions retired: " << m_prc->retired << " in "
+			<< std::chrono::duration_cast<std::chrono::duration<double>>(m_prc->cpu).count() << "s"
+			<< std::endl;
+		if (m_prc->faults) {
+			std::cerr << "memory faults: " << m_prc->faults << " (last at " << m_memory.fault() << ")" << std::endl;
+		}
+		if (m_prc->heap.stats().allocs) {
+			const heap_c::stats_t& hst(m_prc->heap.stats());
+			std::cout << "heap: " << hst.allocs << " allocations, " << hst.frees << " frees, peak "
+				<< hst.peak_used << " bytes used of " << hst.peak_reserved << " reserved (fragmentation "
+				<< m_prc->heap.fragmentation() << ")" << std::endl;
+		}
+		if (m_mode != engine_e::REFERENCE && !dbg) { // superinstructions report
+			std::cout << "superinstructions:";
+			for (uint8_t idx(0); idx < static_cast<uint8_t>(program_c::fuse_e::COUNT); ++idx) {
+				auto kind(static_cast<program_c::fuse_e>(idx));
+				std::cout << " " << program_c::name(kind) << " " << m_prc->prog.fused(kind);
+			}
+			std::cout << std::endl;
+			if (m_mode == engine_e::JIT) {
+				std::cout << "native blocks: " << m_prc->prog.natives() << std::endl;
+			}
+		}
+		PRC_CLOSE(m_prc);
+	}
+
+	void vm_c::stack() {
+		if (m_prc->stack != segments_c::none) {
+			m_segments.free(m_prc->stack);
+		}
+		m_prc->stack = m_state.slx() ? m_segments.alloc(m_state.slx()) : segments_c::none;
+		throw_if(m_state.slx() && m_prc->stack == segments_c::none, "out of memory [stack@length: " + std::to_string(m_state.slx()) + "]");
+		m_state.ssx() = m_prc->stack == segments_c::none ? 0 : m_prc->stack;
+	}
+
+	int32_t vm_c::park(io_c::request_t&& val) {
+		val.prc = m_prc;
+		m_prc->info |= static_cast<process_c::info_t>(process_c::info_e::BLOCKED);
+		m_io.submit(std::move(val));
+		return 2;
+	}
+
+	void vm_c::resume(const bool wait) {
+		thread_local io_c::requests_t done;
+		done.clear();
+		m_io.collect(done, wait);
+
+		process_c* cur(m_prc);
+		for (auto& i : done) {
+			process_c& prc(*i.prc);
+			prc.state.x(0) = i.val;
+			if (i.kind == io_c::kind_e::LINE) {
+				for (auto c : i.buf) {
+					++prc.state.spx();
+					m_memory.get(prc.state.spx()) = static_cast<loc_t>(c);
+				}
+			} else if (i.kind == io_c::kind_e::READ && !i.buf.empty()) {
+				m_memory.copy(i.addr, reinterpret_cast<const loc_t*>(i.buf.data()), static_cast<idx_t>(i.buf.size()));
+				m_prc = &prc; // its native blocks
+				touch(i.addr, static_cast<idx_t>(i.buf.size()));
+			}
+			prc.info &= ~static_cast<process_c::info_t>(process_c::info_e::BLOCKED);
+			m_sched.push(&prc);
+		}
+		m_prc = cur;
+		done.clear();
+	}
+
+	int32_t vm_c::engine(const loc_t a, const loc_t b, const loc_t c, const loc_t d) {
+		core_c::reg32_t val(0);
+
+		switch (a) {
+		case 0x00: // nop
+			break;
+
+		case 0x01: // ldx x,v
+			m_state.get(b) = (static_cast<core_c::reg32_t>(c) << 8) | d;
+			if (b == core_c::xregs + 5) { // slx
+				stack();
+			}
+			break;
+
+		case 0x02: // ldx x,x
+			m_state.get(b) = m_state.get(c);
+			if (b == core_c::xregs + 5) { // slx
+				stack();
+			}
+			break;
+
+		case 0x03: // set v
+			m_memory.get(m_state.ax()) = b;
+			break;
+
+		case 0x04: // set x
+			m_memory.get(m_state.ax()) = m_state.get(b);
+			break;
+
+		case 0x05: // get x
+			m_state.get(b) = m_memory.get(m_state.ax());
+			break;
+
+		case 0x06: // exc v
+			return execute(
+				(static_cast<core_c::reg32_t>(b) << 0x10) | (static_cast<core_c::reg32_t>(c) << 8) | d
+			);
+
+		case 0x07: // exc x
+			return execute(m_state.get(b));
+
+		case 0x08: // jit v,v
+			if (m_state.fx() == d) {
+				m_state.ipx() = m_state.csx() + ((static_cast<core_c::reg32_t>(b) << 8) | c);
+			}
+			break;
+
+		case 0x09: // jit v,x
+			if (m_state.fx() == m_state.get(d)) {
+				m_state.ipx() = m_state.csx() + ((static_cast<core_c::reg32_t>(b) << 8) | c);
+			}
+			break;
+
+		case 0x0A: // jit x,v
+			if (m_state.fx() == ((static_cast<core_c::reg32_t>(c) << 8) | d)) {
+				m_state.ipx() = m_state.csx() + m_state.get(b);
+			}
+			break;
+
+		case 0x0B: // jit x,x
+			if (m_state.fx() == m_state.get(c)) {
+				m_state.ipx() = m_state.csx() + m_state.get(b);
+			}
+			break;
+
+		case 0x0C: // jif v,v
+			if (m_state.fx() != d) {
+				m_state.ipx() = m_state.csx() + ((static_cast<core_c::reg32_t>(b) << 8) | c);
+			}
+			break;
+
+		case 0x0D: // jif v,x
+			if (m_state.fx() != m_state.get(d)) {
+				m_state.ipx() = m_state.csx() + ((static_cast<core_c::reg32_t>(b) << 8) | c);
+			}
+			break;
+
+		case 0x0E: // jif x,v
+			if (m_state.fx() != m_state.get(c)) {
+				m_state.ipx() = m_state.csx() + m_state.get(b);
+			}
+			break;
+
+		case 0x0F: // jif x,x
+			if (m_state.fx() != m_state.get(c)) {
+				m_state.ipx() = m_state.csx() + m_state.get(b);
+			}
+			break;
+
+		case 0x10: // add x,v
+			m_state.get(b) += (static_cast<core_c::reg32_t>(c) << 8) | d;
+			break;
+
+		case 0x11: // add x,x
+			m_state.get(b) += m_state.get(c);
+			break;
+
+		case 0x12: // sub x,v
+			compare(m_state.get(b), m_state.get(c));
+			m_state.get(b) -= (static_cast<core_c::reg32_t>(c) << 8) | d;
+			break;
+
+		case 0x13: // sub x,x
+			compare(m_state.get(b), m_state.get(c));
+			m_state.get(b) -= m_state.get(c);
+			break;
+
+		case 0x14: // mul x,v
+			m_state.get(b) *= (static_cast<core_c::reg32_t>(c) << 8) | d;
+			break;
+
+		case 0x15: // mul x,x
+			m_state.get(b) *= m_state.get(c);
+			break;
+
+		case 0x16: // div x,v
+			val = (static_cast<core_c::reg32_t>(c) << 8) | d;
+			if (throw_if(val == 0, "math [0 as divisor]")) {
+				return 0;
+			}
+			m_state.get(b) /= val;
+			break;
+
+		case 0x17: // div x,x
+			if (throw_if(m_state.get(c) == 0, "math [0 as divisor]")) {
+				return 0;
+			}
+			m_state.get(b) /= m_state.get(c);
+			break;
+
+		case 0x18: // and x,v
+			m_state.get(b) &= (static_cast<core_c::reg32_t>(c) << 8) | d;
+			break;
+
+		case 0x19: // and x,x
+			m_state.get(b) &= m_state.get(c);
+			break;
+
+		case 0x1A: // or x,v
+			m_state.get(b) |= (static_cast<core_c::reg32_t>(c) << 8) | d;
+			break;
+
+		case 0x1B: // or x,x
+			m_state.get(b) |= m_state.get(c);
+			break;
+
+		case 0x1C: // xor x,v
+			m_state.get(b) ^= (static_cast<core_c::reg32_t>(c) << 8) | d;
+			break;
+
+		case 0x1D: // xor x,x
+			m_state.get(b) ^= m_state.get(c);
+			break;
+
+		case 0x1E: // shl x,v
+			m_state.get(b) <<= (static_cast<core_c::reg32_t>(c) << 8) | d;
+			break;
+
+		case 0x1F: // shl x,x
+			m_state.get(b) <<= m_state.get(c);
+			break;
+
+		case 0x20: // shr x,v
+			m_state.get(b) >>= (static_cast<core_c::reg32_t>(c) << 8) | d;
+			break;
+
+		case 0x21: // shr x,x
+			m_state.get(b) >>= m_state.get(c);
+			break;
+
+		case 0x22: // not x
+			m_state.get(b) = ~m_state.get(b);
+			break;
+
+		case 0x23: // cmp x,v
+			compare(m_state.get(b), (static_cast<core_c::reg32_t>(c) << 8) | d);
+			break;
+
+		case 0x24: // cmp x,x
+			compare(m_state.get(b), m_state.get(c));
+			break;
+
+		/* wide memory (c = 1: ax is moved past the value) */
+
+		case 0x25: // ldw x
+			{
+				uint16_t tmp(0);
+				m_memory.load16(m_state.ax(), tmp);
+				m_state.get(b) = tmp;
+			}
+			m_state.ax() += (c & 1) * 2;
+			break;
+
+		case 0x26: // stw x
+			if (m_memory.store16(m_state.ax(), static_cast<uint16_t>(m_state.get(b)))) {
+				touch(m_state.ax(), 2);
+			}
+			m_state.ax() += (c & 1) * 2;
+			break;
+
+		case 0x27: // ldd x
+			{
+				uint32_t tmp(0);
+				m_memory.load32(m_state.ax(), tmp);
+				m_state.get(b) = tmp;
+			}
+			m_state.ax() += (c & 1) * 4;
+			break;
+
+		case 0x28: // std x
+			if (m_memory.store32(m_state.ax(), m_state.get(b))) {
+				touch(m_state.ax(), 4);
+			}
+			m_state.ax() += (c & 1) * 4;
+			break;
+
+		/* bulk memory, a block crossing the end of memory is a fault and nothing is changed */
+
+		case 0x29: // mcp x,x (copy x[c] bytes from x[b] to ax)
+			val = m_state.get(c);
+			if (m_memory.move(m_state.ax(), m_state.get(b), val)) {
+				touch(m_state.ax(), val);
+			}
+			break;
+
+		case 0x2A: // mst x,x (fill x[c] bytes at ax with x[b])
+			val = m_state.get(c);
+			if (m_memory.fill(m_state.ax(), static_cast<loc_t>(m_state.get(b)), val)) {
+				touch(m_state.ax(), val);
+			}
+			break;
+
+		case 0x2B: // mcm x,x (compare x[c] bytes at ax with the ones at x[b], flags as cmp)
+			{
+				int32_t tmp(0);
+				if (m_memory.compare(m_state.ax(), m_state.get(b), m_state.get(c), tmp)) {
+					m_state.fx() = tmp < 0 ? 1 : tmp == 0 ? 2 : 4;
+				}
+			}
+			break;
+
+		default:
+			throw_if(true, "process (" + std::to_string(m_prc->id) 
+				+ ") has an invalid instruction [" + to_hex(a) + " " + to_hex(b) + " "
+				+ to_hex(c) + " " + to_hex(d) + "]");
+			return 0;
+		}
+
+		return 1;
+	}
+
+	int32_t vm_c::execute(const uint32_t val) {
+
+		// used by string output and file path methods (the input ones are served by m_io)
+		uint32_t ptr(m_state.x(0)), len(m_state.x(1)), idx(ptr);
+
+		if (m_prc->profile) {
+			m_prc->profile->syscall(val, m_state.sx());
+		}
+
+		switch (val) {
+		case 0x00000001: // exit, abort...
+
+			switch (m_state.sx()) {
+			case 0x00000001: // exit
+				m_ec = to_type<ecode_t, core_c::reg32_t>(m_state.x(0));
+				return 0;
+
+			case 0x00000002: // abort
+				throw_if(true, "process (" + std::to_string(m_prc->id) + ") aborted");
+				m_ec = -1;
+				return 0;
+
+			default:
+				break;
+			}
+
+			break;
+
+		case 0x00000002: // [console] input, output...
+
+			switch (m_state.sx()) {
+			case 0x00000001: // [output] char
+				m_prc->console.put((char)m_state.x(0));
+				break;
+
+			case 0x00000002: // [output] unsigned integer number
+				m_prc->console.put(m_state.x(0));
+				break;
+
+			case 0x00000003: // [output] signed integer number
+				m_prc->console.put(to_type<core_c::reg32_t, int32_t>(m_state.x(0)));
+				break;
+
+			case 0x00000004: // [output] floating point number
+				m_prc->console.put(to_type<core_c::reg32_t, float>(m_state.x(0)));
+				break;
+
+			case 0x00000005: // [output] string
+				if (const loc_t* src = m_memory.span(ptr, len)) { // one check for the whole string
+					m_prc->console.write(reinterpret_cast<const char*>(src), len);
+					break;
+				}
+				while (idx < ptr + len) {
+					m_prc->console.put(static_cast<char>(m_memory.get(idx)));
+					++idx;
+				}
+				break;
+
+			case 0x00000006: // [input] char
+			case 0x00000007: // [input] unsigned integer number
+			case 0x00000008: // [input] signed integer number
+			case 0x00000009: // [input] floating point number
+			case 0x0000000A: // [input] string (pushed on the stack)
+				return park(io_c::request_t{
+					nullptr, static_cast<io_c::kind_e>(m_state.sx() - 6), &m_prc->console.in(), -1, 0, std::string(), m_state.x(0)
+				});
+
+			case 0x0000000B: // [output] clear screen
+				m_prc->console.flush();
+				system("cls");
+				break;
+
+			default:
+				break;
+			}
+
+			break;
+
+		case 0x00000003: // [file] input, output... (result in x0, 0xFFFFFFFF on error)
+
+			switch (m_state.sx()) {
+			case 0x00000001: // open file (path at x0, length x1, flags x2)
+				if (const loc_t* src = m_memory.span(ptr, len)) {
+					m_state.x(0) = m_prc->files.open(m_sandbox, std::string(reinterpret_cast<const char*>(src), len), m_state.x(2));
+					break;
+				}
+				m_state.x(0) = files_c::bad;
+				break;
+
+			case 0x00000002: // close file (descriptor x0)
+				m_state.x(0) = m_prc->files.close(m_state.x(0));
+				break;
+
+			case 0x00000003: // remove file (path at x0, length x1)
+				if (const loc_t* src = m_memory.span(ptr, len)) {
+					m_state.x(0) = files_c::remove(m_sandbox, std::string(reinterpret_cast<const char*>(src), len));
+					break;
+				}
+				m_state.x(0) = files_c::bad;
+				break;
+
+			case 0x00000004: // read file (descriptor x0, address x1, length x2)
+				if (m_prc->files.host(m_state.x(0)) >= 0 && m_memory.valid(m_state.x(1), m_state.x(2))) {
+					return park(io_c::request_t{
+						nullptr, io_c::kind_e::READ, nullptr, m_prc->files.host(m_state.x(0)), m_state.x(1),
+						std::string(m_state.x(2), '\0'), files_c::bad
+					});
+				}
+				m_state.x(0) = files_c::bad;
+				break;
+
+			case 0x00000005: // write file (descriptor x0, address x1, length x2)
+				if (const loc_t* src = m_prc->files.host(m_state.x(0)) >= 0 ? m_memory.span(m_state.x(1), m_state.x(2)) : nullptr) {
+					return park(io_c::request_t{
+						nullptr, io_c::kind_e::WRITE, nullptr, m_prc->files.host(m_state.x(0)), m_state.x(1),
+						std::string(reinterpret_cast<const char*>(src), m_state.x(2)), files_c::bad
+					});
+				}
+				m_state.x(0) = files_c::bad;
+				break;
+
+			case 0x00000006: // seek file (descriptor x0, signed offset x1, origin x2)
+				m_state.x(0) = m_prc->files.seek(m_state.x(0), to_type<core_c::reg32_t, int32_t>(m_state.x(1)), m_state.x(2));
+				break;
+
+			case 0x00000007: // size of file (descriptor x0)
+				m_state.x(0) = m_prc->files.size(m_state.x(0));
+				break;
+
+			case 0x00000008: // map file (descriptor x0, address x1, length x2, offset x3)
+				m_state.x(0) = m_prc->files.map(m_state.x(0), m_memory, m_state.x(1), m_state.x(2), m_state.x(3));
+				if (m_state.x(0) != files_c::bad) {
+					touch(m_state.x(1), m_state.x(0));
+				}
+				break;
+
+			default:
+				break;
+			}
+
+			break;
+
+		case 0x00000004: // [heap] allocate, free... (result in x0, 0xFFFFFFFF on error)
+
+			switch (m_state.sx()) {
+			case 0x00000001: // allocate (length x0)
+				m_state.x(0) = m_prc->heap.alloc(m_segments, m_state.x(0));
+				break;
+
+			case 0x00000002: // free (address x0)
+				m_state.x(0) = m_prc->heap.free(m_segments, m_state.x(0));
+				break;
+
+			case 0x00000003: // resize (address x0, length x1), the block may move
+				m_state.x(0) = m_prc->heap.resize(m_segments, m_memory, m_state.x(0), m_state.x(1));
+				break;
+
+			case 0x00000004: // length of a block (address x0)
+				m_state.x(0) = m_prc->heap.size(m_state.x(0));
+				break;
+
+			default:
+				break;
+			}
+
+			break;
+
+		default:
+			break;
+		}
+
+		return 1;
+	}
+
+	bool vm_c::throw_if(const bool cnd, const msg_t val) {
+		try {
+			if (cnd) {
+				throw exception_c(val);
+			}
+		} catch (const exception_c& exc) {
+			std::cerr << exc.get() << std::endl;
+			return true;
+		}
+		return false;
+	}
+
+	void vm_c::compare(const uint32_t left, const uint32_t right) {
+		m_state.fx() = compare_flags(left, right);
+	}
+
+	void vm_c::show_regs() {
+		std::cout << "\n" << msg_t(47, '-') << "\n";
+		std::cout << "registers" << "\n";
+		std::cout << msg_t(47, '-') << "\n";
+		core_c::rega_t i(1);
+		for (core_c::rega_t idx(0); idx < core_c::xregs; ++idx, ++i) {
+			std::cout << "[x" << idx + 1;
+			if (idx + 1 < 10) {
+				std::cout << " ";
+			}
+			std::cout << "][" << to_hex(m_state.x(idx)) << "]\t";
+			if (i == 3) {
+				std::cout << "\n";
+				i = 0;
+			}
+		}
+		std::cout << "\n" << msg_t(47, '-') << "\n";
+		std::cout << "[csx][" << to_hex(m_state.csx()) << "]\t";
+		std::cout << "[ipx][" << to_hex(m_state.ipx()) << "]\t";
+		std::cout << "[clx][" << to_hex(m_state.clx()) << "]\t\n";
+		std::cout << msg_t(47, '-') << "\n";
+		std::cout << "[ssx][" << to_hex(m_state.ssx()) << "]\t";
+		std::cout << "[spx][" << to_hex(m_state.spx()) << "]\t";
+		std::cout << "[slx][" << to_hex(m_state.slx()) << "]\t\n";
+		std::cout << msg_t(47, '-') << "\n";
+		std::cout << "[ax][" << to_hex(m_state.ax()) << "]\t";
+		std::cout << "[sx][" << to_hex(m_state.sx()) << "]\t";
+		std::cout << "[fx][" << to_hex(m_state.fx()) << "]\t\n";
+		std::cout << msg_t(47, '-') << "\n";
+	}
+
+	void vm_c::show_stack() {
+		std::cout << "\n" << msg_t(47, '-') << "\n";
+		std::cout << "stack" << "\n";
+		std::cout << msg_t(47, '-') << "\n";
+		idx_t i(1);
+		for (idx_t idx(m_state.ssx()); idx < m_state.spx(); ++idx, ++i) {
+			std::cout << "[" << to_hex(m_state.ssx() + idx) << "][" << to_hex(m_memory.get(idx)) << "]\t";
+			if (i == 3) {
+				std::cout << "\n";
+				i = 0;
+			}
+		}
+		if (m_state.ssx() == m_state.spx() || m_state.slx() == 0 || m_state.ssx() == 0 || m_state.spx() == 0) {
+			std::cout << "empty stack...";
+		}
+		std::cout << "\n" << msg_t(47, '-') << "\n";
+	}
+
+	int32_t vm_c::view(const uint8_t val) {
+		switch (val) {
+		case 1:
+			show_regs();
+			break;
+		case 2:
+			show_stack();
+			break;
+		case 3:
+			show_regs();
+			show_stack();
+			break;
+		case 4:
+			show_regs();
+			show_stack();
+			std::cout << "\n" << msg_t(47, '-') << "\n";
+			char c;
+			std::cout << "press 'b' to break or other key to continue: ";
+			std::cin >> c;
+			std::cout << msg_t(47, '-') << "\n";
+			if ((c = tolower(c)) == 'b') {
+				return 0;
+			}
+			break;
+		default:
+			break;
+		}
+		return 1;
+	}
+
+#define MAX_HYPENS 50
+#define VPAD_CLS 30
+
+	int32_t vm_c::menu() {
+		static std::string dir;
+		static std::string ver("-----[ QVM " + std::to_string(m_ver) + " ]-----");
+		static size_t hypens(MAX_HYPENS - ver.size());
+
+		while (true) {
+			bool brk(false);
+			char c('\0');
+			while (!brk) {
+				std::cout << std::string(VPAD_CLS, '\n');
+
+				std::cout << ver << std::string(hypens, '-') << "\n";
+				std::cout << "[1] load program\n";
+				std::cout << "[2] run program\n";
+				std::cout << "[3] debug\n";
+				std::cout << "[4] directory\n";
+				std::cout << "[5] engine: " << (m_mode == engine_e::JIT ? "jit" : m_mode == engine_e::THREADED ? "threaded" : "reference") << "\n";
+				std::cout << "[0] exit\n";
+				std::cout << std::string(MAX_HYPENS, '-') << "\n";
+				std::cin.clear();
+				std::cin >> c;
+
+				if (c > '5') {
+					std::cout << std::string(MAX_HYPENS, '-') << "\n";
+					std::cerr << "invalid choice...\n";
+					std::cout << std::string(MAX_HYPENS, '-') << "\n";
+					std::this_thread::sleep_for(std::chrono::seconds(2));
+					brk = false;
+				} else {
+					brk = true;
+				}
+			}
+
+			std::string src;
+
+			switch (c) {
+			case '0':
+				return -1;
+
+			case '1': // load
+				brk = false;
+				while (!brk) {
+					std::cout << std::string(VPAD_CLS, '\n');
+
+					std::cout << ver << std::string(hypens, '-') << "\n";
+					std::cout << "program file: ";
+					std::cin.clear();
+					std::cin >> src;
+					std::cout << std::string(MAX_HYPENS, '-') << "\n";
+
+					if (src.empty()) {
+						std::cout << std::string(MAX_HYPENS, '-') << "\n";
+						std::cerr << "invalid source path...\n";
+						std::cout << std::string(MAX_HYPENS, '-') << "\n";
+						std::this_thread::sleep_for(std::chrono::seconds(2));
+						brk = false;
+					} else {
+						brk = true;
+					}
+				}
+				{
+					process_c* prc(new process_c());
+					if (prc->load(dir + "/" + src)) {
+						m_staged.push_back(prc);
+					} else {
+						delete prc;
+					}
+				}
+				break;
+
+			case '2': // run
+				if (m_staged.empty()) {
+					std::cout << std::string(MAX_HYPENS, '-') << "\n";
+					std::cerr << "invalid choice...\n";
+					std::cout << std::string(MAX_HYPENS, '-') << "\n";
+					std::this_thread::sleep_for(std::chrono::seconds(2));
+				} else {
+					return 1;
+				}
+				break;
+
+			case '3': // debug
+				brk = false;
+				while (!brk) {
+					std::cout << std::string(VPAD_CLS, '\n');
+
+					std::cout << ver << std::string(hypens, '-') << "\n";
+					std::cout << "[1] show registers\n";
+					std::cout << "[2] show stack\n";
+					std::cout << "[3] show both\n";
+					std::cout << "[4] stop after each instruction and show both\n";
+					std::cout << "[0] exit\n";
+					std::cout << std::string(MAX_HYPENS, '-') << "\n";
+					std::cin.clear();
+					std::cin >> c;
+
+					if (c > '4') {
+						std::cout << std::string(MAX_HYPENS, '-') << "\n";
+						std::cerr << "invalid choice...\n";
+						std::cout << std::string(MAX_HYPENS, '-') << "\n";
+						std::this_thread::sleep_for(std::chrono::seconds(2));
+						brk = false;
+					} else {
+						brk = true;
+					}
+				}
+
+				if (c == '0') {
+					return 0;
+				}
+				return (c - '0' + 1);
+
+			case '4': // directory
+				brk = false;
+				while (!brk) {
+					std::cout << std::string(VPAD_CLS, '\n');
+
+					std::cout << ver << std::string(hypens, '-') << "\n";
+					std::cout << "directory: ";
+					std::cin.clear();
+					std::cin >> src;
+					std::cout << std::string(MAX_HYPENS, '-') << "\n";
+
+					if (src.empty()) {
+						std::cout << std::string(MAX_HYPENS, '-') << "\n";
+						std::cerr << "invalid source path...\n";
+						std::cout << std::string(MAX_HYPENS, '-') << "\n";
+						std::this_thread::sleep_for(std::chrono::seconds(2));
+						brk = false;
+					} else {
+						brk = true;
+					}
+				}
+				dir = src;
+				break;
+
+			case '5': // engine (jit -> threaded -> reference)
+				switch (m_mode) {
+				case engine_e::JIT:
+					m_mode = engine_e::THREADED;
+					break;
+				case engine_e::THREADED:
+					m_mode = engine_e::REFERENCE;
+					break;
+				default:
+					m_mode = jit_c::supported() ? engine_e::JIT : engine_e::THREADED;
+					break;
+				}
+				break;
+
+			}
+		}
+		return 0;
+	}
+
+}